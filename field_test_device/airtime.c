@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Airtime of the uplinks, under the duty cycle and the airtime budget.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "xtimer.h"
+
+#include "time_on_air.h"
+#include "airtime.h"
+
+#define NELEMS(x)  (sizeof(x) / sizeof((x)[0]))
+
+// Sub-band of the default channels of the region.
+typedef struct {
+	uint16_t divisor;		// of the duty cycle (100 for 1 %)
+	uint64_t ready_ms;		// end of the time off, since boot
+} airtime_band_t;
+
+// Duty cycle of the sub-bands of the default channels (as the region of the
+// MAC). The channels added by the network (e.g. 867.1 to 867.9 MHz in EU868)
+// are in other sub-bands, so the sender may wait more than needed, not less.
+#if AIRTIME_DUTY_CYCLE == 1 && (defined(REGION_EU868) || defined(REGION_EU433) || defined(REGION_RU864))
+#define AIRTIME_BANDS	1
+static airtime_band_t airtime_bands[] = {
+	{ 100, 0 },				// 868.1, 868.3 and 868.5 MHz in EU868 (g1, 1 %), see airtime.h
+};
+#endif
+
+#if AIRTIME_BUDGET_MS > 0
+#define AIRTIME_DAY_MS		(24ULL * 60 * 60 * 1000)
+#define AIRTIME_BUDGET_US	((uint64_t)AIRTIME_BUDGET_MS * US_PER_MS)
+
+// Airtime of the frames of each hour, over the current hour and the 24
+// previous ones, so that any day is covered by the sum of the slots.
+#define AIRTIME_SLOTS		25
+#define AIRTIME_SLOT_MS		(AIRTIME_DAY_MS / (AIRTIME_SLOTS - 1))
+static uint32_t airtime_slots_us[AIRTIME_SLOTS];
+static uint64_t airtime_slot = 0;
+
+// Clear the slots which left the day.
+static uint64_t airtime_expire(uint64_t now)
+{
+	uint64_t slot = now / AIRTIME_SLOT_MS;
+	if (slot - airtime_slot >= AIRTIME_SLOTS) {
+		memset(airtime_slots_us, 0, sizeof(airtime_slots_us));
+		airtime_slot = slot;
+	}
+	while (airtime_slot < slot) {
+		airtime_slot++;
+		airtime_slots_us[airtime_slot % AIRTIME_SLOTS] = 0;
+	}
+
+	uint64_t used = 0;
+	for (unsigned int i = 0; i < AIRTIME_SLOTS; i++) {
+		used += airtime_slots_us[i];
+	}
+	return used;
+}
+
+// Time until enough slots leave the day for a frame.
+static uint64_t airtime_budget_wait_ms(uint64_t now, uint32_t toa)
+{
+	uint64_t used = airtime_expire(now);
+	if (used + toa <= AIRTIME_BUDGET_US) {
+		return 0;
+	}
+	if (toa > AIRTIME_BUDGET_US) {
+		// Never allowed.
+		return AIRTIME_DAY_MS;
+	}
+
+	// From the oldest slot, which leaves the day at the start of the next slot.
+	uint64_t freed = 0;
+	unsigned int k;
+	for (k = 0; k < AIRTIME_SLOTS - 1; k++) {
+		freed += airtime_slots_us[(airtime_slot + 1 + k) % AIRTIME_SLOTS];
+		if (used - freed + toa <= AIRTIME_BUDGET_US) {
+			break;
+		}
+	}
+	return (airtime_slot + 1 + k) * AIRTIME_SLOT_MS - now;
+}
+#endif
+
+uint32_t airtime_wait_ms(uint8_t dr, uint8_t len)
+{
+	uint64_t now = xtimer_now_usec64() / US_PER_MS;
+	uint64_t wait = 0;
+
+#ifdef AIRTIME_BANDS
+	// The MAC takes a channel in any sub-band out of its time off.
+	uint64_t ready = UINT64_MAX;
+	for (unsigned int i = 0; i < NELEMS(airtime_bands); i++) {
+		if (airtime_bands[i].ready_ms < ready) {
+			ready = airtime_bands[i].ready_ms;
+		}
+	}
+	wait = (ready > now) ? ready - now : 0;
+#endif
+
+#if AIRTIME_BUDGET_MS > 0
+	uint64_t budget = airtime_budget_wait_ms(now, time_on_air_us(dr, len));
+	if (budget > wait) {
+		wait = budget;
+	}
+#else
+	(void)now;
+	(void)dr;
+	(void)len;
+#endif
+
+	return (wait < UINT32_MAX) ? wait : UINT32_MAX;
+}
+
+void airtime_sent(uint8_t dr, uint8_t len)
+{
+	uint64_t now = xtimer_now_usec64() / US_PER_MS;
+	uint32_t toa = time_on_air_us(dr, len);
+
+#ifdef AIRTIME_BANDS
+	// The sub-band of the frame is not known: all those out of their time off are charged.
+	for (unsigned int i = 0; i < NELEMS(airtime_bands); i++) {
+		if (airtime_bands[i].ready_ms <= now) {
+			airtime_bands[i].ready_ms = now + ((uint64_t)toa * (airtime_bands[i].divisor - 1) + US_PER_MS - 1) / US_PER_MS;
+		}
+	}
+#endif
+
+#if AIRTIME_BUDGET_MS > 0
+	airtime_expire(now);
+	airtime_slots_us[airtime_slot % AIRTIME_SLOTS] += toa;
+#else
+	(void)now;
+#endif
+
+	DEBUG("[airtime] dr=%d size=%d toa=%lu us\n", dr, len, toa);
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Airtime of the uplinks, under the duty cycle and the airtime budget.
+ *
+ * The time off of each sub-band of the default channels of the region is
+ * tracked as the MAC does (the time on air multiplied by the duty cycle
+ * divisor), and so is an optional daily airtime budget (e.g. a fair use
+ * policy), over hourly slots covering the last day. The sender
+ * waits until both allow its next frame, so the MAC never restricts it.
+ *
+ * In EU868, only the 1 % sub-band of the default channels (g1, 868.0 to
+ * 868.6 MHz) is tracked, for every frame. The channels added by the network
+ * in g (865.0 to 868.0 MHz, 1 %) only make the wait longer than needed, but
+ * a channel in g2 (868.7 to 869.2 MHz, 0.1 %) or g3 (869.4 to 869.65 MHz,
+ * 10 %) is not modeled: the MAC may still restrict a frame sent on it.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef AIRTIME_H
+#define AIRTIME_H
+
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef AIRTIME_DUTY_CYCLE
+// Track the duty cycle of the sub-bands of the region (0 when it is disabled in the region of the MAC).
+#define AIRTIME_DUTY_CYCLE	1
+#endif
+
+#ifndef AIRTIME_BUDGET_MS
+// Airtime budget per day in ms (e.g. 30000 for the TTN fair use policy), 0 without budget.
+#define AIRTIME_BUDGET_MS	0
+#endif
+
+/**
+ * Get the time until a frame is allowed.
+ *
+ * @param dr the datarate of the frame
+ * @param len the size of the application payload
+ *
+ * @return the time in ms (0 if the frame is allowed now)
+ */
+extern uint32_t airtime_wait_ms(uint8_t dr, uint8_t len);
+
+/**
+ * Account for a frame, once sent (the time off of the MAC starts after its
+ * end, so after the send is conservative).
+ *
+ * @param dr the datarate of the frame
+ * @param len the size of the application payload
+ */
+extern void airtime_sent(uint8_t dr, uint8_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AIRTIME_H */
@@ -8,29 +8,100 @@ This project is under the MIT license
 */
 #ifdef GPS
 
+#include <isrpipe.h>
 #include <mutex.h>
 #include <panic.h>
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 
 // Stop the application on an error.
 #define PANIC(msg) core_panic(PANIC_GENERAL_ERROR, msg)
 
 
+// Baudrate of the GNSS module at startup (and of the console).
+#ifndef STD_BAUDRATE
+#define STD_BAUDRATE 9600
+#endif
+
 // Update UART line every .. ms
 #define UART_UPDATE_MS  500
 
+// Size of the ring buffer filled by the UART ISR (must be a power of 2).
+#ifndef UART_RX_BUFFER_SIZE
+#define UART_RX_BUFFER_SIZE  256
+#endif
+
+// Size of the ring buffer of the console output (must be a power of 2).
+#ifndef UART_TX_BUFFER_SIZE
+#define UART_TX_BUFFER_SIZE  512
+#endif
+
+// Measure the worst-case duration of the UART ISR (reported with the console
+// output of each benchmark sequence).
+#ifndef UART_ISR_STATS
+#define UART_ISR_STATS  0
+#endif
+
 // Store information given by UART.
 typedef struct {
-    mutex_t mutex;
-    bool is_parsing;
-    uint8_t line_length;
-    char line[128];
+    isrpipe_t rx;               // Bytes pushed by the ISR, drained by the GPS thread.
+    uint32_t overruns;          // Bytes lost because the ring buffer was full.
+    uint32_t sentences;         // Sentences successfully parsed.
+    uint32_t dropped;           // Sentences dropped (truncated or bad checksum).
+    uint32_t isr_max_us;        // Worst-case ISR duration since the last report (if UART_ISR_STATS).
+    uint32_t parse_us;          // Time spent in the parser (if GPS_PARSER_STATS).
+    uint32_t parse_bytes;       // Bytes parsed (if GPS_PARSER_STATS).
+    uint32_t baudrate;          // Current baudrate.
+    uint32_t tx_bytes;          // Console bytes queued for the stdio thread.
+    uint32_t tx_dropped;        // Console bytes dropped because the ring buffer was full.
 } uart_info_t;
 
 // Unique instance of UART info structure.
 extern uart_info_t uart_info;
 
+/**
+ * @brief Start the low-priority thread that parses the NMEA sentences
+ *        pushed by the UART ISR, and the thread that writes the console
+ *        output (written synchronously until then).
+ */
+void uart_gps_thread_start(void);
+
+// Requests to the GPS thread (see uart_gps_request).
+#define UART_GPS_RESET   0x01  // Forget the parsed GPS data.
+#define UART_GPS_CONFIG  0x02  // Configure the module again (after a power cycle).
+
+/**
+ * @brief Ask the GPS thread to reset the parsed GPS data and/or to detect
+ *        and configure the module again, once the bytes already received
+ *        are parsed. The GPS thread is woken up even if the module is off.
+ * @param requests `UART_GPS_RESET` and/or `UART_GPS_CONFIG`.
+ */
+void uart_gps_request(unsigned int requests);
+
+/**
+ * @brief Send a command to the GNSS module.
+ * @param data Command to send.
+ * @param len Length of the command.
+ */
+void uart_gps_send(const uint8_t *data, size_t len);
+
+/**
+ * @brief Flush the console output and keep the next one queued (dropped
+ *        once the ring buffer is full), so that the UART stays silent
+ *        while the GNSS module sharing it is in standby, or release it.
+ *        The output written synchronously (e.g. a panic) is not held.
+ * @param hold Whether to hold the console output.
+ */
+void uart_stdio_hold(bool hold);
+
+/**
+ * @brief Change the baudrate of the UART shared by the console and the GNSS
+ *        module.
+ * @param baudrate New baudrate.
+ */
+void uart_gps_set_baudrate(uint32_t baudrate);
+
 #endif
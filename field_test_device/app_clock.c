@@ -381,7 +381,7 @@ int8_t app_clock_process_downlink(semtech_loramac_t *loramac) {
 int8_t app_clock_send_app_time_req(semtech_loramac_t *loramac) {
 	DEBUG("[clock] app_clock_send_app_time_req\n");
 
-	uint8_t payload[1 + sizeof(APP_CLOCK_AppTimeReq_t)];
+	uint8_t payload[APP_CLOCK_APP_TIME_REQ_LEN];
 	payload[0] = APP_CLOCK_CID_AppTimeReq;
 
 	APP_CLOCK_AppTimeReq_t *atr = (APP_CLOCK_AppTimeReq_t*) (payload + 1);
@@ -396,7 +396,7 @@ int8_t app_clock_send_app_time_req(semtech_loramac_t *loramac) {
 
 	/* send the LoRaWAN message */
 	uint8_t ret = semtech_loramac_send(loramac, payload,
-			1 + sizeof(APP_CLOCK_AppTimeReq_t));
+			APP_CLOCK_APP_TIME_REQ_LEN);
 
 	int8_t error;
 	if (ret != SEMTECH_LORAMAC_TX_DONE) {
@@ -99,6 +99,9 @@ typedef struct {
 	unsigned int RFU :3;
 } __attribute__((packed)) APP_CLOCK_AppTimeReq_t;
 
+// Size of the AppTimeReq uplink (with its CID).
+#define APP_CLOCK_APP_TIME_REQ_LEN					(1 + sizeof(APP_CLOCK_AppTimeReq_t))
+
 typedef struct {
 	/**
 	 * TimeCorrection is a signed 32-bit integer, stipulating the time delta correction in seconds.
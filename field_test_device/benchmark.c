@@ -1,6 +1,3 @@
-
-
-
 #define ENABLE_DEBUG (1)
 #include "debug.h"
 
@@ -15,9 +12,24 @@
 #include "semtech_loramac.h"
 #include "loramac_utils.h"
 #include "app_clock.h"
+#include "sensors.h"
+#include "airtime.h"
+#include "drpwsz.h"
+#include "vdev.h"
+#include "txstats.h"
+#include "downlink.h"
+#include "payload_parity.h"
 
 #include <random.h>
 
+#if GPS == 1
+#include "app.h"
+#include "irq.h"
+#endif
+#if GPS == 1 && GPS_POWER_SAVE == 1
+#include "gps_power.h"
+#endif
+
 
 // Count the number of elements in an array.
 //#define CNT(array) (uint8_t)(sizeof(array) / sizeof(*array))
@@ -26,30 +38,120 @@
 
 static uint8_t payload[PAYLOAD_LEN];
 
-// Encode message data to the payload.
-unsigned int encode_benchmark(uint8_t *payload, unsigned int len, uint8_t power, uint8_t dr)
+// Scheduled instant of the next transmission, for its delay.
+static uint64_t benchmark_scheduled_usec;
+
+// Wait before the next transmission (with the GNSS module in backup meanwhile),
+// while the sensors are sampled for it if it is a data frame.
+static void benchmark_sleep_usec(uint64_t usec, bool data_frame)
 {
+	benchmark_scheduled_usec = xtimer_now_usec64() + usec;
+	if (data_frame) {
+		sensors_schedule(usec / US_PER_MS);
+	}
+#if GPS == 1 && GPS_POWER_SAVE == 1
+	gps_power_sleep(usec / US_PER_MS);
+#else
+	xtimer_usleep64(usec);
+#endif
+}
 
-	// reset the payload
-	memset(payload,0,PAYLOAD_LEN);
+// Whether a send went on air (TX_CNF_FAILED when a confirmed frame got no
+// ACK), so that its airtime counts.
+static bool benchmark_transmitted(uint8_t ret)
+{
+	return ret == SEMTECH_LORAMAC_TX_DONE || ret == SEMTECH_LORAMAC_TX_CNF_FAILED;
+}
 
-	if(len < sizeof(2 * sizeof(uint8_t))) {
-		return 0;
+// Wait for a frame: at least usec, and until the duty cycle and the airtime
+// budget allow it.
+static void benchmark_wait(uint8_t dr, uint8_t len, uint64_t usec, bool data_frame)
+{
+	uint64_t allowed = (uint64_t)airtime_wait_ms(dr, len) * US_PER_MS;
+	if (allowed > usec) {
+		DEBUG("[ftd] wait %lu ms for the duty cycle or the airtime budget\n", (uint32_t)(allowed / US_PER_MS));
+		usec = allowed;
 	}
+	benchmark_sleep_usec(usec, data_frame);
+}
 
-	unsigned int i = 0;
+// Wait for the frame of the i-th triplet of the sequence (its largest payload,
+// at the current datarate under ADR).
+static void benchmark_wait_triplet(semtech_loramac_t *loramac, const struct benchmark_t *benchmark, int i, uint64_t usec)
+{
+	uint8_t dr = benchmark->drpwsz_sequence[3*i];
+	uint8_t size = benchmark->drpwsz_sequence[3*i+2];
+	if (dr == 0xff) {
+		dr = semtech_loramac_get_dr(loramac);
+	}
+	uint8_t max_size = loramac_utils_max_payload_size(dr);
+	benchmark_wait(dr, (size < max_size) ? size : max_size, usec, true);
+}
 
-	// Encode txpower.
-	payload[i++] = power;
-    // Encode datarate.
-	payload[i++] = dr;
+// Send the stats of the last sequences (from the device itself).
+static void benchmark_send_stats(semtech_loramac_t *loramac, uint64_t usec)
+{
+	vdev_switch(loramac, 0);
+	uint8_t len = txstats_encode(payload, TXSTATS_LEN);
+
+	// The lowest datarate from the current one where the whole frame fits
+	// (else the frame is truncated at the current one).
+	uint8_t dr = semtech_loramac_get_dr(loramac);
+	uint8_t fit = dr;
+	while (loramac_utils_max_payload_size(fit) != 0 && loramac_utils_max_payload_size(fit) < len) {
+		fit++;
+	}
+	if (loramac_utils_max_payload_size(fit) == 0) {
+		len = loramac_utils_max_payload_size(dr);
+	} else if (fit != dr) {
+		// the next triplet sets the datarate or ADR again
+		semtech_loramac_set_adr(loramac, false);
+		semtech_loramac_set_dr(loramac, fit);
+		dr = fit;
+	}
+	benchmark_wait(dr, len, usec, false);
 
-	// TODO add FCNT, RSSI, LSNR of the last downlink.
+	semtech_loramac_set_tx_port(loramac, TXSTATS_PORT);
+	uint8_t ret = semtech_loramac_send(loramac, payload, len);
+	if (benchmark_transmitted(ret)) {
+		airtime_sent(dr, len);
+	}
+	// The counters are sent again with the next stats frame otherwise.
+	if (ret == SEMTECH_LORAMAC_TX_DONE) {
+		txstats_reset();
+	}
+	DEBUG("[ftd] Stats sent: dr=%d len=%d ret=%d\n", dr, len, ret);
+}
 
-	return i;
+#if GPS == 1
+// Report the console output of the last benchmark sequence, the time the
+// sender would have spent writing it synchronously (10 bits per byte), and
+// the worst-case duration of the UART ISR.
+static void benchmark_report_stdio(void)
+{
+	static uint32_t tx_bytes = 0;
+	static uint32_t tx_dropped = 0;
+
+	uint32_t bytes = uart_info.tx_bytes - tx_bytes;
+	uint32_t dropped = uart_info.tx_dropped - tx_dropped;
+	tx_bytes = uart_info.tx_bytes;
+	tx_dropped = uart_info.tx_dropped;
+
+	DEBUG("[ftd] stdio: %lu bytes queued (%lu ms not blocked), %lu bytes dropped\n",
+		bytes, (uint32_t)((uint64_t)bytes * 10 * 1000 / uart_info.baudrate), dropped);
+
+#if UART_ISR_STATS
+	// Worst-case duration of the UART ISR over the sequence.
+	unsigned int state = irq_disable();
+	uint32_t isr_max_us = uart_info.isr_max_us;
+	uart_info.isr_max_us = 0;
+	irq_restore(state);
+	DEBUG("[ftd] uart: ISR %lu us at most, %lu bytes lost\n", isr_max_us, uart_info.overruns);
+#endif
 }
+#endif
 
-void benchmark_start(semtech_loramac_t *loramac, struct benchmark_t benchmark, unsigned int (*encode_sensors)(uint8_t*, const unsigned int)) {
+void benchmark_start(semtech_loramac_t *loramac, struct benchmark_t benchmark, unsigned int (*encode_sensors)(payload_values_t*, uint8_t*, const unsigned int)) {
 
     // Start benchmark
     DEBUG("[ftd] Start benchmark\n");
@@ -58,6 +160,15 @@ void benchmark_start(semtech_loramac_t *loramac, struct benchmark_t benchmark, u
     /* set ADR flag */
     semtech_loramac_set_adr(loramac, benchmark.adr);
 
+    // the sequence can be replaced by a downlink, between two sequences
+    drpwsz_init(benchmark.drpwsz_sequence, benchmark.drpwsz_sequence_nb);
+    benchmark.drpwsz_sequence_nb = drpwsz_swap(&benchmark.drpwsz_sequence);
+
+    // the virtual devices start from the session of the join
+    vdev_init(loramac);
+
+    benchmark_scheduled_usec = xtimer_now_usec64();
+
     uint8_t port = benchmark.min_port;
     uint32_t cpt = 0;
     while (1)
@@ -79,19 +190,12 @@ void benchmark_start(semtech_loramac_t *loramac, struct benchmark_t benchmark, u
             power = benchmark.drpwsz_sequence[3*i+1];
             size = benchmark.drpwsz_sequence[3*i+2];
 
-            // TODO uint32_t devaddr = devaddrs[cpt%ARRAYSIZE(devaddrs)];
-            uint32_t devaddr = benchmark.devaddr + (cpt%benchmark.nb_virtual_devices);
+            // the session (devaddr, fcnt, keys) of the next virtual device
+            uint32_t devaddr = vdev_switch(loramac, cpt % benchmark.nb_virtual_devices);
 
         	DEBUG("[ftd] Send @ devaddr=%8lx port=%d dr=%d txpower=%d size=%d\n", devaddr, port, dr, power, size);
 
-        	unsigned int len = encode_benchmark(payload, size, power, dr);
-
-        	len = encode_sensors(payload + len, size - len);
-
-            // WARNING : If LORAMAC_TX_CNF, the firmware is blocked when the network server does not confirmed the message
-            //semtech_loramac_set_tx_mode(loramac, benchmark.txconfirmed ? LORAMAC_TX_CNF : LORAMAC_TX_UNCNF);
-
-            /* send the LoRaWAN message */
+            /* set the datarate before encoding, for its maximum payload size */
         	if(dr == 0xff) {
         	    semtech_loramac_set_adr(loramac, true);
         	} else {
@@ -99,12 +203,54 @@ void benchmark_start(semtech_loramac_t *loramac, struct benchmark_t benchmark, u
         		semtech_loramac_set_dr(loramac, dr);
         	}
 
+        	uint8_t tx_dr = semtech_loramac_get_dr(loramac);
+        	uint8_t max_size = loramac_utils_max_payload_size(tx_dr);
+        	uint8_t limit = (size < max_size) ? size : max_size;
+
+        	// reset the payload
+        	memset(payload,0,PAYLOAD_LEN);
+
+        	// The fields are truncated to the limit by priority (see payload_fields.h).
+        	// The datarate of the frame, also under ADR (0xff in the sequence).
+        	payload_values_t values = { .txpower = power, .datarate = tx_dr };
+#if PAYLOAD_DOWNLINK == 1
+        	// the last downlink, without waiting for the receiver thread
+        	downlink_info_t downlink;
+        	downlink_get(&downlink);
+        	values.downlink_count = downlink.count;
+        	values.downlink_fcnt = downlink.fcnt_down;
+        	// sent as -RSSI on a byte, so down to -255 dBm
+        	values.downlink_rssi = (downlink.rssi < -255) ? 255 : (downlink.rssi > 0) ? 0 : -downlink.rssi;
+        	values.downlink_snr = downlink.snr;
+#endif
+        	unsigned int fields_len = (limit < PAYLOAD_FIELDS_LEN) ? limit : PAYLOAD_FIELDS_LEN;
+        	unsigned int len = encode_sensors(&values, payload + fields_len, limit - fields_len);
+#if PAYLOAD_PARITY > 0
+        	payload_parity_encode(&values, limit);
+#endif
+        	len += payload_encode(payload, limit, &values);
+
+        	// Padding only for a size sweep.
+        	if(benchmark.size_sweep) {
+        		len = limit;
+        	}
+        	if(limit < size) {
+        		DEBUG("[ftd] size=%d reduced to %d for the current datarate\n", size, limit);
+        	}
+
+            // WARNING : If LORAMAC_TX_CNF, the firmware is blocked when the network server does not confirmed the message
+            //semtech_loramac_set_tx_mode(loramac, benchmark.txconfirmed ? LORAMAC_TX_CNF : LORAMAC_TX_UNCNF);
+
+            /* send the LoRaWAN message */
             semtech_loramac_set_tx_port(loramac, port);
             semtech_loramac_set_tx_power(loramac, power);
 
-            semtech_loramac_set_devaddr(loramac, (uint8_t*)&devaddr);
-
-            uint8_t ret = semtech_loramac_send(loramac, payload, size);
+            uint64_t send_usec = xtimer_now_usec64();
+            uint8_t ret = semtech_loramac_send(loramac, payload, len);
+            if (benchmark_transmitted(ret)) {
+            	airtime_sent(tx_dr, len);
+            }
+            txstats_sent(ret, tx_dr, power, xtimer_now_usec64() - send_usec, send_usec - benchmark_scheduled_usec);
 
             uint32_t uplink_counter = semtech_loramac_get_uplink_counter(loramac);
 
@@ -114,22 +260,39 @@ void benchmark_start(semtech_loramac_t *loramac, struct benchmark_t benchmark, u
             	DEBUG("[ftd] Tx Done ret=%d fcnt=%ld\n", ret, uplink_counter);
             }
 
-            xtimer_sleep(*benchmark.tx_period);
+            // The next triplet at the earliest instant allowed, or after the period.
+            uint64_t period = benchmark.asap ? 0 : (uint64_t)*benchmark.tx_period * US_PER_SEC;
 
             // send a APP_TIME_REQ request every APP_TIME_REQ_PERIOD message
             if(cpt%APP_TIME_REQ_PERIOD == 0) {
+            	benchmark_wait(tx_dr, APP_CLOCK_APP_TIME_REQ_LEN, period, false);
             	// keep the current MAC configuration
                 //semtech_loramac_set_tx_mode(loramac, LORAMAC_TX_CNF);
-            	app_clock_send_app_time_req(loramac);
-            	xtimer_sleep(*benchmark.tx_period);
+            	if (app_clock_send_app_time_req(loramac) == APP_CLOCK_OK) {
+            		airtime_sent(tx_dr, APP_CLOCK_APP_TIME_REQ_LEN);
+            	}
             }
 
+            if(i + 1 < benchmark.drpwsz_sequence_nb) {
+            	benchmark_wait_triplet(loramac, &benchmark, i + 1, period);
+            }
         }
 
+        // a sequence received meanwhile starts now
+        benchmark.drpwsz_sequence_nb = drpwsz_swap(&benchmark.drpwsz_sequence);
+
+        if (txstats_sequence()) {
+        	benchmark_send_stats(loramac, benchmark.asap ? 0 : (uint64_t)*benchmark.tx_period * US_PER_SEC);
+        }
+
+#if GPS == 1
+        benchmark_report_stdio();
+#endif
+
         /* sleep tx_period secs */
         // TODO introduire un alea de quelques secondes dans la tx_period pour éviter que des endpoints qui redémarrent ensemble se brouillent les uns les autres.
-        // TODO verifier que la tx_period est compatible avec le DC (sinon, le Tx retourne le code=13)
-        xtimer_usleep(*benchmark.tx_period * 1000000 + random_uint32_range (0, NEXT_BENCHMARK_RANDOM * 1000000));
+        benchmark_wait_triplet(loramac, &benchmark, 0,
+        		(uint64_t)*benchmark.tx_period * US_PER_SEC + random_uint32_range(0, NEXT_BENCHMARK_RANDOM * US_PER_SEC));
 
     }
 
@@ -30,6 +30,7 @@ extern "C"
 
 #include <inttypes.h>
 #include "semtech_loramac.h"
+#include "payload.h"
 
 
 #ifndef NEXT_BENCHMARK_RANDOM
@@ -44,24 +45,25 @@ extern "C"
 #endif
 
 struct benchmark_t {
-	uint32_t devaddr;
-#ifdef DEVADDRS
-	uint32_t* devaddr;
-#endif
-	uint8_t nb_virtual_devices;
+	uint16_t nb_virtual_devices;	// sessions of vdev.h
 	uint8_t min_port;
 	uint8_t max_port;
 	uint16_t *tx_period;
 	uint8_t drpwsz_sequence_nb;
-	uint8_t *drpwsz_sequence;
+	const uint8_t *drpwsz_sequence;
 	bool txconfirmed;
 	bool adr;
+	bool size_sweep;	// pad the payloads to the sizes of the sequence
+	bool asap;			// send each triplet at the earliest instant allowed by the duty cycle and the airtime budget, instead of after tx_period
 };
 
 /**
  * Start the benchmark.
  *
  * @param loramac the LoRaMac context
+ * @param encode_sensors sets the sensor fields of the values, encodes the
+ *        variable fields into the rest of the payload (after the fixed fields)
+ *        and returns their length
  */
-extern void benchmark_start(semtech_loramac_t *loramac, struct benchmark_t benchmark, unsigned int (*encode_sensors)(uint8_t*, const unsigned int));
+extern void benchmark_start(semtech_loramac_t *loramac, struct benchmark_t benchmark, unsigned int (*encode_sensors)(payload_values_t*, uint8_t*, const unsigned int));
 #endif /* BENCHMARK_H */
@@ -25,12 +25,220 @@ if(applicationName !== "BALLOON_FTD") {
 
 // Decoder here
 
+// BEGIN PAYLOAD_FIELDS (generated from payload_fields.h by `make codec`)
+var PAYLOAD_FIELDS = [
+    ["txpower", 0, 1, 1],
+    ["dataRate", 0, 1, 1],
+    ["latitude", 1, 3, (8388607 / 90.0)],
+    ["longitude", 1, 3, (8388607 / 180.0)],
+    ["altitude", 0, 2, 1],
+    ["temperature", 1, 2, 100],
+    ["ttff", 0, 2, 1],
+    ["downlinkCount", 0, 1, 1],
+    ["downlinkFcnt", 0, 2, 1],
+    ["downlinkRssi", 0, 1, -1],
+    ["downlinkSnr", 1, 1, 1],
+];
+var PAYLOAD_FIELDS_V0 = [
+    ["txpower", 0, 1, 1],
+    ["dataRate", 0, 1, 1],
+    ["temperature", 1, 2, 100],
+    ["latitude", 1, 3, (8388607 / 90.0)],
+    ["longitude", 1, 3, (8388607 / 180.0)],
+    ["altitude", 0, 2, 1],
+    ["ttff", 0, 2, 1],
+];
+var PARITY_WINDOW = 0;
+// END PAYLOAD_FIELDS
+
+// Decode the fixed fields of the layout present in the payload into o (scaled)
+// and raw, and return the offset of the variable fields.
+function decodeFields(bytes, fields, o, raw) {
+  var offset = 0;
+  for(var f = 0; f < fields.length; f++) {
+    var field = fields[f];
+    if(offset + field[2] > bytes.length) { break; }
+    raw[field[0]] = field[1] ? bytes.readIntBE(offset, field[2]) : bytes.readUIntBE(offset, field[2]);
+    o[field[0]] = raw[field[0]] / field[3];
+    offset += field[2];
+  }
+  // The format shares the first byte with the txpower idx.
+  if(raw.txpower !== undefined) {
+    raw.txpower &= 0x0F;
+    o.txpower = raw.txpower;
+  }
+  return offset;
+}
+
+// BEGIN PARITY (also run by codec/parity_sim.js)
+// Positions of the lost frames, rebuilt from the parity fields (PAYLOAD_PARITY
+// on the device): each frame carries the XOR of the position fields of the
+// PARITY_WINDOW previous frames, so a position is rebuilt from a parity in
+// which it is the only unknown one. The history of the device is kept between
+// the frames (the device has a single chain: one virtual device and one port).
+const PARITY_HISTORY = 64;
+
+// Index of a frame in the history from its sequence index, -1 for a duplicate.
+function parityIndex(history, sequence) {
+  if(sequence < PARITY_WINDOW) {
+    // First frames since the boot: the frames before have no position.
+    if(history.last === undefined || history.last >= sequence) {
+      history.fixes = {};
+      history.parities = {};
+      history.boot = true;
+    }
+    return sequence;
+  }
+  if(history.last === undefined || history.last < PARITY_WINDOW) {
+    return sequence;
+  }
+  // The sequence index restarts at PARITY_WINDOW after 255.
+  var period = 256 - PARITY_WINDOW;
+  var last = PARITY_WINDOW + (history.last - PARITY_WINDOW) % period;
+  var delta = (sequence - last + period) % period;
+  return (delta === 0) ? -1 : history.last + delta;
+}
+
+function parityFix(history, index) {
+  return (index < 0 && history.boot) ? [0, 0, 0] : history.fixes[index];
+}
+
+// Add a frame (its position fields and its parity fields) to the history, and
+// return the rebuilt positions as [frames before this one, position fields].
+function parityAdd(history, sequence, fix, parity) {
+  var index = parityIndex(history, sequence);
+  if(index < 0) { return []; }
+  history.last = index;
+  history.fixes[index] = fix;
+  history.parities[index] = parity;
+  for(var i in history.fixes) {
+    if(Number(i) <= index - PARITY_HISTORY) { delete history.fixes[i]; }
+  }
+
+  var rebuilt = [];
+  var progress = true;
+  while(progress) {
+    progress = false;
+    for(var e in history.parities) {
+      var x = history.parities[e].slice();
+      var unknown = [];
+      for(var j = 1; j <= PARITY_WINDOW; j++) {
+        var f = parityFix(history, Number(e) - j);
+        if(f === undefined) {
+          unknown.push(Number(e) - j);
+        } else {
+          x[0] ^= f[0]; x[1] ^= f[1]; x[2] ^= f[2];
+        }
+      }
+      if(unknown.length === 1) {
+        history.fixes[unknown[0]] = x;
+        rebuilt.push([index - unknown[0], x]);
+        progress = true;
+      }
+      if(unknown.length <= 1 || Number(e) <= index - PARITY_HISTORY) {
+        delete history.parities[e];
+      }
+    }
+  }
+  return rebuilt;
+}
+// END PARITY
+
+// Format of the payload, in the 4 high bits of the first byte: the former
+// layout of the fixed fields (PAYLOAD_FIELDS_V0), the bit-packed payload and
+// the fixed fields.
+const PAYLOAD_FORMAT_FIELDS_V0 = 0;
+const PAYLOAD_FORMAT_PACKED = 1;
+const PAYLOAD_FORMAT_FIELDS = 2;
+
+// Bit-packed payload (PAYLOAD_PACKED=1 on the device): the anchor and the
+// resolution of the positions are those of the firmware.
+const PACKED_ANCHOR_LATITUDE = 45.1934;
+const PACKED_ANCHOR_LONGITUDE = 5.7674;
+const PACKED_POSITION_SHIFT = 7;
+
+// Read a field of the bit-packed payload, from its first bit.
+function readBits(bytes, bit, width, signed) {
+  var val = 0;
+  for(var i = bit; i < bit + width; i++) {
+    val = val * 2 + ((bytes[i >> 3] >> (7 - (i & 7))) & 1);
+  }
+  if(signed && val >= Math.pow(2, width - 1)) { val -= Math.pow(2, width); }
+  return val;
+}
+
+// Position of the anchor in the 24-bit encoding.
+function anchorBinary(degrees, range) {
+  return Math.sign(degrees) * Math.round(Math.abs(degrees) * 8388607 / range);
+}
+
+function decodePacked(bytes, o) {
+  o.format = "packed";
+  o.txpower = readBits(bytes, 4, 4, false);
+  o.dataRate = readBits(bytes, 8, 4, false);
+  o.temperature = readBits(bytes, 12, 12, true) / 10.0;
+  var dlat = readBits(bytes, 24, 12, true);
+  var dlon = readBits(bytes, 36, 12, true);
+  if(dlat !== -2048 || dlon !== -2048) {
+    var lat = anchorBinary(PACKED_ANCHOR_LATITUDE, 90) + dlat * Math.pow(2, PACKED_POSITION_SHIFT);
+    var lon = anchorBinary(PACKED_ANCHOR_LONGITUDE, 180) + dlon * Math.pow(2, PACKED_POSITION_SHIFT);
+    o.latitude = Math.round(lat * 90 / 8388607 * 1000000) / 1000000;
+    o.longitude = Math.round(lon * 180 / 8388607 * 1000000) / 1000000;
+    o.altitude = readBits(bytes, 48, 16, false) * 2;
+  }
+  return o;
+}
+
+// Stats frames of the transmissions (TXSTATS_PORT on the device, see txstats.h).
+const TXSTATS_PORT = 210;
+const TXSTATS_RETURN_CODES = [
+  "JOIN_SUCCEEDED", "JOIN_FAILED", "NOT_JOINED", "ALREADY_JOINED", "TX_OK",
+  "TX_SCHEDULE", "TX_DONE", "TX_CNF_FAILED", "TX_ERROR", "RX_DATA",
+  "RX_LINK_CHECK", "RX_CONFIRMED", "BUSY", "DUTYCYCLE_RESTRICTED"
+];
+
+// Counters of the bits set in a bitmap, keyed by name (or index).
+function decodeTxStatsCounters(bytes, offset, names, counters) {
+  if(offset + 2 > bytes.length) { return bytes.length; }
+  var bitmap = bytes.readUInt16BE(offset);
+  offset += 2;
+  for(var i = 0; i < 16; i++) {
+    if((bitmap & (1 << i)) && offset + 2 <= bytes.length) {
+      counters[(names && names[i]) || i] = bytes.readUInt16BE(offset);
+      offset += 2;
+    }
+  }
+  return offset;
+}
+
+function decodeTxStats(bytes, o) {
+  o.statsIndex = bytes.readUInt8(0);
+  o.sequences = bytes.readUInt8(1);
+  o.returnCodes = {};
+  o.dataRates = {};
+  o.txpowers = {};
+  var offset = decodeTxStatsCounters(bytes, 2, TXSTATS_RETURN_CODES, o.returnCodes);
+  offset = decodeTxStatsCounters(bytes, offset, undefined, o.dataRates);
+  offset = decodeTxStatsCounters(bytes, offset, undefined, o.txpowers);
+  // Buckets [0, 64), [64, 128), ... [4096, inf) ms, then [0, 1), [1, 2), ... [64, inf) ms.
+  o.sendHistogram = [];
+  o.delayHistogram = [];
+  for(var k = 0; k < 8 && offset + k < bytes.length; k++) {
+    o.sendHistogram.push(bytes.readUInt8(offset + k));
+  }
+  for(k = 0; k < 8 && offset + 8 + k < bytes.length; k++) {
+    o.delayHistogram.push(bytes.readUInt8(offset + 8 + k));
+  }
+  return o;
+}
+
 // Decode decodes an array of bytes into an object.
 //  - fPort contains the LoRaWAN fPort number
 //  - bytes is an array of bytes, e.g. [225, 230, 255, 0]
 //  - variables contains the device variables e.g. {"calibration": "3.5"} (both the key / value are of type string)
 // The function must return an object, e.g. {"temperature": 22.5}
-function Decode(fPort, bytes, variables) {
+//  - history keeps the previous frames of the device, for the parity fields
+function Decode(fPort, bytes, variables, history) {
 
   var o = {};
 
@@ -38,6 +246,10 @@ function Decode(fPort, bytes, variables) {
   	// App Clock Synchronization (https://lora-alliance.org/resource-hub/lorawanr-application-layer-clock-synchronization-specification-v100).
   	// Remark: The synchronization is done at the Chirpstack LNS level.
     // TODO
+  } else if(fPort === TXSTATS_PORT) {
+    if(bytes.length >= 2) {
+      decodeTxStats(bytes, o);
+    }
   } else {
     var size = bytes.length;
     
@@ -45,33 +257,81 @@ function Decode(fPort, bytes, variables) {
     
     o.size = size;
 
-    if(size < 2) { return o; }
-
-    o.txpower = bytes.readUInt8(0);
-    o.dataRate = bytes.readUInt8(1);
-
-    if(size < 4) { return o; }
+    var format = (size > 0) ? bytes[0] >> 4 : PAYLOAD_FORMAT_FIELDS;
+    if(size >= 8 && format === PAYLOAD_FORMAT_PACKED) {
+      return decodePacked(bytes, o);
+    }
+    if(format !== PAYLOAD_FORMAT_FIELDS && format !== PAYLOAD_FORMAT_FIELDS_V0) {
+      o.format = format;
+      return o;
+    }
 
-    o.temperature = bytes.readInt16BE(2)/100.0;
-
-    if(size < 12) { return o; }
+    var raw = {};
+    var end = decodeFields(bytes, (format === PAYLOAD_FORMAT_FIELDS_V0) ? PAYLOAD_FIELDS_V0 : PAYLOAD_FIELDS, o, raw);
+    if(raw.longitude === undefined) { return o; }
 
     // Value used for the conversion of the position from DMS to decimal.
     const MaxNorthPosition = 8388607; // 2^23 - 1
     const MaxEastPosition  = 8388607; // 2^23 - 1
 
-    // Extract latitude.
-    var Latitude = (bytes.readUInt32BE(4) >> 8) & 0x7FFF;
-    Latitude = Latitude * 90 / MaxNorthPosition;
-    o.latitude = Math.round(Latitude * 1000000) / 1000000;
+    if(raw.latitude === 0 && raw.longitude === 0) {
+      // No fix.
+      delete o.latitude;
+      delete o.longitude;
+      delete o.altitude;
+    } else {
+      o.latitude = Math.round(o.latitude * 1000000) / 1000000;
+      o.longitude = Math.round(o.longitude * 1000000) / 1000000;
+    }
+
+    // The time to first fix since boot (in seconds).
+    if(o.ttff === 0xFFFF) { delete o.ttff; }
 
-    // Extract longitude.
-    var Longitude = (bytes.readInt32BE(7) >> 8);
-    Longitude = Longitude * 180 / MaxEastPosition;
-    o.longitude = Math.round(Longitude * 1000000) / 1000000;
+    if(raw.parityAltitude !== undefined) {
+      var rebuilt = history ? parityAdd(history, raw.paritySequence,
+        [raw.latitude & 0xFFFFFF, raw.longitude & 0xFFFFFF, raw.altitude],
+        [raw.parityLatitude, raw.parityLongitude, raw.parityAltitude]) : [];
+      delete o.parityLatitude;
+      delete o.parityLongitude;
+      delete o.parityAltitude;
+      // The positions of the lost frames, without those without fix.
+      o.rebuilt = [];
+      for(var r = 0; r < rebuilt.length; r++) {
+        var rlat = (rebuilt[r][1][0] << 8) >> 8;
+        var rlon = (rebuilt[r][1][1] << 8) >> 8;
+        if(rlat === 0 && rlon === 0) { continue; }
+        o.rebuilt.push({
+          framesAgo: rebuilt[r][0],
+          latitude: Math.round(rlat * 90 / MaxNorthPosition * 1000000) / 1000000,
+          longitude: Math.round(rlon * 180 / MaxEastPosition * 1000000) / 1000000,
+          altitude: rebuilt[r][1][2]
+        });
+      }
+    }
 
-    // Extract altitude.
-    o.altitude = bytes.readUInt16BE(10);
+    if(end + 2 > size || raw.ttff === undefined || o.latitude === undefined) { return o; }
+    // Extract the track: the recent fixes as deltas from the previous one.
+    var count = bytes.readUInt8(end);
+    var shift = bytes.readUInt8(end + 1) >> 4;
+    var shiftAltitude = bytes.readUInt8(end + 1) & 0x0F;
+    var lat = raw.latitude;
+    var lon = raw.longitude;
+    var alt = raw.altitude;
+    var age = 0;
+    o.track = [];
+    for(var k = 0; k < count && end + 2 + 4 * k + 4 <= size; k++) {
+      var offset = end + 2 + 4 * k;
+      age += bytes.readUInt8(offset);
+      lat += bytes.readInt8(offset + 1) * Math.pow(2, shift);
+      lon += bytes.readInt8(offset + 2) * Math.pow(2, shift);
+      alt += bytes.readInt8(offset + 3) * Math.pow(2, shiftAltitude);
+      o.track.push({
+        age: age,
+        latitude: Math.round(lat * 90 / MaxNorthPosition * 1000000) / 1000000,
+        longitude: Math.round(lon * 180 / MaxEastPosition * 1000000) / 1000000,
+        altitude: alt
+      });
+    }
   }
   return o;
 }
@@ -79,7 +339,15 @@ function Decode(fPort, bytes, variables) {
 
 var l = p.metadata.network.lora;
 
-var o = Decode(l.port,p.frmPayload,undefined);
+// History of the frames of each device (one topic per device), for the parity fields.
+var histories = context.get("parity") || {};
+if(! histories[msg.topic]) {
+  histories[msg.topic] = { fixes: {}, parities: {} };
+}
+
+var o = Decode(l.port,p.frmPayload,undefined,histories[msg.topic]);
+
+context.set("parity", histories);
 
 msg.payload.object = o;
 
@@ -35,11 +35,162 @@ function readInt32BE(buf, offset, byteLength) {
     return val;
 }
 
+function readUIntBE(buf, offset, byteLength) {
+    offset = offset >>> 0;
+    byteLength = byteLength >>> 0;
+
+    var val = 0;
+    for (var i = 0; i < byteLength; i++) {
+        val = val * 0x100 + buf[offset + i];
+    }
+    return val;
+}
+
 function readUInt8(buf, offset) {
     offset = offset >>> 0;
     return (buf[offset]);
 }
 
+// BEGIN PAYLOAD_FIELDS (generated from payload_fields.h by `make codec`)
+var PAYLOAD_FIELDS = [
+    ["txpower", 0, 1, 1],
+    ["dataRate", 0, 1, 1],
+    ["latitude", 1, 3, (8388607 / 90.0)],
+    ["longitude", 1, 3, (8388607 / 180.0)],
+    ["altitude", 0, 2, 1],
+    ["temperature", 1, 2, 100],
+    ["ttff", 0, 2, 1],
+    ["downlinkCount", 0, 1, 1],
+    ["downlinkFcnt", 0, 2, 1],
+    ["downlinkRssi", 0, 1, -1],
+    ["downlinkSnr", 1, 1, 1],
+];
+var PAYLOAD_FIELDS_V0 = [
+    ["txpower", 0, 1, 1],
+    ["dataRate", 0, 1, 1],
+    ["temperature", 1, 2, 100],
+    ["latitude", 1, 3, (8388607 / 90.0)],
+    ["longitude", 1, 3, (8388607 / 180.0)],
+    ["altitude", 0, 2, 1],
+    ["ttff", 0, 2, 1],
+];
+var PARITY_WINDOW = 0;
+// END PAYLOAD_FIELDS
+
+// Decode the fixed fields of the layout present in the payload into o (scaled)
+// and raw, and return the offset of the variable fields.
+function decodeFields(buf, fields, o, raw) {
+    var offset = 0;
+    for (var f = 0; f < fields.length; f++) {
+        var field = fields[f];
+        if (offset + field[2] > buf.length) { break; }
+        raw[field[0]] = field[1] ? readInt32BE(buf, offset, field[2]) : readUIntBE(buf, offset, field[2]);
+        o[field[0]] = raw[field[0]] / field[3];
+        offset += field[2];
+    }
+    // The format shares the first byte with the txpower idx.
+    if (raw.txpower !== undefined) {
+        raw.txpower &= 0x0F;
+        o.txpower = raw.txpower;
+    }
+    return offset;
+}
+
+// Format of the payload, in the 4 high bits of the first byte: the former
+// layout of the fixed fields (PAYLOAD_FIELDS_V0), the bit-packed payload and
+// the fixed fields.
+var PAYLOAD_FORMAT_FIELDS_V0 = 0;
+var PAYLOAD_FORMAT_PACKED = 1;
+var PAYLOAD_FORMAT_FIELDS = 2;
+
+// Bit-packed payload (PAYLOAD_PACKED=1 on the device): the anchor and the
+// resolution of the positions are those of the firmware, or the device
+// variables anchorLatitude, anchorLongitude and positionShift (Chirpstack).
+var PACKED_ANCHOR_LATITUDE = 45.1934;
+var PACKED_ANCHOR_LONGITUDE = 5.7674;
+var PACKED_POSITION_SHIFT = 7;
+
+// Read a field of the bit-packed payload, from its first bit.
+function readBits(buf, bit, width, signed) {
+    var val = 0;
+    for (var i = bit; i < bit + width; i++) {
+        val = val * 2 + ((buf[i >> 3] >> (7 - (i & 7))) & 1);
+    }
+    if (signed && val >= Math.pow(2, width - 1)) val -= Math.pow(2, width);
+    return val;
+}
+
+// Position of the anchor in the 24-bit encoding.
+function anchorBinary(degrees, range) {
+    return (degrees < 0 ? -1 : 1) * Math.round(Math.abs(degrees) * 8388607 / range);
+}
+
+function decodePacked(bytes, o, variables) {
+    var v = variables || {};
+    var anchorLatitude = v.anchorLatitude !== undefined ? parseFloat(v.anchorLatitude) : PACKED_ANCHOR_LATITUDE;
+    var anchorLongitude = v.anchorLongitude !== undefined ? parseFloat(v.anchorLongitude) : PACKED_ANCHOR_LONGITUDE;
+    var shift = v.positionShift !== undefined ? parseInt(v.positionShift, 10) : PACKED_POSITION_SHIFT;
+
+    o.format = "packed";
+    o.txpower = readBits(bytes, 4, 4, false);
+    o.dataRate = readBits(bytes, 8, 4, false);
+    o.gain = (5 - o.dataRate) * 2 + ((o.txpower - 2) * 2 / 3.0);
+    o.temperature = readBits(bytes, 12, 12, true) / 10.0;
+    var dlat = readBits(bytes, 24, 12, true);
+    var dlon = readBits(bytes, 36, 12, true);
+    if (!((dlat === -2048) && (dlon === -2048))) {
+        var lat = anchorBinary(anchorLatitude, 90) + dlat * Math.pow(2, shift);
+        var lon = anchorBinary(anchorLongitude, 180) + dlon * Math.pow(2, shift);
+        o.latitude = Math.round(lat * 90 / 8388607 * 1000000) / 1000000;
+        o.longitude = Math.round(lon * 180 / 8388607 * 1000000) / 1000000;
+        o.altitude = readBits(bytes, 48, 16, false) * 2;
+    }
+    return o;
+}
+
+// Stats frames of the transmissions (TXSTATS_PORT on the device, see txstats.h).
+var TXSTATS_PORT = 210;
+var TXSTATS_RETURN_CODES = [
+    "JOIN_SUCCEEDED", "JOIN_FAILED", "NOT_JOINED", "ALREADY_JOINED", "TX_OK",
+    "TX_SCHEDULE", "TX_DONE", "TX_CNF_FAILED", "TX_ERROR", "RX_DATA",
+    "RX_LINK_CHECK", "RX_CONFIRMED", "BUSY", "DUTYCYCLE_RESTRICTED"
+];
+
+// Counters of the bits set in a bitmap, keyed by name (or index).
+function decodeTxStatsCounters(bytes, offset, names, counters) {
+    if (offset + 2 > bytes.length) { return bytes.length; }
+    var bitmap = readUInt16BE(bytes, offset);
+    offset += 2;
+    for (var i = 0; i < 16; i++) {
+        if ((bitmap & (1 << i)) && offset + 2 <= bytes.length) {
+            counters[(names && names[i]) || i] = readUInt16BE(bytes, offset);
+            offset += 2;
+        }
+    }
+    return offset;
+}
+
+function decodeTxStats(bytes, o) {
+    o.statsIndex = readUInt8(bytes, 0);
+    o.sequences = readUInt8(bytes, 1);
+    o.returnCodes = {};
+    o.dataRates = {};
+    o.txpowers = {};
+    var offset = decodeTxStatsCounters(bytes, 2, TXSTATS_RETURN_CODES, o.returnCodes);
+    offset = decodeTxStatsCounters(bytes, offset, undefined, o.dataRates);
+    offset = decodeTxStatsCounters(bytes, offset, undefined, o.txpowers);
+    // Buckets [0, 64), [64, 128), ... [4096, inf) ms, then [0, 1), [1, 2), ... [64, inf) ms.
+    o.sendHistogram = [];
+    o.delayHistogram = [];
+    for (var k = 0; k < 8 && offset + k < bytes.length; k++) {
+        o.sendHistogram.push(readUInt8(bytes, offset + k));
+    }
+    for (k = 0; k < 8 && offset + 8 + k < bytes.length; k++) {
+        o.delayHistogram.push(readUInt8(bytes, offset + 8 + k));
+    }
+    return o;
+}
+
 // Chirpstack
 // Decode decodes an array of bytes into an object.
 //  - fPort contains the LoRaWAN fPort number
@@ -52,40 +203,77 @@ function Decode(fPort, bytes, variables) {
 
     if (fPort === 202) {
         // TODO
+    } else if (fPort === TXSTATS_PORT) {
+        if (bytes.length >= 2) {
+            decodeTxStats(bytes, o);
+        }
     } else {
         var size = bytes.length;
         o.size = size;
 
-        if (size < 2) { return o; }
+        var format = (size > 0) ? bytes[0] >> 4 : PAYLOAD_FORMAT_FIELDS;
+        if (size >= 8 && format === PAYLOAD_FORMAT_PACKED) {
+            return decodePacked(bytes, o, variables);
+        }
+        if (format !== PAYLOAD_FORMAT_FIELDS && format !== PAYLOAD_FORMAT_FIELDS_V0) {
+            o.format = format;
+            return o;
+        }
+
+        var raw = {};
+        var end = decodeFields(bytes, (format === PAYLOAD_FORMAT_FIELDS_V0) ? PAYLOAD_FIELDS_V0 : PAYLOAD_FIELDS, o, raw);
+        if (end < 2) { return o; }
 
-        // Extract LoRa settings.
-        o.txpower = readUInt8(bytes, 0);
-        o.dataRate = readUInt8(bytes, 1);
+        // LoRa settings.
         o.gain = (5 - o.dataRate) * 2 + ((o.txpower - 2) * 2 / 3.0);
 
-        if (size < 4) { return o; }
-        // Extract temperature.
-        o.temperature = readUInt16BE(bytes, 2) / 100.0;
-
-        if (size < 12) { return o; }
+        if (raw.longitude === undefined) { return o; }
 
         // Value used for the conversion of the position from DMS to decimal.
         var MaxNorthPosition = 8388607; // 2^23 - 1
         var MaxEastPosition = 8388607; // 2^23 - 1
 
-        var Latitude = (readInt32BE(bytes, 4) >> 8);
-        var Longitude = (readInt32BE(bytes, 7) >> 8);
-        if (!((Latitude === 0) && (Longitude === 0))) {
-            // Extract latitude.
-            Latitude = Latitude * 90 / MaxNorthPosition;
-            o.latitude = Math.round(Latitude * 1000000) / 1000000;
+        if ((raw.latitude === 0) && (raw.longitude === 0)) {
+            // No fix.
+            delete o.latitude;
+            delete o.longitude;
+            delete o.altitude;
+        } else {
+            o.latitude = Math.round(o.latitude * 1000000) / 1000000;
+            o.longitude = Math.round(o.longitude * 1000000) / 1000000;
+        }
+
+        // The time to first fix since boot (in seconds).
+        if (o.ttff === 0xFFFF) {
+            delete o.ttff;
+        }
 
-            // Extract longitude.
-            Longitude = Longitude * 180 / MaxEastPosition;
-            o.longitude = Math.round(Longitude * 1000000) / 1000000;
+        // The parity fields (PAYLOAD_PARITY on the device) are left as is: the
+        // positions of the lost frames are rebuilt from the previous frames of
+        // the device by codec/decode.js.
 
-            // Extract altitude.
-            o.altitude = readUInt16BE(bytes, 10);
+        if (end + 2 > size || raw.ttff === undefined || o.latitude === undefined) { return o; }
+        // Extract the track: the recent fixes as deltas from the previous one.
+        var count = readUInt8(bytes, end);
+        var shift = readUInt8(bytes, end + 1) >> 4;
+        var shiftAltitude = readUInt8(bytes, end + 1) & 0x0F;
+        var lat = raw.latitude;
+        var lon = raw.longitude;
+        var alt = raw.altitude;
+        var age = 0;
+        o.track = [];
+        for (var k = 0; k < count && end + 2 + 4 * k + 4 <= size; k++) {
+            var offset = end + 2 + 4 * k;
+            age += readUInt8(bytes, offset);
+            lat += readInt32BE(bytes, offset + 1, 1) * Math.pow(2, shift);
+            lon += readInt32BE(bytes, offset + 2, 1) * Math.pow(2, shift);
+            alt += readInt32BE(bytes, offset + 3, 1) * Math.pow(2, shiftAltitude);
+            o.track.push({
+                age: age,
+                latitude: Math.round(lat * 90 / MaxNorthPosition * 1000000) / 1000000,
+                longitude: Math.round(lon * 180 / MaxEastPosition * 1000000) / 1000000,
+                altitude: alt
+            });
         }
     }
     return o;
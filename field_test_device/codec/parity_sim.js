@@ -0,0 +1,134 @@
+/*
+ * Simulation of the parity fields (PAYLOAD_PARITY) on a lossy link
+ *  Author: Didier DONSEZ (Université Grenoble Alpes)
+ *
+ * The frames of a device are lost according to a Gilbert-Elliott model (bursts
+ * of losses), and the received ones are decoded by the PARITY section of
+ * codec/decode.js. The delivery rate of the positions is printed for each
+ * number of previous positions covered by the parity.
+ *
+ * Usage: node codec/parity_sim.js [frames] [seed]
+ */
+
+var fs = require("fs");
+var path = require("path");
+
+var FRAMES = parseInt(process.argv[2] || "20000", 10);
+var SEED = parseInt(process.argv[3] || "1", 10);
+
+// Bytes of the parity fields in each frame (paritySequence, parityLatitude,
+// parityLongitude and parityAltitude).
+var PARITY_LEN = 1 + 3 + 3 + 2;
+
+var WINDOWS = [0, 1, 2, 4, 8, 16];
+
+// Loss rates and mean lengths of the bursts of losses.
+var CHANNELS = [
+  [0.10, 1], [0.10, 4], [0.30, 2], [0.30, 5], [0.50, 5], [0.30, 20]
+];
+
+// Decoder of codec/decode.js, for a number of previous positions.
+var source = fs.readFileSync(path.join(__dirname, "decode.js"), "utf8");
+var section = source.substring(source.indexOf("// BEGIN PARITY"), source.indexOf("// END PARITY"));
+function decoder(window) {
+  return new Function("PARITY_WINDOW", section + "\nreturn parityAdd;")(window);
+}
+
+// Deterministic pseudo-random numbers in [0, 1) (mulberry32).
+function random(seed) {
+  var state = seed >>> 0;
+  return function () {
+    state = (state + 0x6D2B79F5) >>> 0;
+    var t = state;
+    t = Math.imul(t ^ (t >>> 15), t | 1);
+    t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+    return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+  };
+}
+
+// Position fields of the frames of a balloon flight (24, 24 and 16 bits).
+function flight(n, rand) {
+  var fixes = [];
+  var lat = 4215000, lon = 275000, alt = 200;
+  for (var i = 0; i < n; i++) {
+    lat += Math.round((rand() - 0.3) * 400);
+    lon += Math.round((rand() - 0.3) * 800);
+    alt = Math.max(0, Math.min(0xFFFF, alt + Math.round((rand() - 0.2) * 50)));
+    fixes.push([lat & 0xFFFFFF, lon & 0xFFFFFF, alt]);
+  }
+  return fixes;
+}
+
+// Parity fields of the frames, as payload_parity.c.
+function encode(fixes, window) {
+  var frames = [];
+  var sequence = 0;
+  for (var i = 0; i < fixes.length; i++) {
+    var parity = [0, 0, 0];
+    for (var j = 1; j <= window && i - j >= 0; j++) {
+      parity[0] ^= fixes[i - j][0];
+      parity[1] ^= fixes[i - j][1];
+      parity[2] ^= fixes[i - j][2];
+    }
+    frames.push({ sequence: sequence, fix: fixes[i], parity: parity });
+    sequence = (sequence === 0xFF) ? window : sequence + 1;
+  }
+  return frames;
+}
+
+// Received frames of the Gilbert-Elliott channel.
+function channel(n, loss, burst, rand) {
+  var leave = 1 / burst;
+  var enter = loss * leave / (1 - loss);
+  var bad = rand() < loss;
+  var received = [];
+  for (var i = 0; i < n; i++) {
+    received.push(!bad);
+    bad = bad ? rand() >= leave : rand() < enter;
+  }
+  return received;
+}
+
+function simulate(fixes, received, window) {
+  var delivered = received.slice();
+  var wrong = 0;
+  if (window > 0) {
+    var frames = encode(fixes, window);
+    var parityAdd = decoder(window);
+    var history = { fixes: {}, parities: {} };
+    for (var i = 0; i < frames.length; i++) {
+      if (!received[i]) { continue; }
+      var rebuilt = parityAdd(history, frames[i].sequence, frames[i].fix, frames[i].parity);
+      for (var r = 0; r < rebuilt.length; r++) {
+        var k = i - rebuilt[r][0];
+        if (rebuilt[r][1].join() !== fixes[k].join()) { wrong++; }
+        delivered[k] = true;
+      }
+    }
+  }
+  var count = delivered.filter(function (d) { return d; }).length;
+  return { rate: count / fixes.length, wrong: wrong };
+}
+
+var rand = random(SEED);
+var fixes = flight(FRAMES, rand);
+
+console.log("frames: " + FRAMES + ", parity fields: " + PARITY_LEN + " bytes per frame with PAYLOAD_PARITY > 0");
+console.log("");
+var header = "loss  burst |";
+for (var w = 0; w < WINDOWS.length; w++) { header += "  K=" + ("" + WINDOWS[w] + " ").substring(0, 2) + "  "; }
+console.log(header);
+for (var c = 0; c < CHANNELS.length; c++) {
+  var loss = CHANNELS[c][0], burst = CHANNELS[c][1];
+  var received = channel(FRAMES, loss, burst, rand);
+  var line = (loss * 100).toFixed(0) + "%   " + ("  " + burst).slice(-3) + "   |";
+  for (var w = 0; w < WINDOWS.length; w++) {
+    var result = simulate(fixes, received, WINDOWS[w]);
+    if (result.wrong > 0) {
+      console.error("K=" + WINDOWS[w] + ": " + result.wrong + " wrong positions");
+      process.exitCode = 1;
+    }
+    line += " " + (result.rate * 100).toFixed(1) + "% ";
+  }
+  console.log(line);
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Link measurements of the last downlink.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#include "downlink.h"
+
+#include <stdatomic.h>
+
+// Double buffer: the receiver thread fills the slot the readers do not use,
+// then bumps the sequence, whose parity gives the published slot.
+static downlink_info_t downlink_infos[2];
+static atomic_uint downlink_seq;
+
+void downlink_publish(uint32_t fcnt_down, int16_t rssi, int8_t snr)
+{
+	unsigned int seq = atomic_load_explicit(&downlink_seq, memory_order_relaxed);
+	downlink_info_t *next = &downlink_infos[(seq + 1) & 1];
+
+	next->count = downlink_infos[seq & 1].count + 1;
+	next->fcnt_down = fcnt_down;
+	next->rssi = rssi;
+	next->snr = snr;
+	atomic_store_explicit(&downlink_seq, seq + 1, memory_order_release);
+}
+
+void downlink_get(downlink_info_t *info)
+{
+	unsigned int seq;
+
+	// Retry only if the receiver thread has published during the copy.
+	do {
+		seq = atomic_load_explicit(&downlink_seq, memory_order_acquire);
+		*info = downlink_infos[seq & 1];
+		atomic_thread_fence(memory_order_acquire);
+	} while (atomic_load_explicit(&downlink_seq, memory_order_relaxed) != seq);
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Link measurements of the last downlink.
+ *
+ * The receiver thread is the only writer, and publishes them in a double
+ * buffer with a sequence counter (stdatomic, as the GPS and sensor
+ * snapshots): the readers copy the published slot without lock, and retry
+ * if the sequence has changed during the copy. The receiver thread has a
+ * higher priority than the sender, so an update is never preempted by a
+ * reader.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef DOWNLINK_H
+#define DOWNLINK_H
+
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Measurements of the last downlink.
+ */
+typedef struct {
+	uint32_t count;			// number of downlinks since boot (0 before the first one)
+	uint32_t fcnt_down;		// frame counter
+	int16_t rssi;			// in dBm
+	int8_t snr;				// in dB
+} downlink_info_t;
+
+/**
+ * Publish the measurements of a new downlink (from the receiver thread only).
+ *
+ * @param fcnt_down the frame counter of the downlink
+ * @param rssi the RSSI in dBm
+ * @param snr the SNR in dB
+ */
+extern void downlink_publish(uint32_t fcnt_down, int16_t rssi, int8_t snr);
+
+/**
+ * Get the measurements of the last downlink (never blocks the writer).
+ *
+ * @param info the measurements
+ */
+extern void downlink_get(downlink_info_t *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DOWNLINK_H */
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Sequence of the <dr, txpower, size> triplets of the benchmark.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include <string.h>
+
+#include "mutex.h"
+
+#include "semtech_loramac.h"
+#include "loramac_utils.h"
+#include "drpwsz.h"
+
+static uint8_t drpwsz_buffers[2][3 * DRPWSZ_MAX];
+static uint8_t drpwsz_nb[2];
+static uint8_t drpwsz_active = 0;
+static bool drpwsz_pending = false;
+
+// Held by the downlink while it writes the inactive buffer, and by the swap.
+static mutex_t drpwsz_lock = MUTEX_INIT;
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF).
+static uint16_t drpwsz_crc16(const uint8_t *buf, unsigned int len)
+{
+	uint16_t crc = 0xFFFF;
+	for (unsigned int i = 0; i < len; i++) {
+		crc ^= (uint16_t)buf[i] << 8;
+		for (int b = 0; b < 8; b++) {
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+		}
+	}
+	return crc;
+}
+
+void drpwsz_init(const uint8_t *sequence, uint8_t nb)
+{
+	if (nb > DRPWSZ_MAX) {
+		nb = DRPWSZ_MAX;
+	}
+	mutex_lock(&drpwsz_lock);
+	memcpy(drpwsz_buffers[0], sequence, 3 * nb);
+	drpwsz_nb[0] = nb;
+	drpwsz_active = 0;
+	drpwsz_pending = false;
+	mutex_unlock(&drpwsz_lock);
+}
+
+bool drpwsz_process_downlink(const uint8_t *payload, uint8_t len)
+{
+	if (len < 3 + 2 || (len - 2) % 3 != 0 || (len - 2) / 3 > DRPWSZ_MAX) {
+		DEBUG("[drpwsz] bad size %d\n", len);
+		return false;
+	}
+	uint8_t nb = (len - 2) / 3;
+	uint16_t crc = ((uint16_t)payload[len - 2] << 8) | payload[len - 1];
+	if (drpwsz_crc16(payload, len - 2) != crc) {
+		DEBUG("[drpwsz] bad CRC %04x\n", crc);
+		return false;
+	}
+	// The sequence is applied only if every triplet is valid.
+	for (unsigned int i = 0; i < nb; i++) {
+		uint8_t dr = payload[3 * i];
+		uint8_t txpower = payload[3 * i + 1];
+		uint8_t size = payload[3 * i + 2];
+		uint8_t max_size = (dr != 0xff) ? loramac_utils_max_payload_size(dr) : 0xff;
+		if (max_size == 0) {
+			DEBUG("[drpwsz] bad datarate %d in triplet %d\n", dr, i);
+			return false;
+		}
+		if (txpower >= 16) {
+			DEBUG("[drpwsz] bad txpower %d in triplet %d\n", txpower, i);
+			return false;
+		}
+		// 255 stands for the maximum size of the datarate.
+		if (size == 0 || (size > max_size && size != 0xff)) {
+			DEBUG("[drpwsz] bad size %d in triplet %d\n", size, i);
+			return false;
+		}
+	}
+
+	mutex_lock(&drpwsz_lock);
+	uint8_t inactive = drpwsz_active ^ 1;
+	memcpy(drpwsz_buffers[inactive], payload, 3 * nb);
+	drpwsz_nb[inactive] = nb;
+	drpwsz_pending = true;
+	mutex_unlock(&drpwsz_lock);
+
+	DEBUG("[drpwsz] new sequence of %d triplets for the next benchmark sequence\n", nb);
+	return true;
+}
+
+uint8_t drpwsz_swap(const uint8_t **sequence)
+{
+	mutex_lock(&drpwsz_lock);
+	if (drpwsz_pending) {
+		drpwsz_active ^= 1;
+		drpwsz_pending = false;
+		DEBUG("[drpwsz] swap to the new sequence\n");
+	}
+	uint8_t active = drpwsz_active;
+	mutex_unlock(&drpwsz_lock);
+
+	// Only the downlinks write, and into the other buffer.
+	*sequence = drpwsz_buffers[active];
+	return drpwsz_nb[active];
+}
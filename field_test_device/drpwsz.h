@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Sequence of the <dr, txpower, size> triplets of the benchmark.
+ *
+ * The sequence is double-buffered: a downlink writes a new sequence into the
+ * inactive buffer, and the benchmark swaps the buffers at the end of its
+ * current sequence, so the running sequence is never modified.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef DRPWSZ_H
+#define DRPWSZ_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef DRPWSZ_MAX
+// Maximum number of triplets of a sequence.
+#define DRPWSZ_MAX	32
+#endif
+
+/**
+ * Set the initial sequence.
+ *
+ * @param sequence the triplets
+ * @param nb the number of triplets (at most DRPWSZ_MAX)
+ */
+extern void drpwsz_init(const uint8_t *sequence, uint8_t nb);
+
+/**
+ * Process a downlink with a new sequence: the triplets followed by their
+ * CRC-16/CCITT-FALSE (big endian). The sequence replaces a pending one.
+ *
+ * @param payload the payload of the downlink
+ * @param len the length of the payload
+ *
+ * @return false if the payload is rejected (size, CRC, or a datarate, a
+ *         txpower or a size of a triplet)
+ */
+extern bool drpwsz_process_downlink(const uint8_t *payload, uint8_t len);
+
+/**
+ * Swap to the pending sequence if any (called by the benchmark between two
+ * sequences), and get the current one.
+ *
+ * @param sequence the triplets of the current sequence
+ *
+ * @return the number of triplets
+ */
+extern uint8_t drpwsz_swap(const uint8_t **sequence);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DRPWSZ_H */
@@ -9,26 +9,76 @@ This file is based on LoRaMAC-node from Semtech, under Revised BSD License.
 #ifdef GPS
 
 #include "gps.h"
+#if GPS_PROTOCOL_UBX == 1
+#include "ubx.h"
+#endif
 
-#include <mutex.h>
+#include <xtimer.h>
 
+#include <stdatomic.h>
 #include <string.h>
 #include <stdlib.h>
 
 
-// Various type of NMEA data we can receive with the GPS.
-static const char NmeaDataTypeGPGGA[] = "GPGGA";
-static const char NmeaDataTypeGPRMC[] = "GPRMC";
-// TODO process messages GPGLL : Latitude, longitude, UTC time of position fix and status.
-// TODO process messages GPGSA : GPS receiver operating mode, satellites used in the position solution, and DOP values.
-// TODO process messages GPGSV : The number of GPS satellites in view satellite ID numbers, elevation, azimuth, and SNR values.
-// TODO process messages GPMSS : Signal-to-noise ratio, signal strength, frequency, and bit rate from a radio-beacon receiver.
-// TODO process messages GPRMC : Time, date, position, course and speed data.
-// TODO process messages GPVTG : Course and speed information relative to the ground.
-// TODO process messages GPZDA : PPS timing message (synchronized to PPS).
-
-
-// TODO process messages from BD ou GB - Beidou ; GA - Galileo ; GL - GLONASS.
+// Longest NMEA sentence accepted (82 characters in the standard).
+#define NMEA_MAX_LENGTH     100
+
+// Maximum number of decimals kept for a numerical field.
+#define NMEA_MAX_DECIMALS   4
+
+// Various type of NMEA sentences we can receive with the GPS, whatever the
+// talker ID (GP - GPS, GL - GLONASS, GA - Galileo, BD or GB - Beidou,
+// GN - multi-constellation).
+enum {
+    NMEA_NONE = 0,
+    NMEA_GGA,  // Time, position and fix related data.
+    NMEA_RMC,  // Time, date, position, course and speed data.
+    NMEA_GSA,  // Receiver operating mode, satellites used and DOP values.
+    NMEA_GSV,  // Number of satellites in view.
+    NMEA_VTG,  // Course and speed information relative to the ground.
+    NMEA_ZDA,  // Time and date.
+};
+// TODO process messages GLL : Latitude, longitude, UTC time of position fix and status.
+
+static const struct {
+    char type[3];
+    uint8_t sentence;
+} nmea_sentences[] = {
+    { "GGA", NMEA_GGA },
+    { "RMC", NMEA_RMC },
+    { "GSA", NMEA_GSA },
+    { "GSV", NMEA_GSV },
+    { "VTG", NMEA_VTG },
+    { "ZDA", NMEA_ZDA },
+};
+
+// States of the NMEA parser.
+enum {
+    NMEA_IDLE = 0,       // Waiting for a '$'.
+    NMEA_ADDRESS,        // Reading the talker ID and the sentence type.
+    NMEA_FIELDS,         // Reading the comma-separated fields.
+    NMEA_CHECKSUM_HIGH,  // Reading the first hex digit after the '*'.
+    NMEA_CHECKSUM_LOW,   // Reading the second hex digit after the '*'.
+};
+
+// Context of the NMEA parser: the sentence is decoded field by field as the
+// bytes arrive, so that no line buffer is needed.
+typedef struct {
+    uint8_t state;
+    uint8_t sentence;       // Type of the sentence being parsed.
+    uint8_t length;         // Number of characters received in the sentence.
+    uint8_t checksum;       // Running XOR of the characters.
+    uint8_t expected;       // Checksum received after the '*'.
+    uint8_t field;          // Index of the current field (0 is the address).
+    uint8_t field_length;   // Number of characters of the current field.
+    char first;             // First character of the current field.
+    char type[3];           // Sentence type (the address without talker ID).
+    bool negative;          // The current field starts with a '-'.
+    int8_t decimals;        // Number of decimals read (-1 before the '.').
+    uint32_t value;         // Digits of the current field.
+    uint32_t position;      // Latitude or longitude waiting for its pole.
+    gps_data_t data;        // Copy of the GPS data updated by the sentence.
+} nmea_parser_t;
 
 
 // Value used for the conversion of the position from DMS to decimal.
@@ -37,276 +87,696 @@ static const int32_t MaxSouthPosition = 8388608;  // -2^23
 static const int32_t MaxEastPosition  = 8388607;  // 2^23 - 1
 static const int32_t MaxWestPosition  = 8388608;  // -2^23
 
-// GPS data in ASCII and numrical formats.
-gps_nmea_t gps_nmea;
-gps_data_t gps_data;
+// Snapshot of the GPS data published by the parser.
+typedef struct {
+    gps_data_t data;        // GPS data in numerical format.
+    gps_fix_t fix;          // Last valid fix.
+    uint8_t history_head;   // Next slot of the history.
+    uint8_t history_count;  // Number of fixes in the history.
+    uint32_t first_fix;     // Time of the first fix since boot in ms.
+} gps_snapshot_t;
+
+// The snapshot is double-buffered (seqlock latch): the parser only writes the
+// slot readers do not use, then bumps the sequence, so a reader never waits
+// for the writer. A reader retries only if the sequence has changed during
+// its copy, which requires the writer to preempt it.
+static gps_snapshot_t gps_snapshots[2];
+static atomic_uint gps_seq;
+
+// History of the fixes, with a spare slot: the slot being written is never
+// part of the published history.
+static gps_fix_t gps_history[GPS_HISTORY_SIZE + 1];
+
+// Unique instance of the NMEA parser.
+static nmea_parser_t nmea_parser;
+
+#if GPS_PROTOCOL_UBX == 1
+// Unique instance of the UBX parser.
+static ubx_parser_t ubx_parser;
+#endif
+
+
+// Current time in ms.
+static uint32_t gps_now_ms(void)
+{
+    return xtimer_now_usec64() / US_PER_MS;
+}
+
+
+// Snapshot currently published (only for the writer).
+static const gps_snapshot_t *gps_current(void)
+{
+    return &gps_snapshots[atomic_load_explicit(&gps_seq, memory_order_relaxed) & 1];
+}
+
+
+// Publish new GPS data (single writer). The fix is only updated by the
+// sentences that carry a position (`position`), the others only carry the
+// previous `has_fix` over.
+static void gps_publish(const gps_data_t *data, bool position)
+{
+    unsigned int seq = atomic_load_explicit(&gps_seq, memory_order_relaxed);
+    const gps_snapshot_t *cur = &gps_snapshots[seq & 1];
+    gps_snapshot_t *next = &gps_snapshots[(seq + 1) & 1];
+
+    next->data = *data;
+    next->fix = cur->fix;
+    next->history_head = cur->history_head;
+    next->history_count = cur->history_count;
+    next->first_fix = cur->first_fix;
+
+    if (position && data->has_fix) {
+        next->fix.latitude_bin = data->latitude_bin;
+        next->fix.longitude_bin = data->longitude_bin;
+        next->fix.altitude = data->altitude;
+        next->fix.timestamp = gps_now_ms();
+        next->fix.age = 0;
+        if (next->first_fix == 0)
+            next->first_fix = next->fix.timestamp;
+
+        // Keep at most one fix per period in the history.
+        uint8_t last = (cur->history_head + GPS_HISTORY_SIZE) % (GPS_HISTORY_SIZE + 1);
+        if (cur->history_count == 0 ||
+            next->fix.timestamp - gps_history[last].timestamp >= GPS_HISTORY_PERIOD_MS) {
+            gps_history[cur->history_head] = next->fix;
+            next->history_head = (cur->history_head + 1) % (GPS_HISTORY_SIZE + 1);
+            if (next->history_count < GPS_HISTORY_SIZE)
+                next->history_count++;
+        }
+    }
+
+    atomic_store_explicit(&gps_seq, seq + 1, memory_order_release);
+}
 
-// Mutex that protect GPS data.
-static mutex_t gps_mutex = MUTEX_INIT;
 
+// Start reading the published snapshot.
+static unsigned int gps_read_begin(void)
+{
+    return atomic_load_explicit(&gps_seq, memory_order_acquire);
+}
 
-// Convert a nibble to hex char.
-static int8_t nibble_to_hex(uint8_t a)
+
+// Check whether the snapshot read since `seq` may be inconsistent.
+static bool gps_read_retry(unsigned int seq)
 {
-    if (a < 10)
-        return '0' + a;
-    else if (a < 16)
-        return 'A' + (a - 10);
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&gps_seq, memory_order_relaxed) != seq;
+}
+
+
+// Convert a hex char to a nibble (or return -1).
+static int8_t hex_to_nibble(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    else if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    else if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
     else
-        return '?';
+        return -1;
 }
 
 
 
-// Convert GPS positions from double to binary values.
-static void positions_to_binary(void)
+// Number of 1/10000 of minute in one degree.
+#define MINUTES_E4_PER_DEGREE  600000UL
+
+
+// Scale a position (in 1/10000 of minute) to the signed 24-bit encoding,
+// `range` being 90 or 180 degrees in the same unit. The result is truncated
+// toward zero, bit-exact with the former floating point conversion.
+static int32_t minutes_e4_to_binary(uint32_t value, bool negative,
+                                    int32_t max_positive, int32_t max_negative,
+                                    uint32_t range)
 {
-    long double temp;
+    if (negative)
+        return -(int32_t)(((uint64_t)value * (uint32_t)max_negative) / range);
+    return (int32_t)(((uint64_t)value * (uint32_t)max_positive) / range);
+}
 
-    if (gps_data.latitude >= 0) { // North
-        temp = gps_data.latitude * MaxNorthPosition;
-        gps_data.latitude_bin = temp / 90;
-    } else {                      // South
-        temp = gps_data.latitude * MaxSouthPosition;
-        gps_data.latitude_bin = temp / 90;
-    }
 
-    if (gps_data.longitude >= 0) { // East
-        temp = gps_data.longitude * MaxEastPosition;
-        gps_data.longitude_bin = temp / 180;
-    } else {                       // West
-        temp = gps_data.longitude * MaxWestPosition;
-        gps_data.longitude_bin = temp / 180;
-    }
+// Return the value of the current field with `decimals` decimals.
+static uint32_t nmea_field_value(const nmea_parser_t *p, uint8_t decimals)
+{
+    uint32_t value = p->value;
+    int8_t d = (p->decimals < 0) ? 0 : p->decimals;
+
+    for (; d < decimals; d++)
+        value *= 10;
+    for (; d > decimals; d--)
+        value /= 10;
+    return value;
+}
+
+
+// Convert the current (d)ddmm.mmmm field into 1/10000 of minute.
+static uint32_t nmea_field_position(const nmea_parser_t *p)
+{
+    uint32_t value = nmea_field_value(p, 4);  // (d)ddmmmmmm
+    return (value / 1000000) * MINUTES_E4_PER_DEGREE + (value % 1000000);
 }
 
 
-// Convert GPS positions from ASCII to double values.
-static void positions_to_double(void)
+// Store the current hhmmss.ss field as the UTC time.
+static void nmea_field_time(nmea_parser_t *p)
 {
-    double valueTmp1, valueTmp2, valueTmp3, valueTmp4;
+    if (p->field_length == 0)
+        return;
 
-    // Convert the latitude from ASCII to uint8_t values.
-    for (int i = 0 ; i < 10 ; i++ )
-        gps_nmea.latitude[i] = gps_nmea.latitude[i] & 0xF;
+    uint32_t value = nmea_field_value(p, 0);  // hhmmss
+    p->data.hour = value / 10000;
+    p->data.minute = (value / 100) % 100;
+    p->data.second = value % 100;
+}
 
-    // Convert latitude from degree/minute/second (DMS) format into decimal.
-    valueTmp1 = (double)gps_nmea.latitude[0] * 10.0 + (double)gps_nmea.latitude[1];
-    valueTmp2 = (double)gps_nmea.latitude[2] * 10.0 + (double)gps_nmea.latitude[3];
-    valueTmp3 = (double)gps_nmea.latitude[5] * 1000.0 + (double)gps_nmea.latitude[6] * 100.0 +
-                (double)gps_nmea.latitude[7] * 10.0 + (double)gps_nmea.latitude[8];
 
-    gps_data.latitude = valueTmp1 + ((valueTmp2 + (valueTmp3 * 0.0001)) / 60.0);
-    if (gps_nmea.latitude_pole[0] == 'S')
-        gps_data.latitude *= -1;
+// Store the current N/S field along with the pending latitude.
+static void nmea_field_latitude_pole(nmea_parser_t *p)
+{
+    p->data.latitude_bin = minutes_e4_to_binary(p->position,
+        p->first == 'S', MaxNorthPosition, MaxSouthPosition,
+        90 * MINUTES_E4_PER_DEGREE);
+}
 
-    // Convert the longitude from ASCII to uint8_t values.
-    for (int i = 0 ; i < 10 ; i++)
-        gps_nmea.longitude[i] = gps_nmea.longitude[i] & 0xF;
 
-    // Convert longitude from degree/minute/second (DMS) format into decimal.
-    valueTmp1 = (double)gps_nmea.longitude[0] * 100.0 + (double)gps_nmea.longitude[1] * 10.0 + (double)gps_nmea.longitude[2];
-    valueTmp2 = (double)gps_nmea.longitude[3] * 10.0 + (double)gps_nmea.longitude[4];
-    valueTmp3 = (double)gps_nmea.longitude[6] * 1000.0 + (double)gps_nmea.longitude[7] * 100;
-    valueTmp4 = (double)gps_nmea.longitude[8] * 10.0 + (double)gps_nmea.longitude[9];
+// Store the current E/W field along with the pending longitude.
+static void nmea_field_longitude_pole(nmea_parser_t *p)
+{
+    p->data.longitude_bin = minutes_e4_to_binary(p->position,
+        p->first == 'W', MaxEastPosition, MaxWestPosition,
+        180 * MINUTES_E4_PER_DEGREE);
+}
 
-    gps_data.longitude = valueTmp1 + (valueTmp2 / 60.0) + (((valueTmp3 + valueTmp4) * 0.0001) / 60.0);
-    if (gps_nmea.longitude_pole[0] == 'W')
-        gps_data.longitude *= -1;
+
+// Process a GGA field.
+static void nmea_end_GGA_field(nmea_parser_t *p)
+{
+    switch (p->field) {
+    case 1:  // UTC time.
+        nmea_field_time(p);
+        break;
+    case 2:  // Latitude.
+    case 4:  // Longitude.
+        p->position = nmea_field_position(p);
+        break;
+    case 3:  // Latitude pole.
+        nmea_field_latitude_pole(p);
+        break;
+    case 5:  // Longitude pole.
+        nmea_field_longitude_pole(p);
+        break;
+    case 6:  // Fix quality.
+        p->data.fix_quality = nmea_field_value(p, 0);
+        p->data.has_fix = (p->data.fix_quality > 0);
+        break;
+    case 7:  // Satellites tracked.
+        p->data.satellites_used = nmea_field_value(p, 0);
+        break;
+    case 8:  // Horizontal dilution.
+        p->data.hdop = nmea_field_value(p, 2);
+        break;
+    case 9:  // Altitude (in m).
+        if (p->data.has_fix && p->field_length > 0) {
+            int32_t altitude = nmea_field_value(p, 0);
+            p->data.altitude = p->negative ? -altitude : altitude;
+        }
+        break;
+    }
 }
 
 
+// Process a RMC field.
+static void nmea_end_RMC_field(nmea_parser_t *p)
+{
+    switch (p->field) {
+    case 1:  // UTC time.
+        nmea_field_time(p);
+        break;
+    case 2:  // Data status.
+        p->data.has_fix = (p->first == 'A');
+        break;
+    case 3:  // Latitude.
+    case 5:  // Longitude.
+        p->position = nmea_field_position(p);
+        break;
+    case 4:  // Latitude pole.
+        nmea_field_latitude_pole(p);
+        break;
+    case 6:  // Longitude pole.
+        nmea_field_longitude_pole(p);
+        break;
+    case 7:  // Speed over ground (in knots).
+        if (p->field_length > 0)
+            p->data.speed = nmea_field_value(p, 2) * 1852 / 10000;
+        break;
+    case 8:  // Course over ground (in degrees).
+        if (p->field_length > 0)
+            p->data.course = nmea_field_value(p, 1);
+        break;
+    case 9:  // Date (ddmmyy).
+        if (p->field_length > 0) {
+            uint32_t value = nmea_field_value(p, 0);
+            p->data.day = value / 10000;
+            p->data.month = (value / 100) % 100;
+            p->data.year = 2000 + value % 100;
+        }
+        break;
+    }
+}
+
 
-// Calculates the checksum for a NMEA sentence (and return the position of the
-// checksum in the sentence).
-static int32_t nmea_checksum(int8_t *nmeaStr, int32_t nmeaStrSize, int8_t *checksum)
+// Process a GSA field.
+static void nmea_end_GSA_field(nmea_parser_t *p)
 {
-    int i = 0;
-    uint8_t checkNum = 0;
+    switch (p->field) {
+    case 2:  // Fix mode (1 = none, 2 = 2D, 3 = 3D).
+        p->data.fix_mode = nmea_field_value(p, 0);
+        break;
+    case 15:  // Position dilution.
+        p->data.pdop = nmea_field_value(p, 2);
+        break;
+    case 16:  // Horizontal dilution.
+        p->data.hdop = nmea_field_value(p, 2);
+        break;
+    case 17:  // Vertical dilution.
+        p->data.vdop = nmea_field_value(p, 2);
+        break;
+    }
+}
 
-    if ((nmeaStr == NULL) || (checksum == NULL) || (nmeaStrSize <= 1))
-        return -1;
 
-    if (nmeaStr[i] == '$')
-        i += 1;  // Skip the first '$' if necessary.
+// Process a GSV field.
+static void nmea_end_GSV_field(nmea_parser_t *p)
+{
+    if (p->field == 3)  // Satellites in view.
+        p->data.satellites_in_view = nmea_field_value(p, 0);
+}
+
 
-    while (nmeaStr[i] != '*') {
-        checkNum ^= nmeaStr[i];  // XOR until '*' or max length is reached.
-        i += 1;
-        if (i >= nmeaStrSize)
-            return -1;
+// Process a VTG field.
+static void nmea_end_VTG_field(nmea_parser_t *p)
+{
+    if (p->field_length == 0)
+        return;
+
+    switch (p->field) {
+    case 1:  // Course over ground (true, in degrees).
+        p->data.course = nmea_field_value(p, 1);
+        break;
+    case 7:  // Speed over ground (in km/h).
+        p->data.speed = nmea_field_value(p, 1);
+        break;
     }
+}
 
-    // Convert checksum value to 2 hexadecimal characters.
-    checksum[0] = nibble_to_hex(checkNum / 16); // upper nibble
-    checksum[1] = nibble_to_hex(checkNum % 16); // lower nibble
-    return i + 1;
+
+// Process a ZDA field.
+static void nmea_end_ZDA_field(nmea_parser_t *p)
+{
+    if (p->field_length == 0)
+        return;
+
+    switch (p->field) {
+    case 1:  // UTC time.
+        nmea_field_time(p);
+        break;
+    case 2:  // Day.
+        p->data.day = nmea_field_value(p, 0);
+        break;
+    case 3:  // Month.
+        p->data.month = nmea_field_value(p, 0);
+        break;
+    case 4:  // Year.
+        p->data.year = nmea_field_value(p, 0);
+        break;
+    }
 }
 
 
-// Calculate the checksum of a NMEA frame and compare it to the checksum that
-// is present at the end of it (return true if it matches).
-static bool nmea_validate_checksum(int8_t *serialBuff, int32_t buffSize)
+// Process the field that has just been read.
+static void nmea_end_field(nmea_parser_t *p)
 {
-    int32_t checksumIndex;
-    int8_t checksum[2]; // 2 characters to calculate NMEA checksum.
+    switch (p->sentence) {
+    case NMEA_GGA: nmea_end_GGA_field(p); break;
+    case NMEA_RMC: nmea_end_RMC_field(p); break;
+    case NMEA_GSA: nmea_end_GSA_field(p); break;
+    case NMEA_GSV: nmea_end_GSV_field(p); break;
+    case NMEA_VTG: nmea_end_VTG_field(p); break;
+    case NMEA_ZDA: nmea_end_ZDA_field(p); break;
+    }
+}
+
 
-    checksumIndex = nmea_checksum(serialBuff, buffSize, checksum);
-    if (checksumIndex < 0)
-        return false;
+// Reset the accumulators of the current field.
+static void nmea_start_field(nmea_parser_t *p)
+{
+    p->field_length = 0;
+    p->first = 0;
+    p->negative = false;
+    p->decimals = -1;
+    p->value = 0;
+}
 
-    if (checksumIndex >= (buffSize - 2))
-        return false;  // Not enough char in the serial buffer to read checksum.
 
-    return  // Check the checksum.
-        (serialBuff[checksumIndex + 0] == checksum[0]) &&
-        (serialBuff[checksumIndex + 1] == checksum[1]);
+// Accumulate a character of the current field.
+static void nmea_add_char(nmea_parser_t *p, char c)
+{
+    if (p->field_length++ == 0)
+        p->first = c;
+
+    if (c >= '0' && c <= '9') {
+        if (p->decimals < 0) {
+            p->value = p->value * 10 + (c - '0');
+        } else if (p->decimals < NMEA_MAX_DECIMALS) {
+            p->value = p->value * 10 + (c - '0');
+            p->decimals++;
+        }
+    } else if (c == '.' && p->decimals < 0) {
+        p->decimals = 0;
+    } else if (c == '-') {
+        p->negative = true;
+    }
 }
 
 
-// Format GPS data.
-static void format_gps_data(void)
+// Find the sentence type in the address field (TTSSS).
+static uint8_t nmea_lookup(const nmea_parser_t *p)
 {
-    positions_to_double();
-    positions_to_binary();
+    if (p->field_length != 5)
+        return NMEA_NONE;  // Proprietary or malformed sentence.
 
-    if (gps_data.has_fix)
-        gps_data.altitude = atoi(gps_nmea.altitude);
+    for (unsigned int i = 0; i < sizeof(nmea_sentences) / sizeof(*nmea_sentences); i++)
+        if (memcmp(p->type, nmea_sentences[i].type, sizeof(p->type)) == 0)
+            return nmea_sentences[i].sentence;
+    return NMEA_NONE;
 }
 
 
+// Start the parsing of a new sentence.
+static void nmea_start(nmea_parser_t *p)
+{
+    p->state = NMEA_ADDRESS;
+    p->length = 0;
+    p->checksum = 0;
+    p->field = 0;
+    nmea_start_field(p);
 
-// Read a field from RX buffer.
-#define READ_FIELD(field, i, rxBuffer, maxSize)       \
-{                                                     \
-    uint8_t __fs = 0;                                 \
-    while ((rxBuffer)[(i) + __fs++] != ',')           \
-        if (__fs > (maxSize)) return GPS_FAIL;        \
-    for (uint8_t __j = 0; __j < __fs; __j++, (i)++)   \
-        (field)[__j] = (rxBuffer)[i];                 \
+    p->data = gps_current()->data;
 }
 
-// Read a field from RX buffer.
-#define SKIP_FIELD(i, rxBuffer, maxSize)              \
-{                                                     \
-    uint8_t __fs = 0;                                 \
-    while ((rxBuffer)[(i) + __fs++] != ',')           \
-        if (__fs > (maxSize)) return GPS_FAIL;        \
-    (i) += __fs;                                      \
+
+// Parse a byte of a NMEA sentence.
+static uint8_t nmea_parse_byte(char c)
+{
+    nmea_parser_t *p = &nmea_parser;
+    int8_t nibble;
+
+    if (c == '$') {
+        // A sentence being parsed is truncated.
+        uint8_t status = (p->state == NMEA_IDLE) ? GPS_PENDING : GPS_FAIL;
+        nmea_start(p);
+        return status;
+    }
+
+    if (p->state == NMEA_IDLE)
+        return GPS_PENDING;
+
+    if (++p->length > NMEA_MAX_LENGTH || c == '\r' || c == '\n') {
+        p->state = NMEA_IDLE;
+        return GPS_FAIL;
+    }
+
+    switch (p->state) {
+    case NMEA_ADDRESS:
+        p->checksum ^= c;
+        if (c != ',') {
+            // Keep the sentence type, without the talker ID.
+            if (p->field_length >= 2 && p->field_length < 5)
+                p->type[p->field_length - 2] = c;
+            p->field_length++;
+            break;
+        }
+        p->sentence = nmea_lookup(p);
+        if (p->sentence == NMEA_NONE) {
+            p->state = NMEA_IDLE;  // Ignore the unsupported sentences.
+            break;
+        }
+        p->state = NMEA_FIELDS;
+        p->field = 1;
+        nmea_start_field(p);
+        break;
+
+    case NMEA_FIELDS:
+        if (c == '*') {
+            nmea_end_field(p);
+            p->state = NMEA_CHECKSUM_HIGH;
+            break;
+        }
+        p->checksum ^= c;
+        if (c == ',') {
+            nmea_end_field(p);
+            p->field++;
+            nmea_start_field(p);
+        } else {
+            nmea_add_char(p, c);
+        }
+        break;
+
+    case NMEA_CHECKSUM_HIGH:
+        if ((nibble = hex_to_nibble(c)) < 0) {
+            p->state = NMEA_IDLE;
+            return GPS_FAIL;
+        }
+        p->expected = nibble << 4;
+        p->state = NMEA_CHECKSUM_LOW;
+        break;
+
+    case NMEA_CHECKSUM_LOW:
+        p->state = NMEA_IDLE;
+        if ((nibble = hex_to_nibble(c)) < 0)
+            return GPS_FAIL;
+        if ((p->expected | nibble) != p->checksum)
+            return GPS_FAIL;
+
+        // The sentence is valid: publish the updated GPS data.
+        gps_publish(&p->data, p->sentence == NMEA_GGA || p->sentence == NMEA_RMC);
+        return GPS_SUCCESS;
+    }
+
+    return GPS_PENDING;
 }
 
 
-// Parse a GPGGA message.
-static uint8_t parse_GPGGA(uint8_t i, int8_t *rxBuffer)
+#if GPS_PROTOCOL_UBX == 1
+
+// Read little-endian values of a UBX payload.
+static uint16_t ubx_u16(const uint8_t *b)
+{
+    return b[0] | ((uint16_t)b[1] << 8);
+}
+
+static uint32_t ubx_u32(const uint8_t *b)
 {
-    // NmeaUtcTime.
-    SKIP_FIELD(i, rxBuffer, 11);
-    // NmeaLatitude.
-    READ_FIELD(gps_nmea.latitude, i, rxBuffer, 10);
-    // NmeaLatitudePole.
-    READ_FIELD(gps_nmea.latitude_pole, i, rxBuffer, 2);
-    // NmeaLongitude.
-    READ_FIELD(gps_nmea.longitude, i, rxBuffer, 11);
-    // NmeaLongitudePole.
-    READ_FIELD(gps_nmea.longitude_pole, i, rxBuffer, 2);
-    // NmeaFixQuality.
-    READ_FIELD(gps_nmea.fix_quality, i, rxBuffer, 2);
-    // NmeaSatelliteTracked.
-    SKIP_FIELD(i, rxBuffer, 3);
-    // NmeaHorizontalDilution.
-    SKIP_FIELD(i, rxBuffer, 6);
-    // NmeaAltitude.
-    READ_FIELD(gps_nmea.altitude, i, rxBuffer, 8);
-    // NmeaAltitudeUnit.
-    SKIP_FIELD(i, rxBuffer, 2);
-    // NmeaHeightGeoid.
-    SKIP_FIELD(i, rxBuffer, 8);
-    // NmeaHeightGeoidUnit.
-    SKIP_FIELD(i, rxBuffer, 2);
+    return b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
 
-    gps_data.has_fix = (gps_nmea.fix_quality[0] > 0x30);
-    format_gps_data();
 
-    return GPS_SUCCESS;
+// Scale a position in 1e-7 degree to the signed 24-bit encoding.
+static int32_t degrees_e7_to_binary(int32_t value, int32_t max_positive,
+                                    int32_t max_negative, uint32_t range)
+{
+    bool negative = (value < 0);
+    uint32_t magnitude = negative ? -(uint32_t)value : (uint32_t)value;
+    return minutes_e4_to_binary(magnitude, negative, max_positive, max_negative, range);
 }
 
 
-// Parse a GPRMC message.
-static uint8_t parse_GPRMC(uint8_t i, int8_t *rxBuffer)
-{
-    // NmeaUtcTime.
-    SKIP_FIELD(i, rxBuffer, 11);
-    // NmeaDataStatus.
-    READ_FIELD(gps_nmea.fix_quality, i, rxBuffer, 2);
-    // NmeaLatitude.
-    READ_FIELD(gps_nmea.latitude, i, rxBuffer, 10);
-    // NmeaLatitudePole.
-    READ_FIELD(gps_nmea.latitude_pole, i, rxBuffer, 2);
-    // NmeaLongitude.
-    READ_FIELD(gps_nmea.longitude, i, rxBuffer, 11);
-    // NmeaLongitudePole.
-    READ_FIELD(gps_nmea.longitude_pole, i, rxBuffer, 2);
-    // NmeaSpeed.
-    SKIP_FIELD(i, rxBuffer, 8);
-    // NmeaDetectionAngle.
-    SKIP_FIELD(i, rxBuffer, 8);
-    // NmeaDate.
-    SKIP_FIELD(i, rxBuffer, 8);
-
-    gps_data.has_fix = (gps_nmea.fix_quality[0] == 0x41);
-    format_gps_data();
+// Convert a NAV-PVT payload into GPS data.
+static void ubx_nav_pvt(const uint8_t *pvt, gps_data_t *data)
+{
+    uint8_t valid = pvt[11];
+    uint8_t fix_type = pvt[20];
+    bool fix_ok = pvt[21] & 0x01;
+
+    if (valid & 0x01) {  // validDate
+        data->year = ubx_u16(pvt + 4);
+        data->month = pvt[6];
+        data->day = pvt[7];
+    }
+    if (valid & 0x02) {  // validTime
+        data->hour = pvt[8];
+        data->minute = pvt[9];
+        data->second = pvt[10];
+    }
+
+    data->has_fix = fix_ok && fix_type >= 2 && fix_type <= 4;
+    data->fix_quality = data->has_fix ? 1 : 0;
+    data->fix_mode = (fix_type == 2 || fix_type == 3) ? fix_type : 1;
+    data->satellites_used = pvt[23];
 
-    return GPS_SUCCESS;
+    data->longitude_bin = degrees_e7_to_binary(ubx_u32(pvt + 24),
+        MaxEastPosition, MaxWestPosition, 1800000000UL);
+    data->latitude_bin = degrees_e7_to_binary(ubx_u32(pvt + 28),
+        MaxNorthPosition, MaxSouthPosition, 900000000UL);
+    if (data->has_fix)
+        data->altitude = (int32_t)ubx_u32(pvt + 36) / 1000;  // hMSL in mm.
+
+    uint32_t h_accuracy = ubx_u32(pvt + 40) / 1000;  // In mm.
+    data->h_accuracy = (h_accuracy > UINT16_MAX) ? UINT16_MAX : h_accuracy;
+
+    data->speed = (int32_t)ubx_u32(pvt + 60) * 36 / 1000;  // gSpeed in mm/s.
+    data->course = (int32_t)ubx_u32(pvt + 64) / 10000;     // headMot in 1e-5 degree.
+    data->pdop = ubx_u16(pvt + 76);
 }
 
 
-// Parse GPS data.
-uint8_t gps_parse_data(int8_t *rxBuffer, int32_t rxBufferSize)
+// Parse a byte of a UBX frame (NMEA sentences are still accepted in between).
+static uint8_t ubx_gps_parse_byte(char c)
 {
-    if (!nmea_validate_checksum(rxBuffer, rxBufferSize))
+    ubx_parser_t *p = &ubx_parser;
+
+    switch (ubx_parse_byte(p, (uint8_t)c)) {
+    case UBX_NONE:
+        return nmea_parse_byte(c);
+    case UBX_ERROR:
         return GPS_FAIL;
+    case UBX_FRAME:
+        if (p->msg_class == UBX_CLASS_NAV && p->msg_id == UBX_NAV_PVT &&
+            p->length == UBX_NAV_PVT_LEN) {
+            gps_data_t data = gps_current()->data;
+            ubx_nav_pvt(p->payload, &data);
+            gps_publish(&data, true);
+            return GPS_SUCCESS;
+        }
+        break;
+    }
+    return GPS_PENDING;
+}
 
-    uint8_t i = 1;
-    READ_FIELD(gps_nmea.data_type, i, rxBuffer, 6);
+#endif
 
-    if (strncmp(gps_nmea.data_type, NmeaDataTypeGPGGA, 5) == 0)
-        return parse_GPGGA(i, rxBuffer);
-    else if (strncmp(gps_nmea.data_type, NmeaDataTypeGPRMC, 5) == 0)
-        return parse_GPRMC(i, rxBuffer);
-    else
-        return GPS_FAIL;
+
+// Parse a byte of GPS data.
+uint8_t gps_parse_byte(char c)
+{
+#if GPS_PROTOCOL_UBX == 1
+    return ubx_gps_parse_byte(c);
+#else
+    return nmea_parse_byte(c);
+#endif
+}
+
+
+// Parse GPS data.
+uint8_t gps_parse_data(int8_t *rxBuffer, int32_t rxBufferSize)
+{
+    uint8_t status = GPS_FAIL;
+
+    for (int32_t i = 0; i < rxBufferSize; i++) {
+        uint8_t s = gps_parse_byte(rxBuffer[i]);
+        if (s != GPS_PENDING)
+            status = s;
+    }
+    return status;
 }
 
 
 // Get the lastest GPS position in binary format.
 uint8_t gps_get_binary(int32_t *lat, int32_t *lon, int16_t *alt)
 {
-    mutex_lock(&gps_mutex);
+    gps_data_t data;
+    gps_get_data(&data);
 
-    uint8_t status = gps_data.has_fix ? GPS_SUCCESS : GPS_FAIL;
-    if (!gps_data.has_fix)
-        gps_reset_data();
+    if (!data.has_fix) {
+        *lat = 0;
+        *lon = 0;
+        *alt = 0xFFFF;
+        return GPS_FAIL;
+    }
+
+    *lat = data.latitude_bin;
+    *lon = data.longitude_bin;
+    *alt = data.altitude;
+    return GPS_SUCCESS;
+}
 
-    *lat = gps_data.latitude_bin;
-    *lon = gps_data.longitude_bin;
-    *alt = gps_data.altitude;
 
-    mutex_unlock(&gps_mutex);
-    return status;
+// Get a consistent copy of the lastest GPS data.
+void gps_get_data(gps_data_t *data)
+{
+    unsigned int seq;
+
+    do {
+        seq = gps_read_begin();
+        *data = gps_snapshots[seq & 1].data;
+    } while (gps_read_retry(seq));
+}
+
+
+// Get the last valid fix.
+uint8_t gps_get_fix(gps_fix_t *fix)
+{
+    unsigned int seq;
+
+    do {
+        seq = gps_read_begin();
+        *fix = gps_snapshots[seq & 1].fix;
+    } while (gps_read_retry(seq));
+
+    if (fix->timestamp == 0)
+        return GPS_FAIL;
+    fix->age = gps_now_ms() - fix->timestamp;
+    return GPS_SUCCESS;
+}
+
+
+// Get the time to first fix since boot.
+uint32_t gps_get_ttff(void)
+{
+    unsigned int seq;
+    uint32_t first_fix;
+
+    do {
+        seq = gps_read_begin();
+        first_fix = gps_snapshots[seq & 1].first_fix;
+    } while (gps_read_retry(seq));
+    return first_fix;
+}
+
+
+// Get the recent fixes, the newest first.
+uint8_t gps_get_history(gps_fix_t *fixes, uint8_t max)
+{
+    unsigned int seq;
+    uint8_t count;
+
+    do {
+        seq = gps_read_begin();
+        const gps_snapshot_t *s = &gps_snapshots[seq & 1];
+        count = (s->history_count < max) ? s->history_count : max;
+        for (uint8_t i = 0; i < count; i++)
+            fixes[i] = gps_history[(s->history_head + GPS_HISTORY_SIZE - i) % (GPS_HISTORY_SIZE + 1)];
+    } while (gps_read_retry(seq));
+
+    uint32_t now = gps_now_ms();
+    for (uint8_t i = 0; i < count; i++)
+        fixes[i].age = now - fixes[i].timestamp;
+    return count;
 }
 
 
 // Reset GPS data.
 void gps_reset_data(void)
 {
-    gps_data.has_fix = false;
-    gps_data.altitude = 0xFFFF;
+    gps_data_t data = gps_current()->data;
 
-    gps_data.latitude = 0;
-    gps_data.longitude = 0;
+    data.has_fix = false;
+    data.altitude = 0xFFFF;
 
-    gps_data.latitude_bin = 0;
-    gps_data.longitude_bin = 0;
+    data.latitude_bin = 0;
+    data.longitude_bin = 0;
+    gps_publish(&data, false);
 }
 
 #endif
@@ -19,32 +19,51 @@ This project is under the MIT license
 // Return codes.
 #define GPS_SUCCESS  0
 #define GPS_FAIL     1
+#define GPS_PENDING  2
 
+// Number of fixes kept in the history.
+#ifndef GPS_HISTORY_SIZE
+#define GPS_HISTORY_SIZE       8
+#endif
 
-// Store the GPS parsed data in ASCII.
-typedef struct {
-    char data_type[6];
-    char latitude[10];
-    char latitude_pole[2];
-    char longitude[11];
-    char longitude_pole[2];
-    char fix_quality[2];
-    char altitude[8];
-} gps_nmea_t;
+// Minimum interval between two fixes of the history (in ms).
+#ifndef GPS_HISTORY_PERIOD_MS
+#define GPS_HISTORY_PERIOD_MS  10000
+#endif
 
 
 // Store GPS data.
 typedef struct {
     bool has_fix;  // Ara data fixed?
-    double latitude;
-    double longitude;
     int32_t latitude_bin;
     int32_t longitude_bin;
-    int16_t altitude;
+    int16_t altitude;             // In m.
+    uint8_t fix_quality;          // GGA fix quality (0 = invalid).
+    uint8_t fix_mode;             // GSA fix mode (1 = none, 2 = 2D, 3 = 3D).
+    uint8_t satellites_used;      // Satellites used in the solution (GGA).
+    uint8_t satellites_in_view;   // Satellites in view (last GSV).
+    uint16_t hdop;                // Dilutions of precision in 1/100.
+    uint16_t pdop;
+    uint16_t vdop;
+    uint16_t h_accuracy;          // Horizontal accuracy estimate in m (UBX only).
+    uint16_t speed;               // Speed over ground in 0.1 km/h.
+    uint16_t course;              // Course over ground in 0.1 degree.
+    uint8_t hour;                 // UTC time.
+    uint8_t minute;
+    uint8_t second;
+    uint8_t day;                  // UTC date.
+    uint8_t month;
+    uint16_t year;
 } gps_data_t;
 
-// GPS parsed data.
-extern gps_data_t gps_data;
+// Timestamped position.
+typedef struct {
+    int32_t latitude_bin;
+    int32_t longitude_bin;
+    int16_t altitude;             // In m.
+    uint32_t timestamp;           // Time of the fix since boot in ms.
+    uint32_t age;                 // Age of the fix in ms, when read.
+} gps_fix_t;
 
 
 /**
@@ -57,16 +76,58 @@ extern gps_data_t gps_data;
 uint8_t gps_get_binary(int32_t *lat, int32_t *lon, int16_t *alt);
 
 
+/**
+ * @brief Get a consistent copy of the lastest GPS data, without blocking.
+ * @param data Where to store the GPS data.
+ */
+void gps_get_data(gps_data_t *data);
+
+
+/**
+ * @brief Get the last valid fix, without blocking.
+ * @param fix Where to store the fix.
+ * @return `GPS_SUCCESS` if there has been a fix since boot, else `GPS_FAIL`.
+ */
+uint8_t gps_get_fix(gps_fix_t *fix);
+
+
+/**
+ * @brief Get the time to first fix since boot, without blocking.
+ * @return The time to first fix in ms, or 0 if there has been no fix.
+ */
+uint32_t gps_get_ttff(void);
+
+
+/**
+ * @brief Get the recent fixes (at most one per `GPS_HISTORY_PERIOD_MS`),
+ *        without blocking.
+ * @param fixes Where to store the fixes, the newest first.
+ * @param max Size of fixes.
+ * @return The number of fixes stored.
+ */
+uint8_t gps_get_history(gps_fix_t *fixes, uint8_t max);
+
+
+/**
+ * @brief Parse a byte of GPS data (NMEA sentences of any talker, and UBX
+ *        NAV-PVT frames if `GPS_PROTOCOL_UBX`).
+ * @param c Byte received from the GPS.
+ * @return `GPS_SUCCESS` when a sentence has been parsed, `GPS_FAIL` when a
+ *         sentence has been dropped, else `GPS_PENDING`.
+ */
+uint8_t gps_parse_byte(char c);
+
+
 /**
  * @brief Parse GPS data.
  * @param rxBuffer GPS data to parse.
  * @param rxBufferSize Length of data.
- * @return Either `GPS_SUCCESS` or `GPS_FAIL`.
+ * @return The status of the last sentence, either `GPS_SUCCESS` or `GPS_FAIL`.
  */
 uint8_t gps_parse_data(int8_t *rxBuffer, int32_t rxBufferSize);
 
 /**
- * @brief Reset parsed GPS data.
+ * @brief Reset parsed GPS data (from the thread parsing the GPS data).
  */
 void gps_reset_data(void);
 
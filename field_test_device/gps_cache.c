@@ -0,0 +1,309 @@
+/*
+
+Keep the last fix in flash for aiding the GNSS module after a reset.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+#if GPS == 1 && GPS_CACHE == 1
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include "gps_cache.h"
+#include "gps_config.h"
+#include "gps.h"
+#include "ubx.h"
+
+#include <periph/flashpage.h>
+#if MODULE_PERIPH_RTC == 1
+#include <periph/rtc.h>
+#endif
+#include <mutex.h>
+#include <xtimer.h>
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+// Tag of a valid record ("GPS0").
+#define GPS_CACHE_MAGIC  0x47505330UL
+
+// Record stored in the flash page.
+typedef struct {
+    uint32_t magic;
+    int32_t latitude_bin;
+    int32_t longitude_bin;
+    int32_t altitude;
+    uint32_t time;          // RTC time of the save (0 if unknown).
+    uint32_t checksum;
+} gps_cache_t;
+
+_Static_assert(sizeof(gps_cache_t) % FLASHPAGE_WRITE_BLOCK_SIZE == 0,
+               "the records must be a whole number of write blocks");
+
+// Number of records in the flash page: each save is appended after the
+// previous one, and the page is erased only when it is full.
+#define GPS_CACHE_SLOTS  (FLASHPAGE_SIZE / sizeof(gps_cache_t))
+
+// Copy of the last flash record (aligned for flashpage_write).
+static gps_cache_t gps_cache __attribute__((aligned(FLASHPAGE_WRITE_BLOCK_ALIGNMENT)));
+
+// Next free record of the flash page (GPS_CACHE_SLOTS if full), and whether
+// the page has been scanned since boot.
+static unsigned int gps_cache_next;
+static bool gps_cache_scanned;
+
+// Time of the last save (in ms).
+static uint32_t gps_cache_saved;
+
+// Mutex that protects the flash record (the receiver saves before a reboot).
+static mutex_t gps_cache_mutex = MUTEX_INIT;
+
+
+// Checksum of a record.
+static uint32_t gps_cache_checksum(const gps_cache_t *c)
+{
+    const uint32_t *words = (const uint32_t *)c;
+    uint32_t sum = 0;
+
+    for (unsigned int i = 0; i < offsetof(gps_cache_t, checksum) / sizeof(uint32_t); i++)
+        sum = (sum << 1 | sum >> 31) ^ words[i];
+    return ~sum;
+}
+
+
+// Return true if the record has been written completely.
+static bool gps_cache_valid(const gps_cache_t *c)
+{
+    return c->magic == GPS_CACHE_MAGIC && c->checksum == gps_cache_checksum(c);
+}
+
+
+// Return true if the record is erased (0x00 or 0xFF depending on the MCU).
+static bool gps_cache_erased(const gps_cache_t *c)
+{
+    const uint8_t *bytes = (const uint8_t *)c;
+
+    if (bytes[0] != 0x00 && bytes[0] != 0xFF)
+        return false;
+    for (unsigned int i = 1; i < sizeof(*c); i++)
+        if (bytes[i] != bytes[0])
+            return false;
+    return true;
+}
+
+
+// Find the last record and the next free one in the flash page (called with
+// the mutex locked).
+static void gps_cache_scan(void)
+{
+    const gps_cache_t *slots = flashpage_addr(GPS_CACHE_FLASHPAGE);
+
+    memset(&gps_cache, 0, sizeof(gps_cache));
+    gps_cache_next = 0;
+    for (unsigned int i = 0; i < GPS_CACHE_SLOTS; i++) {
+        if (gps_cache_valid(&slots[i]))
+            memcpy(&gps_cache, &slots[i], sizeof(gps_cache));
+        // A record interrupted by a reset is skipped as well.
+        if (!gps_cache_erased(&slots[i]))
+            gps_cache_next = i + 1;
+    }
+    gps_cache_scanned = true;
+}
+
+
+// Read the RTC (the time is unknown if the MCU has no RTC).
+static bool gps_cache_rtc(struct tm *time)
+{
+#if MODULE_PERIPH_RTC == 1
+    return rtc_get_time(time) == 0;
+#else
+    (void)time;
+    return false;
+#endif
+}
+
+
+// Convert a position from the 24-bit encoding to 1e-7 degree.
+static int32_t binary_to_degrees_e7(int32_t value, int32_t max_positive,
+                                    int32_t max_negative, uint32_t range)
+{
+    if (value < 0)
+        return -(int32_t)(((uint64_t)-value * range) / max_negative);
+    return (int32_t)(((uint64_t)value * range) / max_positive);
+}
+
+
+// Write little-endian values in a UBX payload.
+static void ubx_put_u16(uint8_t *b, uint16_t value)
+{
+    b[0] = value;
+    b[1] = value >> 8;
+}
+
+static void ubx_put_u32(uint8_t *b, uint32_t value)
+{
+    ubx_put_u16(b, value);
+    ubx_put_u16(b + 2, value >> 16);
+}
+
+
+// Send the position, and the time if known, to a u-blox module.
+static void gps_cache_inject_ubx(int32_t lat, int32_t lon, int32_t alt,
+                                 const struct tm *time)
+{
+    uint8_t pos[UBX_MGA_INI_POS_LLH_LEN] = { UBX_MGA_INI_POS_LLH };
+    ubx_put_u32(pos + 4, lat);
+    ubx_put_u32(pos + 8, lon);
+    ubx_put_u32(pos + 12, alt * 100);                               // In cm.
+    ubx_put_u32(pos + 16, GPS_CACHE_POSITION_ACCURACY_M * 100UL);   // In cm.
+    gps_config_ubx(UBX_CLASS_MGA, UBX_MGA_INI, pos, sizeof(pos));
+
+    if (time == NULL)
+        return;
+
+    uint8_t utc[UBX_MGA_INI_TIME_UTC_LEN] = { UBX_MGA_INI_TIME_UTC };
+    utc[3] = 0x80;  // Leap seconds unknown.
+    ubx_put_u16(utc + 4, time->tm_year + 1900);
+    utc[6] = time->tm_mon + 1;
+    utc[7] = time->tm_mday;
+    utc[8] = time->tm_hour;
+    utc[9] = time->tm_min;
+    utc[10] = time->tm_sec;
+    ubx_put_u16(utc + 16, GPS_CACHE_TIME_ACCURACY_S);
+    gps_config_ubx(UBX_CLASS_MGA, UBX_MGA_INI, utc, sizeof(utc));
+}
+
+
+// Send the position and the time to a MediaTek or Quectel module.
+static void gps_cache_inject_mtk(int32_t lat, int32_t lon, int32_t alt,
+                                 const struct tm *time)
+{
+    char command[80];
+
+    if (time == NULL)
+        return;  // PMTK741 requires the time.
+
+    snprintf(command, sizeof(command),
+             "PMTK741,%s%ld.%07ld,%s%ld.%07ld,%ld,%04d,%02d,%02d,%02d,%02d,%02d",
+             (lat < 0) ? "-" : "", labs(lat) / 10000000, labs(lat) % 10000000,
+             (lon < 0) ? "-" : "", labs(lon) / 10000000, labs(lon) % 10000000,
+             (long)alt, time->tm_year + 1900, time->tm_mon + 1, time->tm_mday,
+             time->tm_hour, time->tm_min, time->tm_sec);
+    gps_config_nmea(command);
+}
+
+
+// Send the saved position, and the time of the RTC, to the GNSS module.
+void gps_cache_restore(uint8_t module)
+{
+    mutex_lock(&gps_cache_mutex);
+    gps_cache_scan();
+    if (gps_cache.magic != GPS_CACHE_MAGIC) {
+        mutex_unlock(&gps_cache_mutex);
+        DEBUG("[gps] no saved position\n");
+        return;
+    }
+    gps_cache_t saved = gps_cache;
+    mutex_unlock(&gps_cache_mutex);
+
+    int32_t lat = binary_to_degrees_e7(saved.latitude_bin,
+        8388607, 8388608, 900000000UL);
+    int32_t lon = binary_to_degrees_e7(saved.longitude_bin,
+        8388607, 8388608, 1800000000UL);
+
+    // The RTC is trusted if it has kept running since the save.
+    struct tm now;
+    const struct tm *time = NULL;
+    if (gps_cache_rtc(&now) && saved.time != 0 &&
+        (uint32_t)mktime(&now) >= saved.time)
+        time = &now;
+
+    DEBUG("[gps] saved position: lat=%ld lon=%ld alt=%ld, time %s\n",
+        lat, lon, saved.altitude, time ? "known" : "unknown");
+
+    if (module == GPS_MODULE_UBLOX)
+        gps_cache_inject_ubx(lat, lon, saved.altitude, time);
+    else if (module == GPS_MODULE_MTK)
+        gps_cache_inject_mtk(lat, lon, saved.altitude, time);
+}
+
+
+// Save the last fix if it has moved since the last save.
+static void gps_cache_write(bool force)
+{
+    uint32_t now = xtimer_now_usec64() / US_PER_MS;
+    gps_fix_t fix;
+
+    if (gps_get_fix(&fix) != GPS_SUCCESS)
+        return;
+
+    mutex_lock(&gps_cache_mutex);
+    if (!gps_cache_scanned)
+        gps_cache_scan();
+
+    if (!force && gps_cache_saved != 0 &&
+        now - gps_cache_saved < GPS_CACHE_PERIOD_S * 1000UL) {
+        mutex_unlock(&gps_cache_mutex);
+        return;
+    }
+    gps_cache_saved = now;
+
+    if (gps_cache.magic == GPS_CACHE_MAGIC &&
+        gps_cache.latitude_bin == fix.latitude_bin &&
+        gps_cache.longitude_bin == fix.longitude_bin) {
+        mutex_unlock(&gps_cache_mutex);
+        return;  // Spare the flash.
+    }
+
+    struct tm time;
+    gps_cache.magic = GPS_CACHE_MAGIC;
+    gps_cache.latitude_bin = fix.latitude_bin;
+    gps_cache.longitude_bin = fix.longitude_bin;
+    gps_cache.altitude = fix.altitude;
+    gps_cache.time = gps_cache_rtc(&time) ? (uint32_t)mktime(&time) : 0;
+    gps_cache.checksum = gps_cache_checksum(&gps_cache);
+
+    // Append the record, and erase the page only when it is full (or when
+    // the free record could not be written).
+    gps_cache_t *slots = flashpage_addr(GPS_CACHE_FLASHPAGE);
+    bool erased = false;
+    if (gps_cache_next >= GPS_CACHE_SLOTS) {
+        flashpage_erase(GPS_CACHE_FLASHPAGE);
+        gps_cache_next = 0;
+        erased = true;
+    }
+    flashpage_write(&slots[gps_cache_next], &gps_cache, sizeof(gps_cache));
+    if (!erased && memcmp(&slots[gps_cache_next], &gps_cache, sizeof(gps_cache)) != 0) {
+        flashpage_erase(GPS_CACHE_FLASHPAGE);
+        gps_cache_next = 0;
+        erased = true;
+        flashpage_write(&slots[gps_cache_next], &gps_cache, sizeof(gps_cache));
+    }
+    DEBUG("[gps] position saved in flash (record %u/%u%s)\n", gps_cache_next + 1,
+          (unsigned int)GPS_CACHE_SLOTS, erased ? ", page erased" : "");
+    gps_cache_next++;
+
+    mutex_unlock(&gps_cache_mutex);
+}
+
+
+// Save the last fix every GPS_CACHE_PERIOD_S.
+void gps_cache_update(void)
+{
+    gps_cache_write(false);
+}
+
+
+// Save the last fix now.
+void gps_cache_save(void)
+{
+    gps_cache_write(true);
+}
+
+#endif
@@ -0,0 +1,63 @@
+/*
+
+Keep the last fix in flash for aiding the GNSS module after a reset.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+#if GPS == 1 && GPS_CACHE == 1
+
+// Flash page storing the last fix (the last one by default).
+#ifndef GPS_CACHE_FLASHPAGE
+#define GPS_CACHE_FLASHPAGE             (FLASHPAGE_NUMOF - 1)
+#endif
+
+// Minimum interval between two saves (in s). The records are appended in
+// the flash page, which is erased once every FLASHPAGE_SIZE / 24 saves:
+// about 100 erases per year with 2 KB pages, 1750 with 128-byte pages.
+#ifndef GPS_CACHE_PERIOD_S
+#define GPS_CACHE_PERIOD_S              3600
+#endif
+
+// Accuracy given to the module with the saved position (in m).
+#ifndef GPS_CACHE_POSITION_ACCURACY_M
+#define GPS_CACHE_POSITION_ACCURACY_M   100000
+#endif
+
+// Accuracy given to the module with the RTC time (in s).
+#ifndef GPS_CACHE_TIME_ACCURACY_S
+#define GPS_CACHE_TIME_ACCURACY_S       10
+#endif
+
+
+/**
+ * @brief Send the saved position, and the time of the RTC, to the GNSS
+ *        module (UBX MGA-INI or PMTK741) for a warm start.
+ *        Called by the GPS thread once the module is configured.
+ * @param module Module detected by gps_config.
+ */
+void gps_cache_restore(uint8_t module);
+
+
+/**
+ * @brief Save the last fix if the previous save is older than
+ *        `GPS_CACHE_PERIOD_S` and the position has changed.
+ */
+void gps_cache_update(void);
+
+
+/**
+ * @brief Save the last fix now (before a reboot).
+ */
+void gps_cache_save(void);
+
+#endif
@@ -0,0 +1,223 @@
+/*
+
+Detect and configure the GNSS module.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+#if GPS == 1
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include "gps_config.h"
+#include "gps.h"
+#include "ubx.h"
+#include "app.h"
+
+#include <isrpipe/read_timeout.h>
+#include <xtimer.h>
+
+#include <stdio.h>
+#include <string.h>
+
+
+// Time for the last command to leave the UART and be applied (in us).
+#define GPS_CONFIG_SETTLE_US  (100 * US_PER_MS)
+
+
+// Send a proprietary NMEA command, adding its checksum.
+void gps_config_nmea(const char *body)
+{
+    char sentence[64];
+    uint8_t checksum = 0;
+
+    for (const char *c = body; *c; c++)
+        checksum ^= *c;
+    int len = snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, checksum);
+    uart_gps_send((const uint8_t *)sentence, len);
+}
+
+
+// Send a UBX command.
+void gps_config_ubx(uint8_t msg_class, uint8_t msg_id,
+                           const uint8_t *payload, uint16_t len)
+{
+    uint8_t frame[UBX_HEADER_LEN + GPS_CONFIG_MAX_PAYLOAD + UBX_CHECKSUM_LEN];
+    uart_gps_send(frame, ubx_frame(frame, msg_class, msg_id, payload, len));
+}
+
+
+// Set the output rate of a UBX or NMEA message on the current port.
+static void gps_config_ubx_msg(uint8_t msg_class, uint8_t msg_id, uint8_t rate)
+{
+    const uint8_t cfg_msg[] = { msg_class, msg_id, rate };
+    gps_config_ubx(UBX_CLASS_CFG, UBX_CFG_MSG, cfg_msg, sizeof(cfg_msg));
+}
+
+
+// Configure UART1 of a u-blox module in 8N1 at `baudrate`, UBX+NMEA in.
+static void gps_config_ubx_port(uint32_t baudrate, uint8_t out_proto)
+{
+    const uint8_t cfg_prt[20] = {
+        0x01, 0x00, 0x00, 0x00,     // portID, reserved1, txReady
+        0xD0, 0x08, 0x00, 0x00,     // mode: 8 bits, no parity, 1 stop bit
+        (baudrate >> 0) & 0xFF, (baudrate >> 8) & 0xFF,
+        (baudrate >> 16) & 0xFF, (baudrate >> 24) & 0xFF,
+        UBX_PROTO_UBX | UBX_PROTO_NMEA, 0x00,  // inProtoMask
+        out_proto, 0x00,                       // outProtoMask
+        0x00, 0x00, 0x00, 0x00,     // flags, reserved2
+    };
+    gps_config_ubx(UBX_CLASS_CFG, UBX_CFG_PRT, cfg_prt, sizeof(cfg_prt));
+}
+
+
+// Read a byte sent by the module before `deadline` (in us).
+static bool gps_config_read(uint8_t *c, uint32_t deadline)
+{
+    int32_t timeout = deadline - xtimer_now_usec();
+    if (timeout <= 0)
+        return false;
+    return isrpipe_read_timeout(&uart_info.rx, c, 1, timeout) == 1;
+}
+
+
+// Find which module is connected, from its answer to a UBX or PMTK query.
+static uint8_t gps_config_detect(void)
+{
+    static ubx_parser_t ubx;
+    char address[4];
+    uint8_t length = sizeof(address);
+    uint8_t c;
+
+    memset(&ubx, 0, sizeof(ubx));
+
+    // Poll the configuration of the current port (u-blox).
+    gps_config_ubx(UBX_CLASS_CFG, UBX_CFG_PRT, NULL, 0);
+    // Query the firmware release (MediaTek, Quectel).
+    gps_config_nmea("PMTK605");
+
+    uint32_t deadline = xtimer_now_usec() + GPS_CONFIG_DETECT_MS * US_PER_MS;
+    while (gps_config_read(&c, deadline)) {
+        if (ubx_parse_byte(&ubx, c) == UBX_FRAME)
+            return GPS_MODULE_UBLOX;
+
+        if (c == '$') {
+            length = 0;
+        } else if (length < sizeof(address)) {
+            address[length++] = c;
+            if (length == sizeof(address) && memcmp(address, "PMTK", sizeof(address)) == 0)
+                return GPS_MODULE_MTK;
+        }
+    }
+    return GPS_MODULE_UNKNOWN;
+}
+
+
+// Keep only the messages used by the parser, and select the balloon model.
+static void gps_config_messages(uint8_t module)
+{
+    if (module == GPS_MODULE_UBLOX) {
+#if GPS_PROTOCOL_UBX == 1
+        // NAV-PVT only: the NMEA output is disabled by the port configuration.
+        gps_config_ubx_msg(UBX_CLASS_NAV, UBX_NAV_PVT, 1);
+#else
+        gps_config_ubx_msg(UBX_CLASS_NMEA, UBX_NMEA_GGA, 1);
+        gps_config_ubx_msg(UBX_CLASS_NMEA, UBX_NMEA_RMC, 1);
+        gps_config_ubx_msg(UBX_CLASS_NMEA, UBX_NMEA_GLL, 0);
+        gps_config_ubx_msg(UBX_CLASS_NMEA, UBX_NMEA_GSA, 0);
+        gps_config_ubx_msg(UBX_CLASS_NMEA, UBX_NMEA_GSV, 0);
+        gps_config_ubx_msg(UBX_CLASS_NMEA, UBX_NMEA_VTG, 0);
+#endif
+        // CFG-NAV5: only apply the dynamic model.
+        uint8_t cfg_nav5[36] = { 0x01, 0x00, UBX_DYN_AIRBORNE_1G };
+        gps_config_ubx(UBX_CLASS_CFG, UBX_CFG_NAV5, cfg_nav5, sizeof(cfg_nav5));
+    } else {
+        // GGA and RMC only (GLL, RMC, VTG, GGA, GSA, GSV, ..., ZDA, MCHN).
+        gps_config_nmea("PMTK314,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0");
+        // Balloon mode (Quectel L76, L96 and L70-R), ignored by the others.
+        gps_config_nmea("PMTK886,3");
+    }
+}
+
+
+// Wait for a valid sentence.
+static bool gps_config_verify(void)
+{
+    uint32_t deadline = xtimer_now_usec() + GPS_CONFIG_VERIFY_MS * US_PER_MS;
+    uint8_t c;
+
+    while (gps_config_read(&c, deadline))
+        if (gps_parse_byte(c) == GPS_SUCCESS)
+            return true;
+    return false;
+}
+
+
+// Send the command that sets the baudrate of the module.
+static void gps_config_send_baudrate(uint8_t module, uint32_t baudrate)
+{
+    if (module == GPS_MODULE_UBLOX) {
+#if GPS_PROTOCOL_UBX == 1
+        gps_config_ubx_port(baudrate, UBX_PROTO_UBX);
+#else
+        gps_config_ubx_port(baudrate, UBX_PROTO_NMEA);
+#endif
+    } else {
+        char command[24];
+        snprintf(command, sizeof(command), "PMTK251,%lu", (unsigned long)baudrate);
+        gps_config_nmea(command);
+    }
+}
+
+
+// Set the baudrate of the module and of the UART, and check the link.
+static void gps_config_baudrate(uint8_t module, uint32_t baudrate)
+{
+    if (baudrate == STD_BAUDRATE) {
+        // Only the protocols of the u-blox port.
+        if (module == GPS_MODULE_UBLOX)
+            gps_config_send_baudrate(module, baudrate);
+        return;
+    }
+
+    gps_config_send_baudrate(module, baudrate);
+    xtimer_usleep(GPS_CONFIG_SETTLE_US);
+    uart_gps_set_baudrate(baudrate);
+    if (gps_config_verify()) {
+        DEBUG("[gps] baudrate set to %lu\n", (unsigned long)baudrate);
+        return;
+    }
+
+    // The module may have switched anyway: set it back from the new baudrate
+    // before the UART.
+    gps_config_send_baudrate(module, STD_BAUDRATE);
+    xtimer_usleep(GPS_CONFIG_SETTLE_US);
+    uart_gps_set_baudrate(STD_BAUDRATE);
+    DEBUG("[gps] no sentence at %lu, baudrate reverted to %lu\n",
+        (unsigned long)baudrate, (unsigned long)STD_BAUDRATE);
+}
+
+
+// Detect and configure the GNSS module.
+uint8_t gps_config(void)
+{
+    uint8_t module = gps_config_detect();
+    DEBUG("[gps] module: %s\n", (module == GPS_MODULE_UBLOX) ? "u-blox" :
+        (module == GPS_MODULE_MTK) ? "MediaTek/Quectel" : "unknown");
+
+#if GPS_PROTOCOL_UBX == 1
+    // UBX has been selected for a u-blox module.
+    if (module == GPS_MODULE_UNKNOWN)
+        module = GPS_MODULE_UBLOX;
+#endif
+    if (module == GPS_MODULE_UNKNOWN)
+        return module;
+
+    gps_config_messages(module);
+    gps_config_baudrate(module, GPS_CONFIG_BAUDRATE);
+    return module;
+}
+
+#endif
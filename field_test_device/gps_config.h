@@ -0,0 +1,73 @@
+/*
+
+Detect and configure the GNSS module.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+#if GPS == 1
+
+// Detected GNSS modules (see gnss_modules.md).
+#define GPS_MODULE_UNKNOWN  0
+#define GPS_MODULE_UBLOX    1  // u-blox (UBX protocol).
+#define GPS_MODULE_MTK      2  // MediaTek and Quectel (PMTK commands).
+
+// Baudrate set once the module is detected (STD_BAUDRATE to keep it).
+#ifndef GPS_CONFIG_BAUDRATE
+#define GPS_CONFIG_BAUDRATE     STD_BAUDRATE
+#endif
+
+// Time waited for an answer of the module at startup (in ms).
+#ifndef GPS_CONFIG_DETECT_MS
+#define GPS_CONFIG_DETECT_MS    2000
+#endif
+
+// Time waited for a valid sentence after a baudrate change (in ms).
+#ifndef GPS_CONFIG_VERIFY_MS
+#define GPS_CONFIG_VERIFY_MS    3000
+#endif
+
+
+// Longest payload of the UBX commands.
+#define GPS_CONFIG_MAX_PAYLOAD  36
+
+
+/**
+ * @brief Send a proprietary NMEA command to the module.
+ * @param body Command without the '$' and the checksum (e.g. "PMTK605").
+ */
+void gps_config_nmea(const char *body);
+
+
+/**
+ * @brief Send a UBX command to the module.
+ * @param msg_class Class of the message.
+ * @param msg_id Identifier of the message.
+ * @param payload Payload of the message.
+ * @param len Length of the payload (at most `GPS_CONFIG_MAX_PAYLOAD`).
+ */
+void gps_config_ubx(uint8_t msg_class, uint8_t msg_id,
+                    const uint8_t *payload, uint16_t len);
+
+
+/**
+ * @brief Detect the GNSS module, then configure it: only the sentences
+ *        used by the parser (GGA and RMC, or NAV-PVT with UBX), the airborne
+ *        (balloon) dynamic model and `GPS_CONFIG_BAUDRATE`. The module and
+ *        the UART are set back to `STD_BAUDRATE` when no valid sentence is
+ *        received after the change.
+ *        Called by the GPS thread before parsing.
+ * @return The detected module, `GPS_MODULE_UNKNOWN` if it did not answer.
+ */
+uint8_t gps_config(void);
+
+#endif
@@ -0,0 +1,193 @@
+/*
+
+Duty-cycle the GNSS module between the transmissions.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+#if GPS == 1 && GPS_POWER_SAVE == 1
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include "gps_power.h"
+#include "gps.h"
+#include "app.h"
+#if GPS_PROTOCOL_UBX == 1
+#include "ubx.h"
+#endif
+
+#ifdef GPS_POWER_PIN
+#include <periph/gpio.h>
+#endif
+#include <xtimer.h>
+
+#include <string.h>
+
+
+// Statistics of the power manager.
+static gps_power_stats_t gps_power_stats = {
+    .ttff_avg_ms = GPS_POWER_INITIAL_TTFF_MS,
+};
+
+
+// Current time in ms.
+static uint32_t gps_power_now_ms(void)
+{
+    return xtimer_now_usec64() / US_PER_MS;
+}
+
+
+// Sleep `ms` milliseconds.
+static void gps_power_wait(uint32_t ms)
+{
+    xtimer_usleep64((uint64_t)ms * US_PER_MS);
+}
+
+
+// Put the module in backup mode for `ms` milliseconds (at most).
+static void gps_power_off(uint32_t ms)
+{
+#if defined(GPS_POWER_PIN)
+    (void)ms;
+    gpio_clear(GPS_POWER_PIN);
+#elif GPS_PROTOCOL_UBX == 1
+    // RXM-PMREQ: backup mode, the module wakes up by itself after `ms`.
+    uint8_t frame[UBX_HEADER_LEN + 8 + UBX_CHECKSUM_LEN];
+    const uint8_t pmreq[8] = {
+        (ms >> 0) & 0xFF, (ms >> 8) & 0xFF, (ms >> 16) & 0xFF, (ms >> 24) & 0xFF,
+        0x02, 0x00, 0x00, 0x00,     // flags: backup
+    };
+    size_t len = ubx_frame(frame, UBX_CLASS_RXM, UBX_RXM_PMREQ, pmreq, sizeof(pmreq));
+    uart_gps_send(frame, len);
+#else
+    // PMTK161: standby mode (MTK and Quectel modules), until any byte is
+    // received: the console sharing the UART is held meanwhile.
+    (void)ms;
+    static const char pmtk_standby[] = "$PMTK161,0*28\r\n";
+    uart_stdio_hold(true);
+    uart_gps_send((const uint8_t *)pmtk_standby, strlen(pmtk_standby));
+#endif
+}
+
+
+// Wake the module up.
+static void gps_power_on(void)
+{
+#if defined(GPS_POWER_PIN)
+    gpio_set(GPS_POWER_PIN);
+    // The configuration has been lost with the power.
+    uart_gps_request(UART_GPS_CONFIG);
+#elif GPS_PROTOCOL_UBX == 1
+    // The module has already woken up at the end of the backup duration,
+    // without the configuration (kept in RAM only).
+    uart_gps_request(UART_GPS_CONFIG);
+#else
+    // The module keeps its configuration in standby.
+    static const char wakeup[] = "\r\n";
+    uart_gps_send((const uint8_t *)wakeup, strlen(wakeup));
+    uart_stdio_hold(false);
+#endif
+}
+
+
+// Wait for a fix newer than `wake`, until `deadline` (not after it).
+static bool gps_power_wait_fix(uint32_t wake, uint32_t deadline, uint32_t *ttff)
+{
+    gps_fix_t fix;
+    int32_t remaining;
+
+    while ((remaining = deadline - gps_power_now_ms()) > 0) {
+        if (gps_get_fix(&fix) == GPS_SUCCESS && (int32_t)(fix.timestamp - wake) >= 0) {
+            *ttff = fix.timestamp - wake;
+            return true;
+        }
+        gps_power_wait((remaining < GPS_POWER_POLL_MS) ? (uint32_t)remaining : GPS_POWER_POLL_MS);
+    }
+    return false;
+}
+
+
+// Update the time to fix statistics.
+static void gps_power_update_ttff(uint32_t ttff)
+{
+    gps_power_stats_t *s = &gps_power_stats;
+
+    s->ttff_last_ms = ttff;
+    if (ttff > s->ttff_max_ms)
+        s->ttff_max_ms = ttff;
+
+    // Moving average with a weight of 1/4 for the last measure.
+    s->ttff_avg_ms = (3 * s->ttff_avg_ms + ttff) / 4;
+}
+
+
+// Wait, with the GNSS module off for most of the time.
+void gps_power_sleep(uint32_t ms)
+{
+    gps_power_stats_t *s = &gps_power_stats;
+    uint32_t start = gps_power_now_ms();
+    uint32_t deadline = start + ms;
+    uint32_t lead = s->ttff_avg_ms + GPS_POWER_MARGIN_MS;
+
+    if (ms < lead + GPS_POWER_MIN_OFF_MS) {
+        // Too short for a power cycle.
+        gps_power_wait(ms);
+        s->on_ms += ms;
+        return;
+    }
+
+    uint32_t off = ms - lead;
+    gps_power_off(off);
+    // Forget the fix once the module is off, so that only a position decoded
+    // after the wake up is accepted.
+    uart_gps_request(UART_GPS_RESET);
+    gps_power_wait(off);
+    gps_power_on();
+    s->off_ms += off;
+    s->cycles++;
+
+    uint32_t wake = gps_power_now_ms();
+    uint32_t ttff;
+    if (gps_power_wait_fix(wake, deadline, &ttff)) {
+        gps_power_update_ttff(ttff);
+        DEBUG("[gps] fix after %lu ms (average %lu ms, max %lu ms)\n",
+            ttff, s->ttff_avg_ms, s->ttff_max_ms);
+        // Keep the module on until the deadline for the freshest position.
+        int32_t remaining = deadline - gps_power_now_ms();
+        if (remaining > 0)
+            gps_power_wait(remaining);
+    } else {
+        // Wake up earlier next time.
+        s->misses++;
+        s->ttff_avg_ms *= 2;
+        if (s->ttff_avg_ms > GPS_POWER_MAX_TTFF_MS)
+            s->ttff_avg_ms = GPS_POWER_MAX_TTFF_MS;
+        DEBUG("[gps] no fix after %lu ms (misses %lu)\n",
+            gps_power_now_ms() - wake, s->misses);
+    }
+    s->on_ms += gps_power_now_ms() - wake;
+
+    DEBUG("[gps] power: cycles=%lu on=%lu ms off=%lu ms\n",
+        s->cycles, s->on_ms, s->off_ms);
+}
+
+
+// Power the module up.
+void gps_power_init(void)
+{
+#ifdef GPS_POWER_PIN
+    gpio_init(GPS_POWER_PIN, GPIO_OUT);
+    gpio_set(GPS_POWER_PIN);
+#endif
+}
+
+
+// Get the statistics of the power manager.
+void gps_power_get_stats(gps_power_stats_t *stats)
+{
+    *stats = gps_power_stats;
+}
+
+#endif
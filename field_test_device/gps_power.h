@@ -0,0 +1,80 @@
+/*
+
+Duty-cycle the GNSS module between the transmissions.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+#if GPS == 1 && GPS_POWER_SAVE == 1
+
+// Time to fix assumed before the first measure (in ms).
+#ifndef GPS_POWER_INITIAL_TTFF_MS
+#define GPS_POWER_INITIAL_TTFF_MS  30000
+#endif
+
+// Longest time to fix used for waking the module early (in ms).
+#ifndef GPS_POWER_MAX_TTFF_MS
+#define GPS_POWER_MAX_TTFF_MS      120000
+#endif
+
+// Margin added to the expected time to fix (in ms).
+#ifndef GPS_POWER_MARGIN_MS
+#define GPS_POWER_MARGIN_MS        5000
+#endif
+
+// The module stays on if it would be off for less than this (in ms).
+#ifndef GPS_POWER_MIN_OFF_MS
+#define GPS_POWER_MIN_OFF_MS       10000
+#endif
+
+// Period of the fix polling after the wake up (in ms).
+#ifndef GPS_POWER_POLL_MS
+#define GPS_POWER_POLL_MS          250
+#endif
+
+
+// Statistics of the power manager.
+typedef struct {
+    uint32_t cycles;        // Number of sleeps with the module off.
+    uint32_t misses;        // Wake ups without a fix before the deadline.
+    uint32_t on_ms;         // Cumulated time with the module on.
+    uint32_t off_ms;        // Cumulated time with the module off.
+    uint32_t ttff_last_ms;  // Last time to fix.
+    uint32_t ttff_avg_ms;   // Moving average of the time to fix.
+    uint32_t ttff_max_ms;   // Longest time to fix.
+} gps_power_stats_t;
+
+
+/**
+ * @brief Power the GNSS module up (with `GPS_POWER_PIN`).
+ *        Called by the GPS thread before the configuration of the module.
+ */
+void gps_power_init(void);
+
+
+/**
+ * @brief Wait, with the GNSS module in backup (or powered off) for most of
+ *        the time. The module is woken up early enough for getting a fix
+ *        before the end of the wait, according to the measured time to fix,
+ *        and configured again if it has lost its configuration.
+ * @param ms Duration of the wait (in ms).
+ */
+void gps_power_sleep(uint32_t ms);
+
+
+/**
+ * @brief Get the statistics of the power manager.
+ * @param stats Where to store the statistics.
+ */
+void gps_power_get_stats(gps_power_stats_t *stats);
+
+#endif
@@ -0,0 +1,129 @@
+/*
+
+Encode the recent fixes as deltas from the position of the frame.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+#if GPS == 1
+
+#include "gps_track.h"
+#include "gps.h"
+
+
+// Largest shift tried for the deltas.
+#define GPS_TRACK_MAX_SHIFT  15
+
+
+// Quantize `delta` to an int8 multiple of 2^shift (rounded to the nearest),
+// or saturate it.
+static bool gps_track_quantize(int32_t delta, uint8_t shift, int8_t *q)
+{
+    int32_t half = (1L << shift) >> 1;
+    int32_t value = (delta >= 0) ? (delta + half) >> shift : -((-delta + half) >> shift);
+
+    if (value < INT8_MIN) {
+        *q = INT8_MIN;
+        return false;
+    }
+    if (value > INT8_MAX) {
+        *q = INT8_MAX;
+        return false;
+    }
+    *q = value;
+    return true;
+}
+
+
+// Encode the deltas of a coordinate along the track with a given shift, from
+// the decoded previous value.
+static bool gps_track_deltas(int32_t anchor, const int32_t *values, unsigned int n,
+                             uint8_t shift, int8_t *deltas)
+{
+    int32_t decoded = anchor;
+    bool fit = true;
+
+    for (unsigned int i = 0; i < n; i++) {
+        fit &= gps_track_quantize(values[i] - decoded, shift, &deltas[i]);
+        decoded += (int32_t)deltas[i] * (1L << shift);
+    }
+    return fit;
+}
+
+
+// Find the smallest shift for the deltas of a coordinate.
+static uint8_t gps_track_shift(int32_t anchor, const int32_t *values, unsigned int n,
+                               int8_t *deltas)
+{
+    uint8_t shift = 0;
+
+    while (shift < GPS_TRACK_MAX_SHIFT && !gps_track_deltas(anchor, values, n, shift, deltas))
+        shift++;
+    gps_track_deltas(anchor, values, n, shift, deltas);
+    return shift;
+}
+
+
+// Encode the history of fixes as deltas from the anchor.
+unsigned int gps_track_encode(uint8_t *payload, unsigned int len,
+                              int32_t lat, int32_t lon, int16_t alt, uint32_t timestamp)
+{
+    gps_fix_t fixes[GPS_TRACK_MAX_FIXES + 1];
+    int32_t lats[GPS_TRACK_MAX_FIXES], lons[GPS_TRACK_MAX_FIXES], alts[GPS_TRACK_MAX_FIXES];
+    int8_t dlat[GPS_TRACK_MAX_FIXES], dlon[GPS_TRACK_MAX_FIXES], dalt[GPS_TRACK_MAX_FIXES];
+
+    if (len < GPS_TRACK_HEADER_LEN + GPS_TRACK_FIX_LEN)
+        return 0;
+
+    unsigned int max = (len - GPS_TRACK_HEADER_LEN) / GPS_TRACK_FIX_LEN;
+    if (max > GPS_TRACK_MAX_FIXES)
+        max = GPS_TRACK_MAX_FIXES;
+
+    // Leave out the anchor itself (a zero delta), and the fixes received
+    // after it.
+    unsigned int count = gps_get_history(fixes, max + 1), n = 0;
+    for (unsigned int k = 0; k < count && n < max; k++) {
+        if ((int32_t)(timestamp - fixes[k].timestamp) > 0)
+            fixes[n++] = fixes[k];
+    }
+    if (n == 0)
+        return 0;
+
+    for (unsigned int i = 0; i < n; i++) {
+        lats[i] = fixes[i].latitude_bin;
+        lons[i] = fixes[i].longitude_bin;
+        alts[i] = fixes[i].altitude;
+    }
+
+    // A single shift for the latitude and the longitude.
+    uint8_t shift_lat = gps_track_shift(lat, lats, n, dlat);
+    uint8_t shift_lon = gps_track_shift(lon, lons, n, dlon);
+    uint8_t shift = (shift_lat > shift_lon) ? shift_lat : shift_lon;
+    gps_track_deltas(lat, lats, n, shift, dlat);
+    gps_track_deltas(lon, lons, n, shift, dlon);
+    uint8_t shift_alt = gps_track_shift(alt, alts, n, dalt);
+
+    unsigned int i = 0;
+    payload[i++] = n;
+    payload[i++] = (shift << 4) | shift_alt;
+
+    // Seconds between the fixes, rounded from the time since the anchor so
+    // that the rounding errors do not accumulate either.
+    uint32_t previous = 0;
+    for (unsigned int k = 0; k < n; k++) {
+        uint32_t age = (timestamp - fixes[k].timestamp + 500) / 1000;
+        uint32_t dt = (age > previous) ? age - previous : 0;
+        if (dt > UINT8_MAX)
+            dt = UINT8_MAX;
+        previous += dt;
+
+        payload[i++] = dt;
+        payload[i++] = dlat[k];
+        payload[i++] = dlon[k];
+        payload[i++] = dalt[k];
+    }
+    return i;
+}
+
+#endif
@@ -0,0 +1,50 @@
+/*
+
+Encode the recent fixes as deltas from the position of the frame.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+#if GPS == 1
+
+// Most fixes in a track (the count is on 4 bits).
+#define GPS_TRACK_MAX_FIXES  15
+
+// Size of the track header and of each fix.
+#define GPS_TRACK_HEADER_LEN 2
+#define GPS_TRACK_FIX_LEN    4
+
+
+/**
+ * @brief Encode the history of fixes, the newest first, as deltas from the
+ *        position of the frame (the anchor):
+ *        - uint8 : number of fixes
+ *        - uint8 : shift of the position deltas (high nibble) and of the
+ *                  altitude deltas (low nibble)
+ *        - for each fix: uint8 seconds since the previous fix (the anchor for
+ *          the first one), int8 latitude, int8 longitude and int8 altitude
+ *          deltas from the previous fix, to multiply by 2^shift.
+ *        The deltas are taken from the decoded positions, so the rounding
+ *        errors do not accumulate along the track. The fixes of the history
+ *        that are not older than the anchor are left out.
+ * @param payload Where to store the track.
+ * @param len Available length (the number of fixes is reduced to fit).
+ * @param lat Latitude of the anchor (24-bit encoding).
+ * @param lon Longitude of the anchor (24-bit encoding).
+ * @param alt Altitude of the anchor (in m).
+ * @param timestamp Time of the anchor since boot in ms (see gps_fix_t).
+ * @return The length of the track, 0 if there is no room or no history.
+ */
+unsigned int gps_track_encode(uint8_t *payload, unsigned int len,
+                              int32_t lat, int32_t lon, int16_t alt, uint32_t timestamp);
+
+#endif
@@ -37,6 +37,19 @@
 
 #include "xtimer.h"
 
+#ifndef MODULE_MOCK_LORAMAC
+#include "net/netdev.h"
+#include "LoRaMac.h"
+#endif
+#if defined(MODULE_SX127X)
+#include "sx127x.h"
+#include "sx127x_internal.h"
+#include "sx127x_registers.h"
+#elif defined(MODULE_SX126X)
+#include "sx126x.h"
+#include "sx126x_driver.h"
+#endif
+
 #include "loramac_utils.h"
 
 
@@ -365,3 +378,79 @@ const char* loramac_utils_get_lorawan_network(const uint32_t devaddr) {
 	return "Unknown";
 }
 
+
+// Maximum application payload size (N) per uplink datarate, without FOpts and
+// with the dwell time limitation off (LoRaWAN Regional Parameters RP002-1.0.3).
+#if defined(REGION_EU868) || defined(REGION_EU433) || defined(REGION_IN865) || defined(REGION_RU864)
+static const uint8_t max_payload_sizes[] = { 51, 51, 51, 115, 222, 222, 222, 222 };
+#elif defined(REGION_AS923)
+static const uint8_t max_payload_sizes[] = { 51, 51, 51, 115, 242, 242, 242, 242 };
+#elif defined(REGION_US915)
+static const uint8_t max_payload_sizes[] = { 11, 53, 125, 242, 242 };
+#elif defined(REGION_AU915)
+static const uint8_t max_payload_sizes[] = { 51, 51, 51, 115, 222, 222, 222 };
+#elif defined(REGION_KR920) || defined(REGION_CN470)
+static const uint8_t max_payload_sizes[] = { 51, 51, 51, 115, 222, 222 };
+#else
+#error Unsupported region
+#endif
+
+uint8_t loramac_utils_max_payload_size(uint8_t dr) {
+	if (dr >= NELEMS(max_payload_sizes)) {
+		return 0;
+	}
+	return max_payload_sizes[dr];
+}
+
+
+uint32_t loramac_utils_get_downlink_counter(semtech_loramac_t *loramac) {
+#if defined(MODULE_MOCK_LORAMAC)
+	return mock_loramac_get_downlink_counter(loramac);
+#else
+	MibRequestConfirm_t mibReq;
+	mutex_lock(&loramac->lock);
+	mibReq.Type = MIB_DOWNLINK_COUNTER;
+	LoRaMacMibGetRequestConfirm(&mibReq);
+	uint32_t counter = mibReq.Param.DownLinkCounter;
+	mutex_unlock(&loramac->lock);
+	return counter;
+#endif
+}
+
+#if defined(MODULE_MOCK_LORAMAC)
+extern semtech_loramac_t loramac;
+#else
+// Radio of the MAC (see pkg/semtech-loramac).
+extern netdev_t *loramac_netdev_ptr;
+#endif
+
+bool loramac_utils_get_last_packet_status(int16_t *rssi, int8_t *snr) {
+#if defined(MODULE_MOCK_LORAMAC)
+	mock_loramac_get_last_packet_status(&loramac, rssi, snr);
+	return true;
+#elif defined(MODULE_SX127X)
+	// Registers of the last packet (SX1276 datasheet, 5.5.5).
+	sx127x_t *dev = (sx127x_t *)loramac_netdev_ptr;
+	*snr = (int8_t)sx127x_reg_read(dev, SX127X_REG_LR_PKTSNRVALUE) / 4;
+#if defined(REGION_EU433) || defined(REGION_CN470)
+	*rssi = -164 + sx127x_reg_read(dev, SX127X_REG_LR_PKTRSSIVALUE);
+#else
+	*rssi = -157 + sx127x_reg_read(dev, SX127X_REG_LR_PKTRSSIVALUE);
+#endif
+	if (*snr < 0) {
+		*rssi += *snr;
+	}
+	return true;
+#elif defined(MODULE_SX126X)
+	sx126x_t *dev = (sx126x_t *)loramac_netdev_ptr;
+	sx126x_pkt_status_lora_t status;
+	sx126x_get_lora_pkt_status(dev, &status);
+	*rssi = status.rssi_pkt_in_dbm;
+	*snr = status.snr_pkt_in_db;
+	return true;
+#else
+	*rssi = 0;
+	*snr = 0;
+	return false;
+#endif
+}
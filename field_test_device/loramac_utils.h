@@ -22,6 +22,7 @@
 #define LORAMAC_UTILS_H
 
 #include <inttypes.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -38,6 +39,34 @@ extern "C"
 
     const char* loramac_utils_get_lorawan_network(const uint32_t devaddr);
 
+    /**
+     * Get the maximum application payload size of an uplink datarate in the region.
+     *
+     * @param dr the datarate
+     *
+     * @return the size in bytes, 0 if the datarate is not an uplink datarate of the region
+     */
+    uint8_t loramac_utils_max_payload_size(uint8_t dr);
+
+    /**
+     * Get the frame counter of the last downlink (FCntDown).
+     *
+     * @param loramac the LoRaMac context
+     *
+     * @return the counter
+     */
+    uint32_t loramac_utils_get_downlink_counter(semtech_loramac_t *loramac);
+
+    /**
+     * Get the RSSI and the SNR of the last packet received by the radio of the MAC.
+     *
+     * @param rssi the RSSI in dBm
+     * @param snr the SNR in dB
+     *
+     * @return false if the radio driver does not provide them
+     */
+    bool loramac_utils_get_last_packet_status(int16_t *rssi, int8_t *snr);
+
     void printf_ba(const uint8_t* ba, size_t len);
 
 #endif
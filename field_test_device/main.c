@@ -38,30 +38,9 @@
 
 #include "git_utils.h"
 #include "wdt_utils.h"
+#include "payload.h"
+#include "sensors.h"
 
-#if DS75LX == 1
-#include "ds75lx.h"
-#include "ds75lx_params.h"
-#endif
-
-#if AT30TES75X == 1
-#include "at30tse75x.h"
-#endif
-
-#if MODULE_MAG3110 == 1
-#include "mag3110.h"
-#include "mag3110_params.h"
-#endif
-
-#if MODULE_MMA8X5X == 1
-#include "mma8x5x.h"
-#include "mma8x5x_params.h"
-#endif
-
-#if MODULE_MPL3115A2 == 1
-#include "mpl3115a2.h"
-#include "mpl3115a2_params.h"
-#endif
 
 
 #if MODULE_BME680 == 1
@@ -71,37 +50,24 @@
 
 #if GPS == 1
 #include "gps.h"
+#include "app.h"
+#include "gps_track.h"
+#if GPS_CACHE == 1
+#include "gps_cache.h"
+#endif
 #endif
 
 #include "app_clock.h"
 #include "benchmark.h"
+#include "drpwsz.h"
+#include "vdev.h"
+#include "downlink.h"
 
 #include <random.h>
 
 /* Declare globally the loramac descriptor */
 extern semtech_loramac_t loramac;
 
-/* Declare globally the sensor device descriptor */
-#if MODULE_DS75LX == 1
-ds75lx_t ds75lx;
-#endif
-
-#if MODULE_AT30TES75X == 1
-at30tse75x_t at30tse75x;
-#endif
-
-#if MODULE_MAG3110 == 1
-static mag3110_t mag3110;
-#endif
-
-#if MODULE_MMA8X5X == 1
-static mma8x5x_t mma8x5x;
-#endif
-
-#if MODULE_MPL3115A2 == 1
-static mpl3115a2_t mpl3115a2;
-#endif
-
 // Count the number of elements in an array.
 #define CNT(array) (uint8_t)(sizeof(array) / sizeof(*array))
 
@@ -120,16 +86,12 @@ static mpl3115a2_t mpl3115a2;
 
 #define PORT_DN_TEXT                    101
 #define PORT_DN_SET_TX_PERIOD           3
+#define PORT_DN_SET_DRPWSZ_SEQUENCE     4
 #define PORT_DN_REBOOT_NOW           	64
 #define PORT_DN_REBOOT_ONE_MINUTE       65
 #define PORT_DN_REBOOT_ONE_HOUR         66
 
 
-#ifndef VIRT_DEV
-#define VIRT_DEV 						(1U)
-#endif
-
-
 /* Implement the receiver thread */
 #define RECEIVER_MSG_QUEUE                          (4U)
 
@@ -145,8 +107,6 @@ static uint8_t appkey[LORAMAC_APPKEY_LEN] ;
 
 #else
 
-// static uint32_t* devaddr = { DEVADDRS };
-
 static uint8_t devaddr[LORAMAC_DEVADDR_LEN] ;
 static uint8_t appskey[LORAMAC_NWKSKEY_LEN] ;
 static uint8_t nwkskey[LORAMAC_APPSKEY_LEN] ;
@@ -161,200 +121,85 @@ static uint16_t tx_period = TX_PERIOD;
 static void init_sensors(void){
 
     uint8_t port = PORT_UP_DATA;
-    int result;
-
-	(void) result;
 
 #if GPS == 1
     DEBUG("[gps] GPS is enabled (baudrate=%d)\n",STD_BAUDRATE);
+    uart_gps_thread_start();
 #endif
 
-#if MODULE_DS75LX == 1
-    DEBUG("[ds75lx] DS75LX sensor is enabled\n");
-
-    result = ds75lx_init(&ds75lx, &ds75lx_params[0]);
-    if (result != DS75LX_OK)
-    {
-        DEBUG("[error] Failed to initialize DS75LX sensor\n");
+    if (!sensors_init()) {
         port = PORT_UP_ERROR;
     }
-#endif
-
-#if MODULE_AT30TES75X == 1
-    DEBUG("[at30tse75x] AT30TES75X sensor is enabled\n");
-
-    result = at30tse75x_init(&at30tse75x, PORT_A, AT30TSE75X_TEMP_ADDR);
-    if (result != 0)
-    {
-        DEBUG("[error] Failed to initialize AT30TES75X sensor\n");
-        port = PORT_UP_ERROR;
-    }
-#endif
-
-#if MODULE_MAG3110 == 1
-    puts("MAG3110 magnetometer driver test application\n");
-    printf("Initializing MAG3110 magnetometer at I2C_%i... ",
-           mag3110_params[0].i2c);
-    if (mag3110_init(&mag3110, &mag3110_params[0]) != MAG3110_OK) {
-        DEBUG("[error] Failed to initialize MAG3110 sensor\n");
-        port = PORT_UP_ERROR;
-    }
-#endif
-
-#if MODULE_MMA8X5X == 1
-    puts("MMA8652 accelerometer driver test application\n");
-    printf("Initializing MMA8652 accelerometer at I2C_DEV(%i)... ", mma8x5x_params->i2c);
-
-    result = mma8x5x_init(&mma8x5x, mma8x5x_params);
-    if(result != MMA8X5X_OK) {
-    	DEBUG("[error] Failed to initialize MMA8X5X sensor\n");
-    	port = PORT_UP_ERROR;
-    }
-#endif
-
-#if MODULE_MPL3115A2 == 1
-	result = mpl3115a2_init(&mpl3115a2, &mpl3115a2_params[0]);
-	if(result != MPL3115A2_OK) {
-    	DEBUG("[error] Failed to initialize MMA8X5X sensor\n");
-    	port = PORT_UP_ERROR;
-	}
-
-	if (mpl3115a2_set_active(&mpl3115a2) != MPL3115A2_OK) {
-		puts("[FAILED] activate measurement!");
-		port = PORT_UP_ERROR;
-	}
-#endif
-
+    sensors_start();
 
     semtech_loramac_set_tx_port(&loramac, port);
 }
 
-// Encode message data to the payload.
-unsigned int encode_sensors(uint8_t *payload, const unsigned int len) {
-
-	if(len < sizeof(int16_t)) {
-		return 0;
-	}
+// Set the sensor values of the payload, and encode the variable fields into the rest of it.
+unsigned int encode_sensors(payload_values_t *values, uint8_t *payload, const unsigned int len) {
 
-	int16_t temperature = 0;
+	// Last values of the sensors, sampled before the transmission.
+	sensors_snapshot_t sensors;
+	sensors_get(&sensors);
 
-#if MODULE_DS75LX == 1
-	{
-    /* measure temperature */
-    ds75lx_wakeup(&ds75lx);
-    /* Get temperature in degrees celsius */
-    ds75lx_read_temperature(&ds75lx, &temperature);
-    ds75lx_shutdown(&ds75lx);
-    DEBUG("[ds75lx] get temperature : temperature=%d\n",temperature);
-	}
+	values->temperature = sensors.temperature;
+#if SENSORS_PERIOD_MS > 0
+	values->temperature_min = sensors.window[SENSORS_TEMPERATURE].min;
+	values->temperature_max = sensors.window[SENSORS_TEMPERATURE].max;
+	values->temperature_mean = sensors.window[SENSORS_TEMPERATURE].mean;
+	values->samples = (sensors.window_count < 0xFF) ? sensors.window_count : 0xFF;
 #endif
-
-#if MODULE_AT30TES75X == 1
-    {
-    /* measure temperature */
-    //at30tse75x_wakeup(&at30tse75x);
-    /* Get temperature in degrees celsius */
-    float ftemp;
-    at30tse75x_get_temperature(&at30tse75x, &ftemp);
-    temperature = (int16_t)(ftemp * 100);
-    //at30tse75x_shutdown(&at30tse75x);
-    DEBUG("[at30tse75x] get temperature : temperature=%d\n",temperature);
-    }
-#endif
-
-    unsigned int i = 0;
-
-    // Encode temperature.
-	payload[i++] = (temperature >> 8) & 0xFF;
-	payload[i++] = (temperature >> 0) & 0xFF;
-
-	if(len < i + (3*4)) {
-		return i;
-	}
-
-#if MODULE_MAG3110 == 1
-    {
-    mag3110_data_t data;
-    int8_t temp;
-    mag3110_read(&mag3110, &data);
-    printf("Field strength: X: %d Y: %d Z: %d\n", data.x, data.y, data.z);
-    mag3110_read_dtemp(&mag3110, &temp);
-    printf("Die Temperature T: %d\n", temp);
-    // TODO add to payload
-    }
-#endif
-
-	if(len < i + (3*4)) {
-		return i;
-	}
-
-#if MODULE_MMA8X5X == 1
-    {
-    mma8x5x_data_t data;
-    mma8x5x_read(&mma8x5x, &data);
-
-    printf("Acceleration [in mg]: X: %d Y: %d Z: %d\n", data.x, data.y, data.z);
-    // TODO add to payload
-    }
-#endif
-
-    if(len < i + (2+2+1)) {
-		return i;
-	}
-
 #if MODULE_MPL3115A2 == 1
-    {
-    uint32_t pressure;
-    int16_t temperature;
-    uint8_t status;
-    if ((mpl3115a2_read_pressure(&mpl3115a2, &pressure, &status) |
-         mpl3115a2_read_temp(&mpl3115a2, &temperature)) != MPL3115A2_OK) {
-        puts("[FAILED] read MPL3115A2 values!");
-    } else {
-        printf("Pressure: %u Pa, Temperature: %3d.%d C, State: %#02x\n",
-               (unsigned int)pressure, temperature/10, abs(temperature%10), status);
-    }
-
-	payload[i++] = (pressure >> 24) & 0xFF;
-	payload[i++] = (pressure >> 16) & 0xFF;
-
-	payload[i++] = (temperature >> 8) & 0xFF;
-	payload[i++] = (temperature >> 0) & 0xFF;
-
-	payload[i++] = (status) & 0xFF;
-
-    // TODO add to payload
-    }
+	// Pressure in 2 Pa (up to 131070 Pa on 16 bits).
+	values->pressure = sensors.pressure / 2;
+	values->pressure_temperature = sensors.pressure_temperature;
+	values->pressure_status = sensors.pressure_status;
+#if SENSORS_PERIOD_MS > 0
+	values->pressure_min = sensors.window[SENSORS_PRESSURE].min / 2;
+	values->pressure_max = sensors.window[SENSORS_PRESSURE].max / 2;
+	values->pressure_mean = sensors.window[SENSORS_PRESSURE].mean / 2;
+#endif
 #endif
-
-	if(len < i + (2*3)+ sizeof(int16_t)) {
-		return i;
-	}
 
 	int32_t lat = 0;
 	int32_t lon = 0;
 	int16_t alt = 0;
 
 #if GPS == 1
-	gps_get_binary(&lat, &lon, &alt);
+	uint8_t gps_status = gps_get_binary(&lat, &lon, &alt);
     DEBUG("[gps] get position : lat=%ld, lon=%ld, alt=%d\n",lat,lon,alt);
+#if GPS_CACHE == 1
+	gps_cache_update();
+#endif
 #endif
 
-    // Encode latitude (on 24 bits).
-	payload[i++] = ((uint32_t)lat >> 16) & 0xFF;
-	payload[i++] = ((uint32_t)lat >> 8)  & 0xFF;
-	payload[i++] = ((uint32_t)lat >> 0)  & 0xFF;
-
-    // Encode longitude (on 24 bits).
-	payload[i++] = ((uint32_t)lon >> 16) & 0xFF;
-	payload[i++] = ((uint32_t)lon >> 8)  & 0xFF;
-	payload[i++] = ((uint32_t)lon >> 0)  & 0xFF;
+	values->latitude = lat;
+	values->longitude = lon;
+	// Signed, so that the packed encoding clamps the altitudes below the sea
+	// level to 0 (the fixed field keeps the 16 bits of the int16).
+	values->altitude = alt;
 
-    // Encode altitude (on 16 bits);
-	payload[i++] = ((int16_t)alt >> 8) & 0xFF;
-	payload[i++] = ((int16_t)alt >> 0) & 0xFF;
+	// Time to first fix since boot in seconds (0xFFFF before the first fix).
+	uint16_t ttff = 0xFFFF;
+#if GPS == 1
+	uint32_t ttff_ms = gps_get_ttff();
+	if (ttff_ms != 0) {
+		ttff = (ttff_ms / 1000 < 0xFFFF) ? ttff_ms / 1000 : 0xFFFE;
+	}
+#endif
+	values->ttff = ttff;
 
-	return sizeof(int16_t) + (2*3)+ sizeof(int16_t);
+#if GPS == 1
+	// Fill the rest of the payload with the recent fixes, as deltas from the position.
+	gps_fix_t fix;
+	if (gps_status == GPS_SUCCESS && gps_get_fix(&fix) == GPS_SUCCESS) {
+		return gps_track_encode(payload, len, lat, lon, alt, fix.timestamp);
+	}
+#else
+	(void)payload;
+	(void)len;
+#endif
+	return 0;
 }
 
 
@@ -370,13 +215,14 @@ static void sender(void)
 
     uint8_t drpwsz_sequence[] = { DRPWSZ_SEQUENCE };
     struct benchmark_t benchmark;
-    semtech_loramac_get_devaddr(&loramac, (uint8_t*)&benchmark.devaddr);
     benchmark.nb_virtual_devices = VIRT_DEV;
     benchmark.tx_period = &tx_period;
     benchmark.drpwsz_sequence_nb = CNT(drpwsz_sequence) / 3;
     benchmark.drpwsz_sequence = drpwsz_sequence;
     benchmark.txconfirmed = TXCNF;
     benchmark.adr = ADR_ON;
+    benchmark.size_sweep = SIZE_SWEEP;
+    benchmark.asap = TX_ASAP;
     benchmark.min_port = MIN_PORT;
     benchmark.max_port = MAX_PORT;
 
@@ -386,6 +232,25 @@ static void sender(void)
     return;
 }
 
+// Reboot the device, keeping the last fix for the next GNSS start.
+static void reboot(void)
+{
+#if GPS == 1 && GPS_CACHE == 1
+	gps_cache_save();
+#endif
+	pm_reboot();
+}
+
+// Publish the measurements of the downlink just received (for the next frames).
+static void publish_downlink(void)
+{
+    int16_t rssi;
+    int8_t snr;
+    loramac_utils_get_last_packet_status(&rssi, &snr);
+    downlink_publish(loramac_utils_get_downlink_counter(&loramac), rssi, snr);
+    DEBUG("[dn] rssi=%d snr=%d\n", rssi, snr);
+}
+
 static void *receiver(void *arg)
 {
     msg_init_queue(_receiver_queue, RECEIVER_MSG_QUEUE);
@@ -397,6 +262,7 @@ static void *receiver(void *arg)
         /* blocks until something is received */
         switch (semtech_loramac_recv(&loramac)) {
             case SEMTECH_LORAMAC_RX_DATA:
+                publish_downlink();
                 // TODO process Downlink payload
                 switch(loramac.rx_data.port) {
                     case PORT_DN_TEXT:
@@ -414,23 +280,29 @@ static void *receiver(void *arg)
                                  loramac.rx_data.port);
                         }
                         break;
+                    case PORT_DN_SET_DRPWSZ_SEQUENCE:
+                        if(!drpwsz_process_downlink(loramac.rx_data.payload, loramac.rx_data.payload_len)) {
+                            DEBUG("[dn] Data received: bad DRPWSZ sequence, port: %d\n",
+                                 loramac.rx_data.port);
+                        }
+                        break;
                     case APP_CLOCK_PORT:
                     	(void)app_clock_process_downlink(&loramac);
                     	break;
 
                     case PORT_DN_REBOOT_NOW:
                         DEBUG("[dn] Reboot now. port: %d\n", loramac.rx_data.port);
-            			pm_reboot();
+            			reboot();
                     	break;
                     case PORT_DN_REBOOT_ONE_MINUTE:
                         DEBUG("[dn] Reboot in 60 sec. port: %d\n", loramac.rx_data.port);
                         xtimer_sleep(60U);
-            			pm_reboot();
+            			reboot();
                     	break;
                     case PORT_DN_REBOOT_ONE_HOUR:
                         DEBUG("[dn] Reboot in 3600 sec. port: %d\n", loramac.rx_data.port);
                         xtimer_sleep(3600U);
-            			pm_reboot();
+            			reboot();
                     	break;
 
                     default:
@@ -442,6 +314,7 @@ static void *receiver(void *arg)
                 break;
 
 			case SEMTECH_LORAMAC_RX_LINK_CHECK:
+				publish_downlink();
 				DEBUG("[dn] Link check information:\n"
 				   "  - Demodulation margin: %d\n"
 				   "  - Number of gateways: %d\n",
@@ -450,6 +323,7 @@ static void *receiver(void *arg)
 				break;
 
 			case SEMTECH_LORAMAC_RX_CONFIRMED:
+				publish_downlink();
 				DEBUG("[dn] Received ACK from network\n");
 				break;
 
@@ -538,8 +412,6 @@ int main(void)
 #else
     /* Convert identifiers and application key */
 
-	// uint32_t devaddr = devaddrs[0];
-
     fmt_hex_bytes(devaddr, DEVADDR);
     fmt_hex_bytes(appskey, APPSKEY);
     fmt_hex_bytes(nwkskey, NWKSKEY);
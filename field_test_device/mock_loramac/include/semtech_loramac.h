@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Simulated MAC with the API of the semtech_loramac package.
+ *
+ * Replaces the package (LORAMAC_MOCK=1, e.g. on the native board) with the
+ * functions used by the application: join, send with the return codes of the
+ * MAC, time off of the duty cycle, random loss of the uplinks, and downlinks
+ * injected from a script file (see mock_loramac/downlinks.txt).
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef SEMTECH_LORAMAC_H
+#define SEMTECH_LORAMAC_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "mutex.h"
+#include "sched.h"
+#include "net/loramac.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef MOCK_LORAMAC_SCRIPT
+// Script of the downlinks (none if it cannot be opened).
+#define MOCK_LORAMAC_SCRIPT		"mock_loramac/downlinks.txt"
+#endif
+
+#ifndef MOCK_LORAMAC_LOSS
+// Loss rate of the uplinks in percent (a script can change it).
+#define MOCK_LORAMAC_LOSS		0
+#endif
+
+#ifndef MOCK_LORAMAC_DUTY_CYCLE
+// Divisor of the duty cycle of the uplinks (100 for 1 %, 0 without duty cycle).
+#define MOCK_LORAMAC_DUTY_CYCLE	100
+#endif
+
+#ifndef MOCK_LORAMAC_JOIN_FAILURES
+// Join requests that fail before the first join accept.
+#define MOCK_LORAMAC_JOIN_FAILURES	1
+#endif
+
+// Delays of the receive windows after an uplink, in ms (LoRaWAN defaults).
+#define MOCK_LORAMAC_RX1_DELAY_MS	1000
+#define MOCK_LORAMAC_RX2_DELAY_MS	2000
+#define MOCK_LORAMAC_JOIN_DELAY_MS	6000
+
+#define SEMTECH_LORAMAC_DOWNLINK_MAX_SIZE	242
+
+/**
+ * Return codes and events of the MAC (same values as the package).
+ */
+enum {
+	SEMTECH_LORAMAC_JOIN_SUCCEEDED,
+	SEMTECH_LORAMAC_JOIN_FAILED,
+	SEMTECH_LORAMAC_NOT_JOINED,
+	SEMTECH_LORAMAC_ALREADY_JOINED,
+	SEMTECH_LORAMAC_TX_OK,
+	SEMTECH_LORAMAC_TX_SCHEDULE,
+	SEMTECH_LORAMAC_TX_DONE,
+	SEMTECH_LORAMAC_TX_CNF_FAILED,
+	SEMTECH_LORAMAC_TX_ERROR,
+	SEMTECH_LORAMAC_RX_DATA,
+	SEMTECH_LORAMAC_RX_LINK_CHECK,
+	SEMTECH_LORAMAC_RX_CONFIRMED,
+	SEMTECH_LORAMAC_BUSY,
+	SEMTECH_LORAMAC_DUTYCYCLE_RESTRICTED,
+};
+
+typedef struct {
+	uint8_t payload[SEMTECH_LORAMAC_DOWNLINK_MAX_SIZE + 1];
+	uint8_t payload_len;
+	uint8_t port;
+} semtech_loramac_rx_data_t;
+
+typedef struct {
+	uint8_t demod_margin;
+	uint8_t nb_gateways;
+} semtech_loramac_link_check_info_t;
+
+typedef struct {
+	mutex_t lock;
+	kernel_pid_t rx_pid;			// thread blocked in semtech_loramac_recv()
+	semtech_loramac_rx_data_t rx_data;
+	semtech_loramac_link_check_info_t link_chk;
+	uint8_t deveui[LORAMAC_DEVEUI_LEN];
+	uint8_t appeui[LORAMAC_APPEUI_LEN];
+	uint8_t appkey[LORAMAC_APPKEY_LEN];
+	uint8_t devaddr[LORAMAC_DEVADDR_LEN];
+	uint8_t nwkskey[LORAMAC_NWKSKEY_LEN];
+	uint8_t appskey[LORAMAC_APPSKEY_LEN];
+	bool joined;
+	bool adr;
+	uint8_t dr;
+	uint8_t tx_power;
+	uint8_t tx_mode;
+	uint8_t port;
+	uint32_t fcnt_up;
+	uint32_t fcnt_down;
+	uint32_t uplinks;				// uplinks sent since boot (index of the script)
+	uint64_t ready_usec;			// end of the time off of the duty cycle
+	int16_t rssi;					// of the last downlink
+	int8_t snr;
+} semtech_loramac_t;
+
+int semtech_loramac_init(semtech_loramac_t *mac);
+uint8_t semtech_loramac_join(semtech_loramac_t *mac, uint8_t type);
+uint8_t semtech_loramac_send(semtech_loramac_t *mac, uint8_t *data, uint8_t len);
+uint8_t semtech_loramac_recv(semtech_loramac_t *mac);
+
+void semtech_loramac_set_deveui(semtech_loramac_t *mac, const uint8_t *eui);
+void semtech_loramac_get_deveui(semtech_loramac_t *mac, uint8_t *eui);
+void semtech_loramac_set_appeui(semtech_loramac_t *mac, const uint8_t *eui);
+void semtech_loramac_get_appeui(semtech_loramac_t *mac, uint8_t *eui);
+void semtech_loramac_set_appkey(semtech_loramac_t *mac, const uint8_t *key);
+void semtech_loramac_get_appkey(semtech_loramac_t *mac, uint8_t *key);
+void semtech_loramac_set_appskey(semtech_loramac_t *mac, const uint8_t *skey);
+void semtech_loramac_get_appskey(semtech_loramac_t *mac, uint8_t *skey);
+void semtech_loramac_set_nwkskey(semtech_loramac_t *mac, const uint8_t *skey);
+void semtech_loramac_get_nwkskey(semtech_loramac_t *mac, uint8_t *skey);
+void semtech_loramac_set_devaddr(semtech_loramac_t *mac, const uint8_t *addr);
+void semtech_loramac_get_devaddr(semtech_loramac_t *mac, uint8_t *addr);
+
+void semtech_loramac_set_dr(semtech_loramac_t *mac, uint8_t dr);
+uint8_t semtech_loramac_get_dr(semtech_loramac_t *mac);
+void semtech_loramac_set_adr(semtech_loramac_t *mac, bool adr);
+bool semtech_loramac_get_adr(semtech_loramac_t *mac);
+void semtech_loramac_set_tx_power(semtech_loramac_t *mac, uint8_t power);
+uint8_t semtech_loramac_get_tx_power(semtech_loramac_t *mac);
+void semtech_loramac_set_tx_mode(semtech_loramac_t *mac, uint8_t mode);
+uint8_t semtech_loramac_get_tx_mode(semtech_loramac_t *mac);
+void semtech_loramac_set_tx_port(semtech_loramac_t *mac, uint8_t port);
+uint8_t semtech_loramac_get_tx_port(semtech_loramac_t *mac);
+void semtech_loramac_set_uplink_counter(semtech_loramac_t *mac, uint32_t counter);
+uint32_t semtech_loramac_get_uplink_counter(semtech_loramac_t *mac);
+
+/**
+ * Get the frame counter of the last downlink (FCntDown).
+ */
+uint32_t mock_loramac_get_downlink_counter(semtech_loramac_t *mac);
+
+/**
+ * Get the RSSI and the SNR of the last downlink.
+ */
+void mock_loramac_get_last_packet_status(semtech_loramac_t *mac, int16_t *rssi, int8_t *snr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SEMTECH_LORAMAC_H */
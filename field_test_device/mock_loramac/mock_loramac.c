@@ -0,0 +1,407 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Simulated MAC with the API of the semtech_loramac package.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "fmt.h"
+#include "msg.h"
+#include "thread.h"
+#include "xtimer.h"
+#include "random.h"
+
+#include "net/loramac.h"
+#include "semtech_loramac.h"
+#include "loramac_utils.h"
+#include "time_on_air.h"
+
+#ifndef MOCK_LORAMAC_EVENTS
+// Events of the script.
+#define MOCK_LORAMAC_EVENTS		32
+#endif
+
+#define MOCK_LORAMAC_DOWNLINK_LEN	64
+
+// RSSI and SNR of the downlinks without them in the script (and of the ACKs).
+#define MOCK_LORAMAC_RSSI		-90
+#define MOCK_LORAMAC_SNR		7
+
+typedef enum {
+	MOCK_LORAMAC_DOWNLINK,
+	MOCK_LORAMAC_LINKCHECK,
+	MOCK_LORAMAC_LOSS_RATE,
+} mock_loramac_event_type_t;
+
+typedef struct {
+	mock_loramac_event_type_t type;
+	uint32_t uplink;			// index of the uplink since boot (from 1)
+	uint8_t port;				// or the demodulation margin, or the loss rate
+	uint8_t len;				// or the number of gateways
+	int16_t rssi;
+	int8_t snr;
+	uint8_t payload[MOCK_LORAMAC_DOWNLINK_LEN];
+} mock_loramac_event_t;
+
+/* Declare globally the loramac descriptor (as auto_init_loramac) */
+semtech_loramac_t loramac = {
+	.lock = MUTEX_INIT,
+	.rx_pid = KERNEL_PID_UNDEF,
+	.dr = LORAMAC_DEFAULT_DR,
+	.tx_power = LORAMAC_DEFAULT_TX_POWER,
+	.tx_mode = LORAMAC_DEFAULT_TX_MODE,
+	.port = LORAMAC_DEFAULT_TX_PORT,
+	.adr = LORAMAC_DEFAULT_ADR,
+};
+
+static mock_loramac_event_t mock_loramac_events[MOCK_LORAMAC_EVENTS];
+static unsigned mock_loramac_events_nb = 0;
+static unsigned mock_loramac_loss = MOCK_LORAMAC_LOSS;
+static unsigned mock_loramac_join_failures = MOCK_LORAMAC_JOIN_FAILURES;
+static bool mock_loramac_loaded = false;
+
+// Parse a line of the script into an event (false for the comments, the empty
+// lines and the errors).
+static bool mock_loramac_parse(const char *line, mock_loramac_event_t *event)
+{
+	char keyword[16];
+	char hex[2 * MOCK_LORAMAC_DOWNLINK_LEN + 2];
+	unsigned uplink, a, b;
+	int rssi = MOCK_LORAMAC_RSSI, snr = MOCK_LORAMAC_SNR;
+
+	if (sscanf(line, "%15s", keyword) != 1 || keyword[0] == '#') {
+		return false;
+	}
+	memset(event, 0, sizeof(*event));
+	if (strcmp(keyword, "downlink") == 0
+			&& sscanf(line, "%*s %u %u %129s %d %d", &uplink, &a, hex, &rssi, &snr) >= 3
+			&& a > 0 && a < 224 && strlen(hex) <= 2 * MOCK_LORAMAC_DOWNLINK_LEN
+			&& strlen(hex) % 2 == 0) {
+		event->type = MOCK_LORAMAC_DOWNLINK;
+		event->port = a;
+		event->len = fmt_hex_bytes(event->payload, hex);
+		event->rssi = rssi;
+		event->snr = snr;
+	} else if (strcmp(keyword, "linkcheck") == 0
+			&& sscanf(line, "%*s %u %u %u", &uplink, &a, &b) == 3 && a <= 0xff && b <= 0xff) {
+		event->type = MOCK_LORAMAC_LINKCHECK;
+		event->port = a;
+		event->len = b;
+	} else if (strcmp(keyword, "loss") == 0
+			&& sscanf(line, "%*s %u %u", &uplink, &a) == 2 && a <= 100) {
+		event->type = MOCK_LORAMAC_LOSS_RATE;
+		event->port = a;
+	} else {
+		DEBUG("[mock] bad line in the script: %s", line);
+		return false;
+	}
+	event->uplink = uplink;
+	return true;
+}
+
+// Load the script once, before the first join (the file is not read afterwards).
+static void mock_loramac_load_script(void)
+{
+	if (mock_loramac_loaded) {
+		return;
+	}
+	mock_loramac_loaded = true;
+
+	FILE *script = fopen(MOCK_LORAMAC_SCRIPT, "r");
+	if (script == NULL) {
+		DEBUG("[mock] no script %s\n", MOCK_LORAMAC_SCRIPT);
+		return;
+	}
+	char line[256];
+	while (fgets(line, sizeof(line), script) != NULL) {
+		if (mock_loramac_events_nb == MOCK_LORAMAC_EVENTS) {
+			DEBUG("[mock] more than %d events in the script\n", MOCK_LORAMAC_EVENTS);
+			break;
+		}
+		if (mock_loramac_parse(line, &mock_loramac_events[mock_loramac_events_nb])) {
+			mock_loramac_events_nb++;
+		}
+	}
+	fclose(script);
+	DEBUG("[mock] %u events in the script %s\n", mock_loramac_events_nb, MOCK_LORAMAC_SCRIPT);
+}
+
+int semtech_loramac_init(semtech_loramac_t *mac)
+{
+	mock_loramac_load_script();
+	mac->dr = LORAMAC_DEFAULT_DR;
+	mac->tx_power = LORAMAC_DEFAULT_TX_POWER;
+	mac->tx_mode = LORAMAC_DEFAULT_TX_MODE;
+	mac->port = LORAMAC_DEFAULT_TX_PORT;
+	mac->adr = LORAMAC_DEFAULT_ADR;
+	return 0;
+}
+
+uint8_t semtech_loramac_join(semtech_loramac_t *mac, uint8_t type)
+{
+	mock_loramac_load_script();
+	if (mac->joined) {
+		return SEMTECH_LORAMAC_ALREADY_JOINED;
+	}
+	if (type == LORAMAC_JOIN_OTAA) {
+		// the join accept comes in the RX1 window of the join request
+		xtimer_msleep(MOCK_LORAMAC_JOIN_DELAY_MS);
+		if (mock_loramac_join_failures > 0) {
+			mock_loramac_join_failures--;
+			return SEMTECH_LORAMAC_JOIN_FAILED;
+		}
+		// a session derived from the DevEUI
+		memcpy(mac->devaddr, mac->deveui + LORAMAC_DEVEUI_LEN - LORAMAC_DEVADDR_LEN, LORAMAC_DEVADDR_LEN);
+		memcpy(mac->nwkskey, mac->appkey, LORAMAC_NWKSKEY_LEN);
+		memcpy(mac->appskey, mac->appkey, LORAMAC_APPSKEY_LEN);
+		mac->nwkskey[0] ^= 0x01;
+		mac->appskey[0] ^= 0x02;
+		mac->fcnt_up = 0;
+		mac->fcnt_down = 0;
+	}
+	mac->joined = true;
+	return SEMTECH_LORAMAC_JOIN_SUCCEEDED;
+}
+
+// Deliver an event to the thread blocked in semtech_loramac_recv().
+static void mock_loramac_deliver(semtech_loramac_t *mac, uint8_t type, int16_t rssi, int8_t snr)
+{
+	mac->fcnt_down++;
+	mac->rssi = rssi;
+	mac->snr = snr;
+	if (mac->rx_pid != KERNEL_PID_UNDEF) {
+		msg_t msg = { .type = type };
+		msg_try_send(&msg, mac->rx_pid);
+	}
+}
+
+uint8_t semtech_loramac_send(semtech_loramac_t *mac, uint8_t *data, uint8_t len)
+{
+	(void)data;
+
+	if (!mac->joined) {
+		return SEMTECH_LORAMAC_NOT_JOINED;
+	}
+	if (!mutex_trylock(&mac->lock)) {
+		return SEMTECH_LORAMAC_BUSY;
+	}
+	uint64_t now = xtimer_now_usec64();
+	if (now < mac->ready_usec) {
+		mutex_unlock(&mac->lock);
+		return SEMTECH_LORAMAC_DUTYCYCLE_RESTRICTED;
+	}
+	if (len > loramac_utils_max_payload_size(mac->dr)) {
+		mutex_unlock(&mac->lock);
+		return SEMTECH_LORAMAC_TX_ERROR;
+	}
+
+	mac->uplinks++;
+	mac->fcnt_up++;
+	for (unsigned i = 0; i < mock_loramac_events_nb; i++) {
+		if (mock_loramac_events[i].type == MOCK_LORAMAC_LOSS_RATE
+				&& mock_loramac_events[i].uplink == mac->uplinks) {
+			mock_loramac_loss = mock_loramac_events[i].port;
+		}
+	}
+	bool lost = random_uint32_range(0, 100) < mock_loramac_loss;
+
+	uint32_t toa = time_on_air_us(mac->dr, len);
+#if MOCK_LORAMAC_DUTY_CYCLE > 0
+	mac->ready_usec = now + (uint64_t)toa * MOCK_LORAMAC_DUTY_CYCLE;
+#endif
+	DEBUG("[mock] uplink %lu: fcnt=%lu dr=%d len=%d toa=%lu us%s\n",
+		mac->uplinks, mac->fcnt_up, mac->dr, len, toa, lost ? " lost" : "");
+
+	// the RX1 window, then the RX2 window without a downlink
+	xtimer_usleep64(toa + (uint64_t)MOCK_LORAMAC_RX1_DELAY_MS * US_PER_MS);
+	uint8_t ret = SEMTECH_LORAMAC_TX_DONE;
+	bool received = false;
+	for (unsigned i = 0; !lost && i < mock_loramac_events_nb; i++) {
+		mock_loramac_event_t *event = &mock_loramac_events[i];
+		if (event->uplink != mac->uplinks) {
+			continue;
+		}
+		if (event->type == MOCK_LORAMAC_DOWNLINK) {
+			memcpy(mac->rx_data.payload, event->payload, event->len);
+			mac->rx_data.payload_len = event->len;
+			mac->rx_data.port = event->port;
+			mock_loramac_deliver(mac, SEMTECH_LORAMAC_RX_DATA, event->rssi, event->snr);
+			received = true;
+		} else if (event->type == MOCK_LORAMAC_LINKCHECK) {
+			mac->link_chk.demod_margin = event->port;
+			mac->link_chk.nb_gateways = event->len;
+			mock_loramac_deliver(mac, SEMTECH_LORAMAC_RX_LINK_CHECK, MOCK_LORAMAC_RSSI, MOCK_LORAMAC_SNR);
+			received = true;
+		}
+	}
+	if (mac->tx_mode == LORAMAC_TX_CNF) {
+		if (lost) {
+			ret = SEMTECH_LORAMAC_TX_CNF_FAILED;
+		} else if (!received) {
+			mock_loramac_deliver(mac, SEMTECH_LORAMAC_RX_CONFIRMED, MOCK_LORAMAC_RSSI, MOCK_LORAMAC_SNR);
+		}
+	}
+	if (!received) {
+		xtimer_msleep(MOCK_LORAMAC_RX2_DELAY_MS - MOCK_LORAMAC_RX1_DELAY_MS);
+	}
+	mutex_unlock(&mac->lock);
+	return ret;
+}
+
+uint8_t semtech_loramac_recv(semtech_loramac_t *mac)
+{
+	msg_t msg;
+	mac->rx_pid = thread_getpid();
+	msg_receive(&msg);
+	return msg.type;
+}
+
+void semtech_loramac_set_deveui(semtech_loramac_t *mac, const uint8_t *eui)
+{
+	memcpy(mac->deveui, eui, LORAMAC_DEVEUI_LEN);
+}
+
+void semtech_loramac_get_deveui(semtech_loramac_t *mac, uint8_t *eui)
+{
+	memcpy(eui, mac->deveui, LORAMAC_DEVEUI_LEN);
+}
+
+void semtech_loramac_set_appeui(semtech_loramac_t *mac, const uint8_t *eui)
+{
+	memcpy(mac->appeui, eui, LORAMAC_APPEUI_LEN);
+}
+
+void semtech_loramac_get_appeui(semtech_loramac_t *mac, uint8_t *eui)
+{
+	memcpy(eui, mac->appeui, LORAMAC_APPEUI_LEN);
+}
+
+void semtech_loramac_set_appkey(semtech_loramac_t *mac, const uint8_t *key)
+{
+	memcpy(mac->appkey, key, LORAMAC_APPKEY_LEN);
+}
+
+void semtech_loramac_get_appkey(semtech_loramac_t *mac, uint8_t *key)
+{
+	memcpy(key, mac->appkey, LORAMAC_APPKEY_LEN);
+}
+
+void semtech_loramac_set_appskey(semtech_loramac_t *mac, const uint8_t *skey)
+{
+	memcpy(mac->appskey, skey, LORAMAC_APPSKEY_LEN);
+}
+
+void semtech_loramac_get_appskey(semtech_loramac_t *mac, uint8_t *skey)
+{
+	memcpy(skey, mac->appskey, LORAMAC_APPSKEY_LEN);
+}
+
+void semtech_loramac_set_nwkskey(semtech_loramac_t *mac, const uint8_t *skey)
+{
+	memcpy(mac->nwkskey, skey, LORAMAC_NWKSKEY_LEN);
+}
+
+void semtech_loramac_get_nwkskey(semtech_loramac_t *mac, uint8_t *skey)
+{
+	memcpy(skey, mac->nwkskey, LORAMAC_NWKSKEY_LEN);
+}
+
+void semtech_loramac_set_devaddr(semtech_loramac_t *mac, const uint8_t *addr)
+{
+	memcpy(mac->devaddr, addr, LORAMAC_DEVADDR_LEN);
+}
+
+void semtech_loramac_get_devaddr(semtech_loramac_t *mac, uint8_t *addr)
+{
+	memcpy(addr, mac->devaddr, LORAMAC_DEVADDR_LEN);
+}
+
+void semtech_loramac_set_dr(semtech_loramac_t *mac, uint8_t dr)
+{
+	mac->dr = dr;
+}
+
+uint8_t semtech_loramac_get_dr(semtech_loramac_t *mac)
+{
+	return mac->dr;
+}
+
+void semtech_loramac_set_adr(semtech_loramac_t *mac, bool adr)
+{
+	mac->adr = adr;
+}
+
+bool semtech_loramac_get_adr(semtech_loramac_t *mac)
+{
+	return mac->adr;
+}
+
+void semtech_loramac_set_tx_power(semtech_loramac_t *mac, uint8_t power)
+{
+	mac->tx_power = power;
+}
+
+uint8_t semtech_loramac_get_tx_power(semtech_loramac_t *mac)
+{
+	return mac->tx_power;
+}
+
+void semtech_loramac_set_tx_mode(semtech_loramac_t *mac, uint8_t mode)
+{
+	mac->tx_mode = mode;
+}
+
+uint8_t semtech_loramac_get_tx_mode(semtech_loramac_t *mac)
+{
+	return mac->tx_mode;
+}
+
+void semtech_loramac_set_tx_port(semtech_loramac_t *mac, uint8_t port)
+{
+	mac->port = port;
+}
+
+uint8_t semtech_loramac_get_tx_port(semtech_loramac_t *mac)
+{
+	return mac->port;
+}
+
+void semtech_loramac_set_uplink_counter(semtech_loramac_t *mac, uint32_t counter)
+{
+	mac->fcnt_up = counter;
+}
+
+uint32_t semtech_loramac_get_uplink_counter(semtech_loramac_t *mac)
+{
+	return mac->fcnt_up;
+}
+
+uint32_t mock_loramac_get_downlink_counter(semtech_loramac_t *mac)
+{
+	return mac->fcnt_down;
+}
+
+void mock_loramac_get_last_packet_status(semtech_loramac_t *mac, int16_t *rssi, int8_t *snr)
+{
+	*rssi = mac->rssi;
+	*snr = mac->snr;
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Encoder and decoder of the fixed fields of the uplink payload.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "payload.h"
+
+// The format shares the first byte with the txpower idx.
+_Static_assert(PAYLOAD_OFFSET(txpower) == 0, "the txpower idx must be the first field");
+
+// Store a field in big endian (the width is a constant, so the loop is unrolled).
+static inline void payload_put(uint8_t *field, uint32_t value, unsigned int bytes)
+{
+	for (unsigned int k = 0; k < bytes; k++) {
+		field[k] = (value >> (8 * (bytes - 1 - k))) & 0xFF;
+	}
+}
+
+// Load a big endian field.
+static inline int32_t payload_get(const uint8_t *field, bool sign, unsigned int bytes)
+{
+	uint32_t value = 0;
+	for (unsigned int k = 0; k < bytes; k++) {
+		value = (value << 8) | field[k];
+	}
+	if (sign && bytes < 4 && (value & (1UL << (8 * bytes - 1)))) {
+		value |= ~0UL << (8 * bytes);
+	}
+	return (int32_t)value;
+}
+
+// Position of the anchor in the 24-bit encoding.
+#define PAYLOAD_PACKED_BINARY(degrees, range) \
+	(int32_t)((degrees) * 8388607 / (range) + (((degrees) < 0) ? -0.5 : 0.5))
+#define PAYLOAD_PACKED_ANCHOR_LAT_BIN	PAYLOAD_PACKED_BINARY(PAYLOAD_PACKED_ANCHOR_LAT, 90)
+#define PAYLOAD_PACKED_ANCHOR_LON_BIN	PAYLOAD_PACKED_BINARY(PAYLOAD_PACKED_ANCHOR_LON, 180)
+
+// Delta of the bit-packed positions without fix.
+#define PAYLOAD_PACKED_NO_FIX	(-2048)
+
+// Clamp a value to a field of the bit-packed payload.
+static inline int32_t payload_clamp(int32_t value, int32_t min, int32_t max)
+{
+	return (value < min) ? min : (value > max) ? max : value;
+}
+
+// Round a value to a multiple of 2^shift (the quotient).
+static inline int32_t payload_round(int32_t value, unsigned int shift)
+{
+	int32_t half = (1L << shift) >> 1;
+	return (value >= 0) ? (value + half) >> shift : -((-value + half) >> shift);
+}
+
+// Append a field to the bit-packed payload.
+static inline uint64_t payload_pack(uint64_t bits, int32_t value, unsigned int width)
+{
+	return (bits << width) | ((uint32_t)value & ((1UL << width) - 1));
+}
+
+// Extract the field at the given bit (from the most significant one) of the bit-packed payload.
+static inline int32_t payload_unpack(uint64_t bits, unsigned int bit, unsigned int width, bool sign)
+{
+	uint32_t value = (bits >> (64 - bit - width)) & ((1UL << width) - 1);
+	if (sign && (value & (1UL << (width - 1)))) {
+		value |= ~0UL << width;
+	}
+	return (int32_t)value;
+}
+
+unsigned int payload_encode_packed(uint8_t *payload, unsigned int len, const payload_values_t *values)
+{
+	if (len < PAYLOAD_PACKED_LEN) {
+		return 0;
+	}
+
+	int32_t dlat = PAYLOAD_PACKED_NO_FIX;
+	int32_t dlon = PAYLOAD_PACKED_NO_FIX;
+	if (values->latitude != 0 || values->longitude != 0) {
+		dlat = payload_clamp(payload_round(values->latitude - PAYLOAD_PACKED_ANCHOR_LAT_BIN, PAYLOAD_PACKED_SHIFT), -2047, 2047);
+		dlon = payload_clamp(payload_round(values->longitude - PAYLOAD_PACKED_ANCHOR_LON_BIN, PAYLOAD_PACKED_SHIFT), -2047, 2047);
+	}
+
+	// Temperature from 0.01 °C to 0.1 °C (rounded).
+	int32_t temperature = (values->temperature + ((values->temperature < 0) ? -5 : 5)) / 10;
+
+	uint64_t bits = PAYLOAD_FORMAT_PACKED;
+	bits = payload_pack(bits, payload_clamp(values->txpower, 0, 15), 4);
+	bits = payload_pack(bits, payload_clamp(values->datarate, 0, 15), 4);
+	bits = payload_pack(bits, payload_clamp(temperature, -2048, 2047), 12);
+	bits = payload_pack(bits, dlat, 12);
+	bits = payload_pack(bits, dlon, 12);
+	// Altitude in 2 m (rounded), 0 below the sea level.
+	bits = payload_pack(bits, payload_clamp((values->altitude + 1) / 2, 0, 0xFFFF), 16);
+
+	payload_put(payload, bits >> 32, 4);
+	payload_put(payload + 4, bits, 4);
+	return PAYLOAD_PACKED_LEN;
+}
+
+unsigned int payload_decode_packed(const uint8_t *payload, unsigned int len, payload_values_t *values)
+{
+	memset(values, 0, sizeof(*values));
+
+	if (len < PAYLOAD_PACKED_LEN || (payload[0] >> 4) != PAYLOAD_FORMAT_PACKED) {
+		return 0;
+	}
+
+	uint64_t bits = ((uint64_t)(uint32_t)payload_get(payload, false, 4) << 32) |
+		(uint32_t)payload_get(payload + 4, false, 4);
+
+	values->txpower = payload_unpack(bits, 4, 4, false);
+	values->datarate = payload_unpack(bits, 8, 4, false);
+	values->temperature = payload_unpack(bits, 12, 12, true) * 10;
+	int32_t dlat = payload_unpack(bits, 24, 12, true);
+	int32_t dlon = payload_unpack(bits, 36, 12, true);
+	if (dlat != PAYLOAD_PACKED_NO_FIX || dlon != PAYLOAD_PACKED_NO_FIX) {
+		values->latitude = PAYLOAD_PACKED_ANCHOR_LAT_BIN + dlat * (1L << PAYLOAD_PACKED_SHIFT);
+		values->longitude = PAYLOAD_PACKED_ANCHOR_LON_BIN + dlon * (1L << PAYLOAD_PACKED_SHIFT);
+		values->altitude = payload_unpack(bits, 48, 16, false) * 2;
+	}
+	return PAYLOAD_PACKED_LEN;
+}
+
+unsigned int payload_encode(uint8_t *payload, unsigned int len, const payload_values_t *values)
+{
+	// Below the bit-packed payload, the fixed fields are truncated instead.
+	if (PAYLOAD_IS_PACKED(len)) {
+		return payload_encode_packed(payload, len, values);
+	}
+
+	// The fields are written at constant offsets, into a copy when the payload is too short.
+	uint8_t fields[PAYLOAD_FIELDS_LEN];
+	uint8_t *p = (len < PAYLOAD_FIELDS_LEN) ? fields : payload;
+
+#define X(name, key, sign, bytes, divisor) \
+	payload_put(p + PAYLOAD_OFFSET(name), (uint32_t)values->name, bytes);
+	PAYLOAD_FIELDS(X)
+#undef X
+	p[PAYLOAD_OFFSET(txpower)] |= PAYLOAD_FORMAT_FIELDS << 4;
+
+	if (p == fields) {
+		memcpy(payload, fields, len);
+		return len;
+	}
+	return PAYLOAD_FIELDS_LEN;
+}
+
+unsigned int payload_decode(const uint8_t *payload, unsigned int len, payload_values_t *values)
+{
+	memset(values, 0, sizeof(*values));
+
+	if (len == 0 || (payload[PAYLOAD_OFFSET(txpower)] >> 4) != PAYLOAD_FORMAT_FIELDS) {
+		return 0;
+	}
+
+#define X(name, key, sign, bytes, divisor) \
+	if (PAYLOAD_OFFSET(name) + bytes <= len) { \
+		values->name = payload_get(payload + PAYLOAD_OFFSET(name), sign, bytes); \
+	}
+	PAYLOAD_FIELDS(X)
+#undef X
+	values->txpower &= 0x0F;
+
+	return (len < PAYLOAD_FIELDS_LEN) ? len : PAYLOAD_FIELDS_LEN;
+}
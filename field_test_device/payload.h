@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Encoder and decoder of the fixed fields of the uplink payload.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef PAYLOAD_H
+#define PAYLOAD_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "payload_fields.h"
+
+/**
+ * Values of the fixed fields (see payload_fields.h), before the scaling of the fields.
+ */
+typedef struct {
+#define X(name, key, sign, bytes, divisor) int32_t name;
+	PAYLOAD_FIELDS(X)
+#undef X
+} payload_values_t;
+
+/**
+ * Layout of the fixed fields (only used for their offsets).
+ */
+typedef struct {
+#define X(name, key, sign, bytes, divisor) uint8_t name[bytes];
+	PAYLOAD_FIELDS(X)
+#undef X
+} payload_layout_t;
+
+/**
+ * Offset of a field in the payload (a constant).
+ */
+#define PAYLOAD_OFFSET(name)	offsetof(payload_layout_t, name)
+
+/**
+ * Offset of the end of a field in the payload (a constant).
+ */
+#define PAYLOAD_END(name)	(offsetof(payload_layout_t, name) + sizeof(((payload_layout_t *)0)->name))
+
+/**
+ * Length of the fixed fields (the variable fields follow them).
+ */
+#define PAYLOAD_FIELDS_LEN	sizeof(payload_layout_t)
+
+/**
+ * Format of the payload, in the 4 high bits of the first byte (the txpower idx is lower than 16):
+ * the fixed fields, the bit-packed payload, or the fixed fields of the former
+ * layout (PAYLOAD_FIELDS_V0, sent by the previous firmwares and only decoded by the codecs).
+ */
+#define PAYLOAD_FORMAT_FIELDS_V0	0
+#define PAYLOAD_FORMAT_PACKED	1
+#define PAYLOAD_FORMAT_FIELDS	2
+
+/**
+ * Length of the bit-packed payload:
+ *   4 bits : format (PAYLOAD_FORMAT_PACKED)
+ *   4 bits : txpower idx
+ *   4 bits : datarate
+ *  12 bits : temperature in 0.1 °C (signed)
+ *  12 bits : latitude from the anchor, in 2^PAYLOAD_PACKED_SHIFT units of the 24-bit encoding (signed, -2048 without fix)
+ *  12 bits : longitude from the anchor, in 2^PAYLOAD_PACKED_SHIFT units of the 24-bit encoding (signed, -2048 without fix)
+ *  16 bits : altitude in 2 m (0 below the sea level)
+ */
+#define PAYLOAD_PACKED_LEN	8
+
+#ifndef PAYLOAD_PACKED
+// Encode the payloads shorter than the fixed fields in the bit-packed format.
+#define PAYLOAD_PACKED	0
+#endif
+
+/**
+ * Whether payload_encode() bit-packs a payload of this length.
+ */
+#define PAYLOAD_IS_PACKED(len)	(PAYLOAD_PACKED == 1 && (len) < PAYLOAD_FIELDS_LEN && (len) >= PAYLOAD_PACKED_LEN)
+
+#ifndef PAYLOAD_PACKED_SHIFT
+// Resolution of the bit-packed positions (7 is about 150 m, for +/-2047 * 150 m around the anchor).
+#define PAYLOAD_PACKED_SHIFT	7
+#endif
+
+#ifndef PAYLOAD_PACKED_ANCHOR_LAT
+// Anchor of the bit-packed positions in degrees (the launch site).
+#define PAYLOAD_PACKED_ANCHOR_LAT	45.1934
+#endif
+
+#ifndef PAYLOAD_PACKED_ANCHOR_LON
+#define PAYLOAD_PACKED_ANCHOR_LON	5.7674
+#endif
+
+/**
+ * Encode the fixed fields, or the bit-packed payload when PAYLOAD_PACKED is
+ * set and the payload is shorter than the fixed fields but not than the
+ * bit-packed payload.
+ *
+ * @param payload the payload
+ * @param len the length of the payload (the fields are truncated to it)
+ * @param values the values of the fields
+ *
+ * @return the number of bytes written
+ */
+extern unsigned int payload_encode(uint8_t *payload, unsigned int len, const payload_values_t *values);
+
+/**
+ * Decode the fixed fields.
+ *
+ * @param payload the payload
+ * @param len the length of the payload
+ * @param values the values of the fields (0 for the fields beyond len)
+ *
+ * @return the number of bytes read, 0 if the payload is not in the PAYLOAD_FORMAT_FIELDS format
+ */
+extern unsigned int payload_decode(const uint8_t *payload, unsigned int len, payload_values_t *values);
+
+/**
+ * Encode the bit-packed payload (PAYLOAD_PACKED_LEN bytes).
+ *
+ * @param payload the payload
+ * @param len the length of the payload (at least PAYLOAD_PACKED_LEN)
+ * @param values the values of the fields
+ *
+ * @return the number of bytes written, 0 if the payload is too short (the
+ *         decoders reject a truncated bit-packed payload)
+ */
+extern unsigned int payload_encode_packed(uint8_t *payload, unsigned int len, const payload_values_t *values);
+
+/**
+ * Decode the bit-packed payload (the values are rounded to its resolution).
+ *
+ * @param payload the payload
+ * @param len the length of the payload
+ * @param values the values of the fields (the fields which are not in the bit-packed payload are 0)
+ *
+ * @return the number of bytes read, 0 if the payload is not bit-packed
+ */
+extern unsigned int payload_decode_packed(const uint8_t *payload, unsigned int len, payload_values_t *values);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PAYLOAD_H */
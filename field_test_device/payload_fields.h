@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Layout of the fixed fields of the uplink payload.
+ *
+ * This is the only description of the fields: the encoder (payload.c), the
+ * C decoder and the tables of the codecs (codec/, regenerated by `make codec`)
+ * are expanded from it. Only macros here, since the file is also run through
+ * the C preprocessor for the codecs.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef PAYLOAD_FIELDS_H
+#define PAYLOAD_FIELDS_H
+
+/*
+ * X(name, key, signed, bytes, divisor)
+ *  name    : member of payload_values_t
+ *  key     : name of the value decoded by the codecs
+ *  signed  : 1 for a two's complement field
+ *  bytes   : width of the field (big endian)
+ *  divisor : the decoded value is the field divided by it
+ */
+
+/*
+ * Summary of the samplings since the previous transmission (with a sampling
+ * period between the transmissions, see sensors.h).
+ */
+#if SENSORS_PERIOD_MS > 0
+#define PAYLOAD_FIELDS_TEMPERATURE_WINDOW(X) \
+	X(temperature_min,      "temperatureMin",      1, 2, 100) /* in 0.01 °C */ \
+	X(temperature_max,      "temperatureMax",      1, 2, 100) \
+	X(temperature_mean,     "temperatureMean",     1, 2, 100)
+#define PAYLOAD_FIELDS_PRESSURE_WINDOW(X) \
+	X(pressure_min,         "pressureMin",         0, 2, 50)  /* in 2 Pa, decoded in hPa */ \
+	X(pressure_max,         "pressureMax",         0, 2, 50) \
+	X(pressure_mean,        "pressureMean",        0, 2, 50)
+#define PAYLOAD_FIELDS_WINDOW_COUNT(X) \
+	X(samples,              "samples",             0, 1, 1)   /* samplings of the summary (255 for more) */
+#else
+#define PAYLOAD_FIELDS_TEMPERATURE_WINDOW(X)
+#define PAYLOAD_FIELDS_PRESSURE_WINDOW(X)
+#define PAYLOAD_FIELDS_WINDOW_COUNT(X)
+#endif
+
+#ifndef PAYLOAD_PARITY
+// Number of previous positions covered by the parity fields (0 without parity).
+#define PAYLOAD_PARITY	0
+#endif
+
+/*
+ * Sequence index of the frame and XOR of the position fields of the
+ * PAYLOAD_PARITY previous frames, so that the decoder rebuilds the positions
+ * of the lost frames (see payload_parity.h).
+ */
+#if PAYLOAD_PARITY > 0
+#define PAYLOAD_FIELDS_PARITY(X) \
+	X(parity_sequence,      "paritySequence",      0, 1, 1)   /* PAYLOAD_PARITY..255 after the first 256 frames */ \
+	X(parity_latitude,      "parityLatitude",      0, 3, 1) \
+	X(parity_longitude,     "parityLongitude",     0, 3, 1) \
+	X(parity_altitude,      "parityAltitude",      0, 2, 1)
+#else
+#define PAYLOAD_FIELDS_PARITY(X)
+#endif
+
+#ifndef PAYLOAD_DOWNLINK
+// 1 for the measurements of the last downlink in each frame.
+#define PAYLOAD_DOWNLINK	1
+#endif
+
+/*
+ * Measurements of the last downlink (see downlink.h), for the link in both
+ * directions.
+ */
+#if PAYLOAD_DOWNLINK == 1
+#define PAYLOAD_FIELDS_DOWNLINK(X) \
+	X(downlink_count,       "downlinkCount",       0, 1, 1)   /* downlinks since boot, modulo 256 */ \
+	X(downlink_fcnt,        "downlinkFcnt",        0, 2, 1)   /* FCntDown, modulo 65536 */ \
+	X(downlink_rssi,        "downlinkRssi",        0, 1, -1)  /* -dBm up to 255, negated by the decoders */ \
+	X(downlink_snr,         "downlinkSnr",         1, 1, 1)   /* in dB */
+#else
+#define PAYLOAD_FIELDS_DOWNLINK(X)
+#endif
+
+/* Fields of the MPL3115A2 barometer. */
+#if MODULE_MPL3115A2 == 1
+#define PAYLOAD_FIELDS_MPL3115A2(X) \
+	X(pressure,             "pressure",            0, 2, 50)  /* in 2 Pa, decoded in hPa */ \
+	PAYLOAD_FIELDS_PRESSURE_WINDOW(X) \
+	X(pressure_temperature, "pressureTemperature", 1, 2, 10)  /* in 0.1 °C */ \
+	X(pressure_status,      "pressureStatus",      0, 1, 1)
+#else
+#define PAYLOAD_FIELDS_MPL3115A2(X)
+#endif
+
+/*
+ * All the fixed fields, in the order of the payload: the LoRa settings, then
+ * by priority (position > temperature > pressure > diagnostics), since the
+ * payload is truncated to the maximum size of the datarate.
+ */
+#define PAYLOAD_FIELDS(X) \
+	X(txpower,     "txpower",     0, 1, 1)                /* txpower idx of the Regional Parameters */ \
+	X(datarate,    "dataRate",    0, 1, 1) \
+	X(latitude,    "latitude",    1, 3, (8388607 / 90.0))  /* 90° is 2^23 - 1 */ \
+	X(longitude,   "longitude",   1, 3, (8388607 / 180.0)) /* 180° is 2^23 - 1 */ \
+	X(altitude,    "altitude",    0, 2, 1)                /* in m */ \
+	PAYLOAD_FIELDS_PARITY(X) \
+	X(temperature, "temperature", 1, 2, 100)              /* in 0.01 °C */ \
+	PAYLOAD_FIELDS_TEMPERATURE_WINDOW(X) \
+	PAYLOAD_FIELDS_MPL3115A2(X) \
+	PAYLOAD_FIELDS_WINDOW_COUNT(X) \
+	X(ttff,        "ttff",        0, 2, 1)                /* in s, 0xFFFF before the first fix */ \
+	PAYLOAD_FIELDS_DOWNLINK(X)
+
+/*
+ * Fixed fields of the former format (PAYLOAD_FORMAT_FIELDS_V0, before the
+ * sorting by priority), only decoded by the codecs.
+ */
+#if MODULE_MPL3115A2 == 1
+#define PAYLOAD_FIELDS_V0_MPL3115A2(X) \
+	X(pressure,             "pressure",            0, 2, 50) \
+	X(pressure_temperature, "pressureTemperature", 1, 2, 10) \
+	X(pressure_status,      "pressureStatus",      0, 1, 1)
+#else
+#define PAYLOAD_FIELDS_V0_MPL3115A2(X)
+#endif
+
+#define PAYLOAD_FIELDS_V0(X) \
+	X(txpower,     "txpower",     0, 1, 1) \
+	X(datarate,    "dataRate",    0, 1, 1) \
+	X(temperature, "temperature", 1, 2, 100) \
+	PAYLOAD_FIELDS_V0_MPL3115A2(X) \
+	X(latitude,    "latitude",    1, 3, (8388607 / 90.0)) \
+	X(longitude,   "longitude",   1, 3, (8388607 / 180.0)) \
+	X(altitude,    "altitude",    0, 2, 1) \
+	X(ttff,        "ttff",        0, 2, 1)
+
+#endif /* PAYLOAD_FIELDS_H */
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Parity of the positions of the previous frames.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#include "payload_parity.h"
+
+#if PAYLOAD_PARITY > 0
+
+#if PAYLOAD_PARITY > 16
+#error "PAYLOAD_PARITY is at most 16"
+#endif
+
+#if (defined(VIRT_DEV) && VIRT_DEV > 1) || (defined(MIN_PORT) && defined(MAX_PORT) && MAX_PORT - MIN_PORT > 1)
+#error "PAYLOAD_PARITY needs a single virtual device and a single port (VIRT_DEV=1, MAX_PORT=MIN_PORT+1)"
+#endif
+
+// Position fields of a frame, as encoded (24, 24 and 16 bits).
+typedef struct {
+	uint32_t latitude;
+	uint32_t longitude;
+	uint32_t altitude;
+} payload_parity_fix_t;
+
+// Positions of the previous frames (0 before the boot, as without fix).
+static payload_parity_fix_t payload_parity_fixes[PAYLOAD_PARITY];
+
+// Oldest position, replaced by the one of the frame.
+static uint8_t payload_parity_oldest = 0;
+
+// Sequence index of the frame.
+static uint8_t payload_parity_sequence = 0;
+
+void payload_parity_encode(payload_values_t *values, unsigned int len)
+{
+	// The decoder does not see the frame in the chain.
+	if (len < PAYLOAD_END(parity_altitude) || PAYLOAD_IS_PACKED(len)) {
+		return;
+	}
+
+	payload_parity_fix_t parity = { 0, 0, 0 };
+	for (unsigned int k = 0; k < PAYLOAD_PARITY; k++) {
+		parity.latitude ^= payload_parity_fixes[k].latitude;
+		parity.longitude ^= payload_parity_fixes[k].longitude;
+		parity.altitude ^= payload_parity_fixes[k].altitude;
+	}
+
+	values->parity_sequence = payload_parity_sequence;
+	values->parity_latitude = parity.latitude;
+	values->parity_longitude = parity.longitude;
+	values->parity_altitude = parity.altitude;
+
+	payload_parity_fix_t *fix = &payload_parity_fixes[payload_parity_oldest];
+	fix->latitude = (uint32_t)values->latitude & 0xFFFFFF;
+	fix->longitude = (uint32_t)values->longitude & 0xFFFFFF;
+	fix->altitude = (uint32_t)values->altitude & 0xFFFF;
+	payload_parity_oldest = (payload_parity_oldest + 1) % PAYLOAD_PARITY;
+
+	payload_parity_sequence = (payload_parity_sequence == 0xFF) ? PAYLOAD_PARITY : payload_parity_sequence + 1;
+}
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Parity of the positions of the previous frames.
+ *
+ * Each frame carries the XOR of the position fields (latitude, longitude and
+ * altitude, as encoded) of the PAYLOAD_PARITY previous frames, and its
+ * sequence index. A lost position is rebuilt from a parity in which it is the
+ * only unknown position, so a burst of up to PAYLOAD_PARITY lost frames is
+ * rebuilt once PAYLOAD_PARITY consecutive frames are received.
+ *
+ * The sequence index counts the frames from 0 after the boot, and restarts at
+ * PAYLOAD_PARITY after 255: an index lower than PAYLOAD_PARITY tells the
+ * decoder that the frames before the index 0 have no position.
+ *
+ * The chain covers the frames with the parity fields, and the decoder keeps
+ * it for each device (and port): it needs a single virtual device (VIRT_DEV)
+ * and a single port (MAX_PORT = MIN_PORT + 1). The frames truncated before
+ * the end of the parity fields, or bit-packed, are left out of it.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef PAYLOAD_PARITY_H
+#define PAYLOAD_PARITY_H
+
+#include "payload.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if PAYLOAD_PARITY > 0
+
+/**
+ * Set the parity fields of a frame, and add its position to the parity of the
+ * next frames, unless the parity fields are not in the payload.
+ *
+ * @param values the values of the fields, with the position of the frame
+ * @param len the length of the payload (the fields are truncated to it)
+ */
+extern void payload_parity_encode(payload_values_t *values, unsigned int len);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PAYLOAD_PARITY_H */
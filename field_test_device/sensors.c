@@ -0,0 +1,390 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Sampling of the sensors ahead of the transmissions.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mutex.h"
+#include "thread.h"
+#include "xtimer.h"
+
+#if DS75LX == 1
+#include "ds75lx.h"
+#include "ds75lx_params.h"
+#endif
+
+#if AT30TES75X == 1
+#include "at30tse75x.h"
+#endif
+
+#if MODULE_MAG3110 == 1
+#include "mag3110.h"
+#include "mag3110_params.h"
+#endif
+
+#if MODULE_MMA8X5X == 1
+#include "mma8x5x.h"
+#include "mma8x5x_params.h"
+#endif
+
+#if MODULE_MPL3115A2 == 1
+#include "mpl3115a2.h"
+#include "mpl3115a2_params.h"
+#endif
+
+#include "sensors.h"
+
+// The sampling thread runs below the main (sender) and receiver threads.
+#ifndef SENSORS_THREAD_PRIORITY
+#define SENSORS_THREAD_PRIORITY	(THREAD_PRIORITY_MAIN + 1)
+#endif
+
+#ifndef SENSORS_THREAD_STACKSIZE
+#define SENSORS_THREAD_STACKSIZE	THREAD_STACKSIZE_DEFAULT
+#endif
+
+/* Declare the sensor device descriptors */
+#if MODULE_DS75LX == 1
+static ds75lx_t ds75lx;
+#endif
+
+#if MODULE_AT30TES75X == 1
+static at30tse75x_t at30tse75x;
+#endif
+
+#if MODULE_MAG3110 == 1
+static mag3110_t mag3110;
+#endif
+
+#if MODULE_MMA8X5X == 1
+static mma8x5x_t mma8x5x;
+#endif
+
+#if MODULE_MPL3115A2 == 1
+static mpl3115a2_t mpl3115a2;
+#endif
+
+// The snapshot is double-buffered (seqlock latch, as the GPS data): the
+// sampling thread only writes the slot readers do not use, then bumps the
+// sequence, so the encoder never waits for the sensors.
+static sensors_snapshot_t sensors_snapshots[2];
+static atomic_uint sensors_seq;
+
+// Unlocked to wake the sampling thread up.
+static mutex_t sensors_ready = MUTEX_INIT_LOCKED;
+
+// Wakes the sampling thread up before the next transmission.
+static xtimer_t sensors_timer;
+
+// Wakes the sampling thread up every SENSORS_PERIOD_MS.
+static xtimer_t sensors_period_timer;
+
+// Set when the sampling is the one before a transmission, which closes the window.
+static atomic_bool sensors_closing;
+
+// Streaming accumulator of a channel (constant memory whatever the window).
+typedef struct {
+	int32_t min;
+	int32_t max;
+	int32_t last;
+	int64_t sum;
+} sensors_accumulator_t;
+
+// Accumulators of the current window (only for the sampling thread).
+static sensors_accumulator_t sensors_accumulators[SENSORS_CHANNELS];
+static uint16_t sensors_count;
+
+static char sensors_thread_stack[SENSORS_THREAD_STACKSIZE];
+
+bool sensors_init(void) {
+
+	bool ok = true;
+	int result;
+
+	(void) result;
+
+#if MODULE_DS75LX == 1
+	DEBUG("[ds75lx] DS75LX sensor is enabled\n");
+
+	result = ds75lx_init(&ds75lx, &ds75lx_params[0]);
+	if (result != DS75LX_OK)
+	{
+		DEBUG("[error] Failed to initialize DS75LX sensor\n");
+		ok = false;
+	}
+	ds75lx_shutdown(&ds75lx);
+#endif
+
+#if MODULE_AT30TES75X == 1
+	DEBUG("[at30tse75x] AT30TES75X sensor is enabled\n");
+
+	result = at30tse75x_init(&at30tse75x, PORT_A, AT30TSE75X_TEMP_ADDR);
+	if (result != 0)
+	{
+		DEBUG("[error] Failed to initialize AT30TES75X sensor\n");
+		ok = false;
+	}
+#endif
+
+#if MODULE_MAG3110 == 1
+	puts("MAG3110 magnetometer driver test application\n");
+	printf("Initializing MAG3110 magnetometer at I2C_%i... ",
+		   mag3110_params[0].i2c);
+	if (mag3110_init(&mag3110, &mag3110_params[0]) != MAG3110_OK) {
+		DEBUG("[error] Failed to initialize MAG3110 sensor\n");
+		ok = false;
+	}
+#endif
+
+#if MODULE_MMA8X5X == 1
+	puts("MMA8652 accelerometer driver test application\n");
+	printf("Initializing MMA8652 accelerometer at I2C_DEV(%i)... ", mma8x5x_params->i2c);
+
+	result = mma8x5x_init(&mma8x5x, mma8x5x_params);
+	if(result != MMA8X5X_OK) {
+		DEBUG("[error] Failed to initialize MMA8X5X sensor\n");
+		ok = false;
+	}
+#endif
+
+#if MODULE_MPL3115A2 == 1
+	result = mpl3115a2_init(&mpl3115a2, &mpl3115a2_params[0]);
+	if(result != MPL3115A2_OK) {
+		DEBUG("[error] Failed to initialize MPL3115A2 sensor\n");
+		ok = false;
+	}
+#endif
+
+	return ok;
+}
+
+// Start the conversions of all the sensors.
+static void sensors_start_conversions(void) {
+
+#if MODULE_DS75LX == 1
+	ds75lx_wakeup(&ds75lx);
+#endif
+
+#if MODULE_MPL3115A2 == 1
+	if (mpl3115a2_set_active(&mpl3115a2) != MPL3115A2_OK) {
+		puts("[FAILED] activate measurement!");
+	}
+#endif
+}
+
+// Read the sensors once converted into the next snapshot, and stop them.
+static void sensors_read(sensors_snapshot_t *s, uint32_t start) {
+
+	(void) s;
+	(void) start;
+
+#if MODULE_DS75LX == 1
+	{
+	/* Get temperature in degrees celsius */
+	ds75lx_read_temperature(&ds75lx, &s->temperature);
+	ds75lx_shutdown(&ds75lx);
+	s->latency_us[SENSORS_DS75LX] = xtimer_now_usec() - start;
+	DEBUG("[ds75lx] get temperature : temperature=%d\n", s->temperature);
+	}
+#endif
+
+#if MODULE_AT30TES75X == 1
+	{
+	uint32_t begin = xtimer_now_usec();
+	/* Get temperature in degrees celsius */
+	float ftemp;
+	at30tse75x_get_temperature(&at30tse75x, &ftemp);
+	s->temperature = (int16_t)(ftemp * 100);
+	s->latency_us[SENSORS_AT30TSE75X] = xtimer_now_usec() - begin;
+	DEBUG("[at30tse75x] get temperature : temperature=%d\n", s->temperature);
+	}
+#endif
+
+#if MODULE_MAG3110 == 1
+	{
+	uint32_t begin = xtimer_now_usec();
+	mag3110_data_t data;
+	int8_t temp;
+	mag3110_read(&mag3110, &data);
+	mag3110_read_dtemp(&mag3110, &temp);
+	s->latency_us[SENSORS_MAG3110] = xtimer_now_usec() - begin;
+	printf("Field strength: X: %d Y: %d Z: %d\n", data.x, data.y, data.z);
+	printf("Die Temperature T: %d\n", temp);
+	// TODO add to payload
+	}
+#endif
+
+#if MODULE_MMA8X5X == 1
+	{
+	uint32_t begin = xtimer_now_usec();
+	mma8x5x_data_t data;
+	mma8x5x_read(&mma8x5x, &data);
+	s->latency_us[SENSORS_MMA8X5X] = xtimer_now_usec() - begin;
+	printf("Acceleration [in mg]: X: %d Y: %d Z: %d\n", data.x, data.y, data.z);
+	// TODO add to payload
+	}
+#endif
+
+#if MODULE_MPL3115A2 == 1
+	{
+	uint32_t pressure = 0;
+	int16_t temperature = 0;
+	uint8_t status = 0;
+	if ((mpl3115a2_read_pressure(&mpl3115a2, &pressure, &status) |
+		 mpl3115a2_read_temp(&mpl3115a2, &temperature)) != MPL3115A2_OK) {
+		puts("[FAILED] read MPL3115A2 values!");
+	} else {
+		printf("Pressure: %u Pa, Temperature: %3d.%d C, State: %#02x\n",
+			   (unsigned int)pressure, temperature/10, abs(temperature%10), status);
+	}
+	mpl3115a2_set_standby(&mpl3115a2);
+	s->pressure = pressure;
+	s->pressure_temperature = temperature;
+	s->pressure_status = status;
+	s->latency_us[SENSORS_MPL3115A2] = xtimer_now_usec() - start;
+	}
+#endif
+}
+
+// Add a sample to the accumulator of a channel.
+static void sensors_accumulate(sensors_accumulator_t *a, int32_t value, uint16_t count) {
+
+	if (count == 0 || value < a->min) {
+		a->min = value;
+	}
+	if (count == 0 || value > a->max) {
+		a->max = value;
+	}
+	a->sum = (count == 0) ? value : a->sum + value;
+	a->last = value;
+}
+
+// Summarize the accumulator of a channel (the mean is rounded).
+static void sensors_summarize(const sensors_accumulator_t *a, uint16_t count, sensors_window_t *w) {
+
+	w->min = a->min;
+	w->max = a->max;
+	w->last = a->last;
+	w->mean = (a->sum >= 0) ? (a->sum + count / 2) / count : -((-a->sum + count / 2) / count);
+}
+
+// Sample the sensors when woken up, and publish the values.
+static void *sensors_thread(void *arg) {
+
+	(void) arg;
+
+	while (1) {
+		mutex_lock(&sensors_ready);
+
+#if SENSORS_PERIOD_MS > 0
+		xtimer_set64(&sensors_period_timer, (uint64_t)SENSORS_PERIOD_MS * US_PER_MS);
+#endif
+
+		unsigned int seq = atomic_load_explicit(&sensors_seq, memory_order_relaxed);
+		const sensors_snapshot_t *cur = &sensors_snapshots[seq & 1];
+		sensors_snapshot_t *next = &sensors_snapshots[(seq + 1) & 1];
+		memset(next, 0, sizeof(*next));
+
+		// The conversions overlap, so the sampling lasts as long as the longest one.
+		uint32_t start = xtimer_now_usec();
+		sensors_start_conversions();
+		xtimer_usleep(SENSORS_CONVERSION_MS * US_PER_MS);
+		sensors_read(next, start);
+		next->timestamp = xtimer_now_usec64() / US_PER_MS;
+
+		if (sensors_count < UINT16_MAX) {
+			sensors_accumulate(&sensors_accumulators[SENSORS_TEMPERATURE], next->temperature, sensors_count);
+			sensors_accumulate(&sensors_accumulators[SENSORS_PRESSURE], next->pressure, sensors_count);
+			sensors_accumulate(&sensors_accumulators[SENSORS_PRESSURE_TEMPERATURE], next->pressure_temperature, sensors_count);
+			sensors_count++;
+		}
+
+		// The sampling before a transmission closes the window, the others keep the last one.
+		if (atomic_exchange(&sensors_closing, false)) {
+			for (unsigned int c = 0; c < SENSORS_CHANNELS; c++) {
+				sensors_summarize(&sensors_accumulators[c], sensors_count, &next->window[c]);
+			}
+			next->window_count = sensors_count;
+			sensors_count = 0;
+		} else {
+			memcpy(next->window, cur->window, sizeof(next->window));
+			next->window_count = cur->window_count;
+		}
+
+		atomic_store_explicit(&sensors_seq, seq + 1, memory_order_release);
+
+		DEBUG("[sensors] sampled in %lu us: ds75lx=%lu at30tse75x=%lu mag3110=%lu mma8x5x=%lu mpl3115a2=%lu us\n",
+			xtimer_now_usec() - start,
+			next->latency_us[SENSORS_DS75LX], next->latency_us[SENSORS_AT30TSE75X],
+			next->latency_us[SENSORS_MAG3110], next->latency_us[SENSORS_MMA8X5X],
+			next->latency_us[SENSORS_MPL3115A2]);
+	}
+
+	return NULL;
+}
+
+// Wake the sampling thread up (from the timer ISR), for closing the window if arg is set.
+static void sensors_wakeup(void *arg) {
+
+	if (arg != NULL) {
+		atomic_store(&sensors_closing, true);
+	}
+	mutex_unlock(&sensors_ready);
+}
+
+void sensors_start(void) {
+
+	sensors_timer.callback = sensors_wakeup;
+	sensors_timer.arg = &sensors_timer;
+	sensors_period_timer.callback = sensors_wakeup;
+	sensors_period_timer.arg = NULL;
+
+	// The first sampling is published as a window of its own.
+	atomic_store(&sensors_closing, true);
+
+	thread_create(sensors_thread_stack, sizeof(sensors_thread_stack),
+				  SENSORS_THREAD_PRIORITY, 0, sensors_thread, NULL, "sensors");
+
+	mutex_unlock(&sensors_ready);
+}
+
+void sensors_schedule(uint32_t ms) {
+
+	uint32_t delay = (ms > SENSORS_LEAD_MS) ? ms - SENSORS_LEAD_MS : 0;
+
+	xtimer_set64(&sensors_timer, (uint64_t)delay * US_PER_MS);
+}
+
+void sensors_get(sensors_snapshot_t *snapshot) {
+
+	unsigned int seq;
+
+	// Retry only if the sampling thread has published during the copy.
+	do {
+		seq = atomic_load_explicit(&sensors_seq, memory_order_acquire);
+		*snapshot = sensors_snapshots[seq & 1];
+		atomic_thread_fence(memory_order_acquire);
+	} while (atomic_load_explicit(&sensors_seq, memory_order_relaxed) != seq);
+}
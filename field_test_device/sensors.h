@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Sampling of the sensors ahead of the transmissions.
+ *
+ * A thread starts the conversions of all the sensors together, reads them
+ * once the longest one is over, and publishes the values into a snapshot
+ * that the encoder reads without waiting for the sensors.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef SENSORS_H
+#define SENSORS_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Sensors (index of the latencies).
+ */
+enum {
+	SENSORS_DS75LX,
+	SENSORS_AT30TSE75X,
+	SENSORS_MAG3110,
+	SENSORS_MMA8X5X,
+	SENSORS_MPL3115A2,
+	SENSORS_NUMOF
+};
+
+#ifndef SENSORS_CONVERSION_MS
+// Longest conversion time of the sensors.
+#if MODULE_MPL3115A2 == 1
+#define SENSORS_CONVERSION_MS	512	// oversampling ratio of 128
+#elif MODULE_DS75LX == 1
+#define SENSORS_CONVERSION_MS	200	// 12-bit resolution
+#else
+#define SENSORS_CONVERSION_MS	0
+#endif
+#endif
+
+#ifndef SENSORS_PERIOD_MS
+// Sampling period between the transmissions, aggregated into the window of
+// each transmission (0 for a sampling only before the transmissions).
+#define SENSORS_PERIOD_MS	0
+#endif
+
+#ifndef SENSORS_LEAD_MS
+// Time between the start of the sampling and the transmission.
+#define SENSORS_LEAD_MS	(SENSORS_CONVERSION_MS + 100)
+#endif
+
+/**
+ * Aggregated channels (in the units of the snapshot).
+ */
+enum {
+	SENSORS_TEMPERATURE,
+	SENSORS_PRESSURE,
+	SENSORS_PRESSURE_TEMPERATURE,
+	SENSORS_CHANNELS
+};
+
+/**
+ * Summary of a channel over a window.
+ */
+typedef struct {
+	int32_t min;
+	int32_t max;
+	int32_t mean;					// rounded
+	int32_t last;
+} sensors_window_t;
+
+/**
+ * Values of the last sampling.
+ */
+typedef struct {
+	int16_t temperature;			// in 0.01 °C
+	uint32_t pressure;				// in Pa
+	int16_t pressure_temperature;	// in 0.1 °C
+	uint8_t pressure_status;
+	uint32_t timestamp;				// end of the sampling in ms since boot (0 before the first one)
+	uint32_t latency_us[SENSORS_NUMOF];	// from the start of the conversion to the end of the read (0 without the sensor)
+	sensors_window_t window[SENSORS_CHANNELS];	// samplings since the window of the previous transmission
+	uint16_t window_count;			// number of samplings of the window
+} sensors_snapshot_t;
+
+/**
+ * Initialize the sensors.
+ *
+ * @return false if a sensor failed
+ */
+extern bool sensors_init(void);
+
+/**
+ * Start the sampling thread, and a first sampling.
+ */
+extern void sensors_start(void);
+
+/**
+ * Schedule the next sampling SENSORS_LEAD_MS before a transmission.
+ *
+ * @param ms the time until the transmission
+ */
+extern void sensors_schedule(uint32_t ms);
+
+/**
+ * Get the values of the last sampling (never waits for the sensors).
+ *
+ * @param snapshot the values
+ */
+extern void sensors_get(sensors_snapshot_t *snapshot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSORS_H */
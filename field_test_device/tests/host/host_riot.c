@@ -0,0 +1,271 @@
+/*
+
+Host stubs of RIOT (xtimer, irq, threads, isrpipe, UART and panic) for
+building the GPS code on Linux.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+#include "host_riot.h"
+
+#include <irq.h>
+#include <isrpipe.h>
+#include <isrpipe/read_timeout.h>
+#include <panic.h>
+#include <periph/uart.h>
+#include <thread.h>
+#include <xtimer.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+// Most threads created by thread_create.
+#define HOST_THREADS  8
+
+
+// Monotonic time in us.
+static uint64_t host_clock_usec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * US_PER_SEC + ts.tv_nsec / NS_PER_US;
+}
+
+
+// Simulated time (0 for the monotonic clock of the host).
+static uint64_t host_simulated_usec;
+
+
+// Time since the start of the program, from 1 s.
+uint64_t xtimer_now_usec64(void)
+{
+    static uint64_t start = 0;
+
+    if (host_simulated_usec != 0)
+        return host_simulated_usec;
+    if (start == 0)
+        start = host_clock_usec() - US_PER_SEC;
+    return host_clock_usec() - start;
+}
+
+
+void xtimer_usleep64(uint64_t usec)
+{
+    if (host_simulated_usec != 0) {
+        host_simulated_usec += usec;
+        return;
+    }
+    struct timespec ts = { usec / US_PER_SEC, (usec % US_PER_SEC) * NS_PER_US };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+        ;
+}
+
+
+void host_clock_simulate(uint64_t usec)
+{
+    host_simulated_usec = usec;
+}
+
+
+// Interrupts: a global lock held by the simulated ISRs and by the sections
+// with the interrupts disabled.
+static pthread_mutex_t irq_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread unsigned int irq_depth;
+static __thread bool irq_in;
+
+unsigned int irq_disable(void)
+{
+    if (irq_depth == 0)
+        pthread_mutex_lock(&irq_lock);
+    return irq_depth++;
+}
+
+void irq_restore(unsigned int state)
+{
+    irq_depth = state;
+    if (irq_depth == 0)
+        pthread_mutex_unlock(&irq_lock);
+}
+
+bool irq_is_enabled(void)
+{
+    return irq_depth == 0;
+}
+
+bool irq_is_in(void)
+{
+    return irq_in;
+}
+
+
+// Threads.
+static struct {
+    const char *name;
+    pthread_t thread;
+} host_threads[HOST_THREADS];
+static unsigned int host_threads_count;
+
+kernel_pid_t thread_create(char *stack, int stacksize, uint8_t priority,
+                           int flags, thread_task_func_t task_func,
+                           void *arg, const char *name)
+{
+    (void)stack;  (void)stacksize;  (void)priority;  (void)flags;
+
+    if (host_threads_count == HOST_THREADS)
+        core_panic(PANIC_GENERAL_ERROR, "too many threads");
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, task_func, arg) != 0)
+        core_panic(PANIC_GENERAL_ERROR, "pthread_create");
+    pthread_detach(thread);
+
+    host_threads[host_threads_count].name = name;
+    host_threads[host_threads_count].thread = thread;
+    return ++host_threads_count;
+}
+
+uint64_t host_thread_cpu_ns(const char *name)
+{
+    for (unsigned int i = 0; i < host_threads_count; i++) {
+        clockid_t clock;
+        struct timespec ts;
+        if (strcmp(host_threads[i].name, name) != 0 ||
+            pthread_getcpuclockid(host_threads[i].thread, &clock) != 0 ||
+            clock_gettime(clock, &ts) != 0)
+            continue;
+        return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+    return 0;
+}
+
+
+// isrpipe.
+void isrpipe_init(isrpipe_t *isrpipe, uint8_t *buf, size_t bufsize)
+{
+    tsrb_init(&isrpipe->tsrb, buf, bufsize);
+    pthread_mutex_init(&isrpipe->lock, NULL);
+    pthread_cond_init(&isrpipe->cond, NULL);
+    isrpipe->waiting = false;
+}
+
+int isrpipe_write_one(isrpipe_t *isrpipe, uint8_t c)
+{
+    pthread_mutex_lock(&isrpipe->lock);
+    int res = tsrb_add_one(&isrpipe->tsrb, c);
+    pthread_cond_broadcast(&isrpipe->cond);
+    pthread_mutex_unlock(&isrpipe->lock);
+    return res;
+}
+
+int isrpipe_read(isrpipe_t *isrpipe, uint8_t *buf, size_t count)
+{
+    pthread_mutex_lock(&isrpipe->lock);
+    while (tsrb_empty(&isrpipe->tsrb)) {
+        isrpipe->waiting = true;
+        pthread_cond_broadcast(&isrpipe->cond);
+        pthread_cond_wait(&isrpipe->cond, &isrpipe->lock);
+    }
+    isrpipe->waiting = false;
+    int res = tsrb_get(&isrpipe->tsrb, buf, count);
+    pthread_mutex_unlock(&isrpipe->lock);
+    return res;
+}
+
+int isrpipe_read_timeout(isrpipe_t *isrpipe, uint8_t *buf, size_t count, uint32_t timeout)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    uint64_t ns = deadline.tv_nsec + (uint64_t)timeout * NS_PER_US;
+    deadline.tv_sec += ns / 1000000000ULL;
+    deadline.tv_nsec = ns % 1000000000ULL;
+
+    pthread_mutex_lock(&isrpipe->lock);
+    while (tsrb_empty(&isrpipe->tsrb)) {
+        if (pthread_cond_timedwait(&isrpipe->cond, &isrpipe->lock, &deadline) == ETIMEDOUT) {
+            pthread_mutex_unlock(&isrpipe->lock);
+            return -ETIMEDOUT;
+        }
+    }
+    int res = tsrb_get(&isrpipe->tsrb, buf, count);
+    pthread_mutex_unlock(&isrpipe->lock);
+    return res;
+}
+
+void isrpipe_host_wait_idle(isrpipe_t *isrpipe)
+{
+    pthread_mutex_lock(&isrpipe->lock);
+    while (!isrpipe->waiting || !tsrb_empty(&isrpipe->tsrb))
+        pthread_cond_wait(&isrpipe->cond, &isrpipe->lock);
+    pthread_mutex_unlock(&isrpipe->lock);
+}
+
+bool isrpipe_host_is_idle(isrpipe_t *isrpipe)
+{
+    pthread_mutex_lock(&isrpipe->lock);
+    bool idle = isrpipe->waiting && tsrb_empty(&isrpipe->tsrb);
+    pthread_mutex_unlock(&isrpipe->lock);
+    return idle;
+}
+
+
+// UART.
+static uint32_t uart_baudrate;
+static uart_rx_cb_t uart_rx_cb;
+static void *uart_rx_arg;
+static void (*uart_tx_hook)(const uint8_t *data, size_t len);
+
+int uart_init(uart_t uart, uint32_t baudrate, uart_rx_cb_t rx_cb, void *arg)
+{
+    (void)uart;
+    unsigned int state = irq_disable();
+    uart_baudrate = baudrate;
+    uart_rx_cb = rx_cb;
+    uart_rx_arg = arg;
+    irq_restore(state);
+    return 0;
+}
+
+void uart_write(uart_t uart, const uint8_t *data, size_t len)
+{
+    (void)uart;
+    if (uart_tx_hook)
+        uart_tx_hook(data, len);
+}
+
+void host_uart_receive(uint8_t c)
+{
+    unsigned int state = irq_disable();
+    irq_in = true;
+    if (uart_rx_cb)
+        uart_rx_cb(uart_rx_arg, c);
+    irq_in = false;
+    irq_restore(state);
+}
+
+uint32_t host_uart_baudrate(void)
+{
+    unsigned int state = irq_disable();
+    uint32_t baudrate = uart_baudrate;
+    irq_restore(state);
+    return baudrate;
+}
+
+void host_uart_set_tx_hook(void (*hook)(const uint8_t *data, size_t len))
+{
+    uart_tx_hook = hook;
+}
+
+
+// Panic.
+void core_panic(int crash_code, const char *message)
+{
+    fprintf(stderr, "panic %d: %s\n", crash_code, message);
+    abort();
+}
@@ -0,0 +1,51 @@
+/*
+
+Hooks of the host stubs of RIOT, for the tests.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * @brief Simulate the clock of xtimer from a given time: it advances only in
+ *        xtimer_usleep (single thread tests).
+ * @param usec Time since boot, from 1 s (0 for the clock of the host).
+ */
+void host_clock_simulate(uint64_t usec);
+
+
+/**
+ * @brief Receive a byte on the UART, as its ISR would (with the interrupts
+ *        disabled).
+ * @param c Byte received.
+ */
+void host_uart_receive(uint8_t c);
+
+
+/**
+ * @brief Get the baudrate of the UART (0 before uart_init).
+ */
+uint32_t host_uart_baudrate(void);
+
+
+/**
+ * @brief Set the function called with the bytes written on the UART.
+ * @param hook Function called from the writing thread (NULL to drop them).
+ */
+void host_uart_set_tx_hook(void (*hook)(const uint8_t *data, size_t len));
+
+
+/**
+ * @brief Get the CPU time consumed by a thread created by thread_create.
+ * @param name Name of the thread.
+ * @return The CPU time in ns, 0 if there is no such thread.
+ */
+uint64_t host_thread_cpu_ns(const char *name);
@@ -0,0 +1,50 @@
+/*
+
+Checks of the host tests.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+// Number of failed checks.
+static unsigned int host_test_failures;
+
+// Number of checks.
+static unsigned int host_test_checks;
+
+// Check a condition, and report it if false.
+#define CHECK(cond) do { \
+        host_test_checks++; \
+        if (!(cond)) { \
+            host_test_failures++; \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        } \
+    } while (0)
+
+
+// Print the result of the test, and return its exit code.
+static inline int host_test_report(const char *name)
+{
+    printf("[%s] %u checks, %u failed\n", name, host_test_checks, host_test_failures);
+    return host_test_failures ? 1 : 0;
+}
+
+
+// Build a NMEA sentence from its body (without the '$' and the checksum).
+static inline int host_nmea_sentence(char *sentence, size_t size, const char *body)
+{
+    uint8_t checksum = 0;
+
+    for (const char *c = body; *c; c++)
+        checksum ^= *c;
+    return snprintf(sentence, size, "$%s*%02X\r\n", body, checksum);
+}
@@ -0,0 +1,19 @@
+/*
+
+Host stub of the RIOT debug macros.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+
+#pragma once
+
+#include <stdio.h>
+
+#ifndef ENABLE_DEBUG
+#define ENABLE_DEBUG (0)
+#endif
+
+#define DEBUG(...) do { if (ENABLE_DEBUG) printf(__VA_ARGS__); } while (0)
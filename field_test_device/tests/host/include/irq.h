@@ -0,0 +1,19 @@
+/*
+
+Host stub of the RIOT interrupts: the simulated ISRs and the sections with
+the interrupts disabled are serialized by a global lock.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+
+#pragma once
+
+#include <stdbool.h>
+
+unsigned int irq_disable(void);
+void irq_restore(unsigned int state);
+bool irq_is_enabled(void);
+bool irq_is_in(void);
@@ -0,0 +1,41 @@
+/*
+
+Host stub of the RIOT isrpipe: a ring buffer written by the simulated ISRs
+and read by a blocking thread.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tsrb.h"
+
+typedef struct {
+    tsrb_t tsrb;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool waiting;           // The reader waits in isrpipe_read (host only).
+} isrpipe_t;
+
+void isrpipe_init(isrpipe_t *isrpipe, uint8_t *buf, size_t bufsize);
+int isrpipe_write_one(isrpipe_t *isrpipe, uint8_t c);
+int isrpipe_read(isrpipe_t *isrpipe, uint8_t *buf, size_t count);
+
+/**
+ * @brief Wait until the reader has read all the bytes and waits in
+ *        isrpipe_read for more (host only).
+ */
+void isrpipe_host_wait_idle(isrpipe_t *isrpipe);
+
+/**
+ * @brief Check whether the reader waits in isrpipe_read (host only).
+ */
+bool isrpipe_host_is_idle(isrpipe_t *isrpipe);
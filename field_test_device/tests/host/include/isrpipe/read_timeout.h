@@ -0,0 +1,15 @@
+/*
+
+Host stub of the RIOT isrpipe reads with a timeout.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+
+#pragma once
+
+#include "isrpipe.h"
+
+int isrpipe_read_timeout(isrpipe_t *isrpipe, uint8_t *buf, size_t count, uint32_t timeout);
@@ -0,0 +1,41 @@
+/*
+
+Host stub of the RIOT mutex. Like in RIOT, a mutex may be unlocked by
+another thread than its owner (e.g. to wake a thread up).
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool locked;
+} mutex_t;
+
+#define MUTEX_INIT         { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, false }
+#define MUTEX_INIT_LOCKED  { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, true }
+
+static inline void mutex_lock(mutex_t *m)
+{
+    pthread_mutex_lock(&m->lock);
+    while (m->locked)
+        pthread_cond_wait(&m->cond, &m->lock);
+    m->locked = true;
+    pthread_mutex_unlock(&m->lock);
+}
+
+static inline void mutex_unlock(mutex_t *m)
+{
+    pthread_mutex_lock(&m->lock);
+    m->locked = false;
+    pthread_cond_signal(&m->cond);
+    pthread_mutex_unlock(&m->lock);
+}
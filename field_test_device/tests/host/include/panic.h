@@ -0,0 +1,15 @@
+/*
+
+Host stub of the RIOT panic.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+
+#pragma once
+
+#define PANIC_GENERAL_ERROR  0
+
+void core_panic(int crash_code, const char *message);
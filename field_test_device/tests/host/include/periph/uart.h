@@ -0,0 +1,23 @@
+/*
+
+Host stub of the RIOT UART: the bytes written are given to a hook (the
+simulated GNSS module), which sends its bytes with host_uart_receive.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uart_t;
+typedef void (*uart_rx_cb_t)(void *arg, uint8_t data);
+
+#define UART_DEV(x)  ((uart_t)(x))
+
+int uart_init(uart_t uart, uint32_t baudrate, uart_rx_cb_t rx_cb, void *arg);
+void uart_write(uart_t uart, const uint8_t *data, size_t len);
@@ -0,0 +1,25 @@
+/*
+
+Host stub of the RIOT threads (POSIX threads, without priorities).
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+
+typedef int kernel_pid_t;
+typedef void *(*thread_task_func_t)(void *arg);
+
+#define THREAD_PRIORITY_MAIN        7
+#define THREAD_PRIORITY_IDLE        15
+#define THREAD_STACKSIZE_DEFAULT    1024
+#define THREAD_STACKSIZE_SMALL      512
+
+kernel_pid_t thread_create(char *stack, int stacksize, uint8_t priority,
+                           int flags, thread_task_func_t task_func,
+                           void *arg, const char *name);
@@ -0,0 +1,70 @@
+/*
+
+Host copy of the RIOT thread-safe ring buffer (single reader, single writer).
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint8_t *buf;
+    unsigned int size;      // Power of 2.
+    unsigned int reads;
+    unsigned int writes;
+} tsrb_t;
+
+#define TSRB_INIT(BUF)  { (BUF), sizeof(BUF), 0, 0 }
+
+static inline void tsrb_init(tsrb_t *rb, uint8_t *buffer, unsigned int bufsize)
+{
+    rb->buf = buffer;
+    rb->size = bufsize;
+    rb->reads = 0;
+    rb->writes = 0;
+}
+
+static inline unsigned int tsrb_avail(const tsrb_t *rb)
+{
+    return rb->writes - rb->reads;
+}
+
+static inline int tsrb_empty(const tsrb_t *rb)
+{
+    return rb->reads == rb->writes;
+}
+
+static inline int tsrb_full(const tsrb_t *rb)
+{
+    return rb->writes - rb->reads == rb->size;
+}
+
+static inline int tsrb_add_one(tsrb_t *rb, uint8_t c)
+{
+    if (tsrb_full(rb))
+        return -1;
+    rb->buf[rb->writes++ & (rb->size - 1)] = c;
+    return 0;
+}
+
+static inline int tsrb_add(tsrb_t *rb, const uint8_t *src, size_t n)
+{
+    size_t i = 0;
+    while (i < n && tsrb_add_one(rb, src[i]) == 0)
+        i++;
+    return i;
+}
+
+static inline int tsrb_get(tsrb_t *rb, uint8_t *dst, size_t n)
+{
+    size_t i = 0;
+    while (i < n && !tsrb_empty(rb))
+        dst[i++] = rb->buf[rb->reads++ & (rb->size - 1)];
+    return i;
+}
@@ -0,0 +1,32 @@
+/*
+
+Host stub of the RIOT xtimer (monotonic clock of the host).
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+
+#define US_PER_MS   1000U
+#define US_PER_SEC  1000000U
+#define NS_PER_US   1000U
+
+// Time since the start of the program, from 1 s (0 is "never" for the firmware).
+uint64_t xtimer_now_usec64(void);
+
+static inline uint32_t xtimer_now_usec(void)
+{
+    return (uint32_t)xtimer_now_usec64();
+}
+
+void xtimer_usleep64(uint64_t usec);
+
+static inline void xtimer_usleep(uint32_t usec)
+{
+    xtimer_usleep64(usec);
+}
@@ -0,0 +1,595 @@
+/*
+
+Replay NMEA sentences into the UART ISR, through the GPS thread of uart.c,
+at 10 Hz and 115200 baud, and report the parsing time per sentence, the
+dropped sentences and the error of the decoded positions.
+
+The GNSS module is emulated: it answers PMTK605 as a MediaTek module and
+follows PMTK251, so the detection and the baudrate change of gps_config()
+run first. The sentences are either generated (a cold start, an ascent and
+positions all over the world, with 1% of corrupted sentences), or read from
+recorded logs given as arguments.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+#include "app.h"
+#include "gps.h"
+#include "host_riot.h"
+#include "host_test.h"
+
+#include <xtimer.h>
+
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+// Initialize the UART (stdio of RIOT, see uart.c).
+void stdio_init(void);
+
+// Rate of the epochs (Hz) and line rate once configured (bytes per second).
+#define REPLAY_EPOCH_HZ         10
+#define REPLAY_LINE_BYTES_S     (GPS_CONFIG_BAUDRATE / 10)
+
+// Number of generated epochs, and one corrupted sentence every ...
+#define REPLAY_EPOCHS           1200
+#define REPLAY_CORRUPT_PERIOD   100
+
+// Most sentences per epoch, and longest sentence.
+#define REPLAY_SENTENCES        16
+#define REPLAY_SENTENCE_LEN     128
+
+// Largest error of the 24-bit positions (about 1.2 m in latitude, 2.4 m in
+// longitude), in m.
+#define REPLAY_MAX_ERROR_M      3.0
+
+// Meters per degree of latitude.
+#define METERS_PER_DEGREE       111320.0
+
+
+// Sentence of an epoch, with its expected effect.
+typedef struct {
+    char text[REPLAY_SENTENCE_LEN];
+    bool supported;         // A sentence type decoded by the parser.
+    bool valid;             // Not corrupted, with a valid checksum.
+    bool position;          // GGA or RMC.
+    bool fix;               // Position with a fix.
+    double latitude;        // In degrees.
+    double longitude;
+    bool has_altitude;
+    int32_t altitude;       // In m, truncated.
+} sentence_t;
+
+// Sentences sent between two epochs.
+typedef struct {
+    sentence_t sentences[REPLAY_SENTENCES];
+    unsigned int count;
+} epoch_t;
+
+// Results of a replay.
+typedef struct {
+    unsigned int epochs;
+    unsigned int expected_sentences;
+    unsigned int expected_dropped;
+    unsigned int bytes;
+    unsigned int max_epoch_bytes;
+    unsigned int fix_errors;        // Epochs with has_fix unexpected.
+    unsigned int positions;         // Positions checked.
+    double max_error_m;
+    double sum_error_m;
+    unsigned int altitude_errors;
+} replay_t;
+
+// Bytes of the replay, parsed again without the GPS thread.
+static char *replay_bytes;
+static size_t replay_bytes_len;
+static size_t replay_bytes_size;
+
+
+// Emulated GNSS module.
+static struct {
+    pthread_mutex_t lock;
+    uint32_t baudrate;
+    char command[REPLAY_SENTENCE_LEN];
+    size_t command_len;
+    char replies[2 * REPLAY_SENTENCE_LEN];
+    size_t replies_len;
+} module = { .lock = PTHREAD_MUTEX_INITIALIZER, .baudrate = STD_BAUDRATE };
+
+
+// Queue a sentence sent by the module.
+static void module_reply(const char *body)
+{
+    char sentence[REPLAY_SENTENCE_LEN];
+    int len = host_nmea_sentence(sentence, sizeof(sentence), body);
+
+    if (module.replies_len + len <= sizeof(module.replies)) {
+        memcpy(module.replies + module.replies_len, sentence, len);
+        module.replies_len += len;
+    }
+}
+
+
+// Execute a command received by the module.
+static void module_command(const char *command)
+{
+    if (strncmp(command, "$PMTK605*", 9) == 0) {
+        module_reply("PMTK705,AXN_5.1.7_3333_00000000,0000,HOST,1.0");
+    } else if (strncmp(command, "$PMTK251,", 9) == 0) {
+        module.baudrate = strtoul(command + 9, NULL, 10);
+    }
+}
+
+
+// Bytes written on the UART by the firmware.
+static void module_receive(const uint8_t *data, size_t len)
+{
+    pthread_mutex_lock(&module.lock);
+    // The module does not understand the bytes sent at another baudrate.
+    if (host_uart_baudrate() == module.baudrate) {
+        for (size_t i = 0; i < len; i++) {
+            char c = data[i];
+            if (c == '$')
+                module.command_len = 0;
+            if (c == '\n' || module.command_len == sizeof(module.command) - 1) {
+                module.command[module.command_len] = '\0';
+                module_command(module.command);
+                module.command_len = 0;
+            } else {
+                module.command[module.command_len++] = c;
+            }
+        }
+    }
+    pthread_mutex_unlock(&module.lock);
+}
+
+
+// Send bytes from the module to the UART, without overrunning its buffer.
+static void module_send(const char *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        while (tsrb_full(&uart_info.rx.tsrb))
+            xtimer_usleep(10);
+        // Garbage when the baudrates differ.
+        host_uart_receive(host_uart_baudrate() == module.baudrate ? (uint8_t)data[i] : 0xFF);
+    }
+}
+
+
+// Send the replies of the module to its commands.
+static void module_send_replies(void)
+{
+    char replies[sizeof(module.replies)];
+
+    pthread_mutex_lock(&module.lock);
+    size_t len = module.replies_len;
+    memcpy(replies, module.replies, len);
+    module.replies_len = 0;
+    pthread_mutex_unlock(&module.lock);
+
+    module_send(replies, len);
+}
+
+
+// Let the GPS thread detect and configure the module (searching satellites).
+static bool replay_configure(void)
+{
+    char sentence[REPLAY_SENTENCE_LEN];
+    int len = host_nmea_sentence(sentence, sizeof(sentence), "GNGGA,,,,,,0,00,99.99,,,,,,");
+    uint64_t start = xtimer_now_usec64();
+    uint64_t next = start;
+
+    host_uart_set_tx_hook(module_receive);
+    stdio_init();
+    uart_gps_thread_start();
+
+    while (!isrpipe_host_is_idle(&uart_info.rx)) {
+        module_send_replies();
+        uint64_t now = xtimer_now_usec64();
+        if (now >= next) {
+            module_send(sentence, len);
+            next += US_PER_SEC / REPLAY_EPOCH_HZ;
+        }
+        if (now - start > 10 * US_PER_SEC)
+            return false;
+        xtimer_usleep(US_PER_MS);
+    }
+
+    printf("[replay] module configured in %lu ms at %lu baud (UART at %lu baud)\n",
+           (unsigned long)((xtimer_now_usec64() - start) / US_PER_MS),
+           (unsigned long)module.baudrate, (unsigned long)host_uart_baudrate());
+    return module.baudrate == GPS_CONFIG_BAUDRATE && host_uart_baudrate() == GPS_CONFIG_BAUDRATE;
+}
+
+
+// Convert a (d)ddmm.mmmmm field and its pole into degrees.
+static double nmea_degrees(const char *field, const char *pole)
+{
+    double value = strtod(field, NULL);
+    double degrees = floor(value / 100);
+    degrees += (value - 100 * degrees) / 60;
+    return (*pole == 'S' || *pole == 'W') ? -degrees : degrees;
+}
+
+
+// Decode a sentence as the reference of the parser.
+static void sentence_decode(sentence_t *s)
+{
+    char copy[REPLAY_SENTENCE_LEN];
+    char *fields[24];
+    unsigned int n = 0;
+    uint8_t checksum = 0;
+
+    s->supported = s->valid = s->position = s->fix = s->has_altitude = false;
+    if (s->text[0] != '$')
+        return;
+
+    // The body ends at the checksum, or at the end of a truncated sentence.
+    const char *end = strchr(s->text, '*');
+    if (end != NULL) {
+        for (const char *c = s->text + 1; c < end; c++)
+            checksum ^= *c;
+        s->valid = (strlen(end + 1) >= 2 && strtoul(end + 1, NULL, 16) == checksum);
+    } else {
+        end = s->text + strcspn(s->text, "\r\n");
+    }
+
+    // Split the fields (the empty ones included).
+    memcpy(copy, s->text + 1, end - s->text - 1);
+    copy[end - s->text - 1] = '\0';
+    for (char *f = copy; f != NULL && n < sizeof(fields) / sizeof(*fields); ) {
+        fields[n++] = f;
+        f = strchr(f, ',');
+        if (f != NULL)
+            *f++ = '\0';
+    }
+    while (n < sizeof(fields) / sizeof(*fields))
+        fields[n++] = "";
+
+    static const char *types[] = { "GGA", "RMC", "GSA", "GSV", "VTG", "ZDA" };
+    if (strlen(fields[0]) != 5)
+        return;
+    for (unsigned int i = 0; i < sizeof(types) / sizeof(*types); i++)
+        if (strcmp(fields[0] + 2, types[i]) == 0)
+            s->supported = true;
+
+    if (strcmp(fields[0] + 2, "GGA") == 0) {
+        s->position = true;
+        s->fix = atoi(fields[6]) > 0;
+        s->latitude = nmea_degrees(fields[2], fields[3]);
+        s->longitude = nmea_degrees(fields[4], fields[5]);
+        s->has_altitude = s->fix && *fields[9] != '\0';
+        s->altitude = (int32_t)strtod(fields[9], NULL);
+    } else if (strcmp(fields[0] + 2, "RMC") == 0) {
+        s->position = true;
+        s->fix = (*fields[2] == 'A');
+        s->latitude = nmea_degrees(fields[3], fields[4]);
+        s->longitude = nmea_degrees(fields[5], fields[6]);
+    }
+}
+
+
+// Add a sentence to an epoch.
+static sentence_t *epoch_add(epoch_t *e, const char *text)
+{
+    if (e->count == REPLAY_SENTENCES)
+        return NULL;
+    sentence_t *s = &e->sentences[e->count++];
+    snprintf(s->text, sizeof(s->text), "%s", text);
+    sentence_decode(s);
+    return s;
+}
+
+
+// Add a sentence to an epoch from its body.
+static sentence_t *epoch_add_body(epoch_t *e, const char *body)
+{
+    char sentence[REPLAY_SENTENCE_LEN];
+    host_nmea_sentence(sentence, sizeof(sentence), body);
+    return epoch_add(e, sentence);
+}
+
+
+// Convert the 24-bit encoding into degrees.
+static double binary_degrees(int32_t value, double range)
+{
+    return value * range / ((value < 0) ? 8388608.0 : 8388607.0);
+}
+
+
+// Send an epoch, wait for its parsing, and check the decoded GPS data.
+static void replay_epoch(replay_t *r, const epoch_t *e)
+{
+    static bool has_fix = false;
+    const sentence_t *last = NULL;
+    const sentence_t *altitude = NULL;
+    unsigned int bytes = 0;
+
+    for (unsigned int i = 0; i < e->count; i++) {
+        const sentence_t *s = &e->sentences[i];
+        size_t len = strlen(s->text);
+        module_send(s->text, len);
+        bytes += len;
+
+        if (replay_bytes_len + len > replay_bytes_size) {
+            replay_bytes_size = 2 * (replay_bytes_size + len);
+            replay_bytes = realloc(replay_bytes, replay_bytes_size);
+        }
+        memcpy(replay_bytes + replay_bytes_len, s->text, len);
+        replay_bytes_len += len;
+
+        if (!s->supported)
+            continue;
+        if (!s->valid) {
+            r->expected_dropped++;
+            continue;
+        }
+        r->expected_sentences++;
+        if (s->position) {
+            has_fix = s->fix;
+            last = s;
+            if (s->has_altitude)
+                altitude = s;
+        }
+    }
+
+    r->epochs++;
+    r->bytes += bytes;
+    if (bytes > r->max_epoch_bytes)
+        r->max_epoch_bytes = bytes;
+
+    isrpipe_host_wait_idle(&uart_info.rx);
+
+    gps_data_t data;
+    gps_get_data(&data);
+    if (data.has_fix != has_fix) {
+        r->fix_errors++;
+        return;
+    }
+    if (!has_fix || last == NULL)
+        return;
+
+    double lat = binary_degrees(data.latitude_bin, 90);
+    double lon = binary_degrees(data.longitude_bin, 180);
+    double dy = (lat - last->latitude) * METERS_PER_DEGREE;
+    double dx = (lon - last->longitude) * METERS_PER_DEGREE * cos(last->latitude * M_PI / 180);
+    double error = sqrt(dx * dx + dy * dy);
+    r->positions++;
+    r->sum_error_m += error;
+    if (error > r->max_error_m)
+        r->max_error_m = error;
+
+    // The altitude is kept in 16 bits.
+    if (altitude != NULL && altitude->altitude >= INT16_MIN && altitude->altitude <= INT16_MAX &&
+        data.altitude != altitude->altitude)
+        r->altitude_errors++;
+}
+
+
+// Format a position in (d)ddmm.mmmmm and its pole.
+static void format_position(char *buf, size_t size, double degrees, int deg_digits,
+                            char positive, char negative)
+{
+    long long e5 = llround(fabs(degrees) * 60 * 100000);  // 1e-5 minute.
+    snprintf(buf, size, "%0*lld%02lld.%05lld,%c", deg_digits, e5 / 6000000,
+             (e5 % 6000000) / 100000, e5 % 100000, (degrees < 0) ? negative : positive);
+}
+
+
+// Generate the sentences of an epoch (u-blox M8 output at 10 Hz).
+static void generate_epoch(epoch_t *e, unsigned int k)
+{
+    char body[REPLAY_SENTENCE_LEN], lat[24], lon[24], time[16];
+    double latitude, longitude, altitude;
+    unsigned int t = k / REPLAY_EPOCH_HZ;
+
+    e->count = 0;
+    snprintf(time, sizeof(time), "%02u%02u%02u.%02u", 10 + t / 3600, t / 60 % 60, t % 60,
+             (k % REPLAY_EPOCH_HZ) * (100 / REPLAY_EPOCH_HZ));
+
+    if (k < 50) {
+        // Cold start: no fix, empty fields.
+        snprintf(body, sizeof(body), "GNGGA,%s,,,,,0,00,99.99,,,,,,", time);
+        epoch_add_body(e, body);
+        epoch_add_body(e, "GNGSA,A,1,,,,,,,,,,,,,99.99,99.99,99.99");
+        snprintf(body, sizeof(body), "GNRMC,%s,V,,,,,,,,,,N", time);
+        epoch_add_body(e, body);
+        epoch_add_body(e, "GNVTG,,,,,,,,,N");
+        if (k % 10 == 0)
+            epoch_add_body(e, "GNTXT,01,01,01,ANTENNA OK");
+        return;
+    }
+
+    if (k < REPLAY_EPOCHS / 2) {
+        // Ascent from Grenoble at 5 m/s, drifting east.
+        double s = (k - 50) / (double)REPLAY_EPOCH_HZ;
+        latitude = 45.1934 + 0.00002 * s;
+        longitude = 5.7674 + 0.0001 * s;
+        altitude = 212.3 + 5 * s;
+    } else {
+        // All over the world, from below the sea level to 30 km.
+        latitude = 89.99 * sin(k * 0.37);
+        longitude = 179.99 * sin(k * 0.11 + 1);
+        altitude = 14785 + 15215 * sin(k * 0.05);
+    }
+    format_position(lat, sizeof(lat), latitude, 2, 'N', 'S');
+    format_position(lon, sizeof(lon), longitude, 3, 'E', 'W');
+
+    snprintf(body, sizeof(body), "GNGGA,%s,%s,%s,1,12,0.71,%.1f,M,48.0,M,,", time, lat, lon, altitude);
+    epoch_add_body(e, body);
+    epoch_add_body(e, "GNGSA,A,3,02,05,12,13,15,18,20,25,29,,,,1.32,0.71,1.11");
+    epoch_add_body(e, "GNGSA,A,3,65,66,74,,,,,,,,,,1.32,0.71,1.11");
+    snprintf(body, sizeof(body), "GNRMC,%s,A,%s,%s,2.634,77.52,161026,,,A", time, lat, lon);
+    epoch_add_body(e, body);
+    epoch_add_body(e, "GNVTG,77.52,T,,M,2.634,N,4.878,K,A");
+    if (k % 10 == 0) {
+        epoch_add_body(e, "GPGSV,3,1,11,02,35,299,43,05,65,218,45,12,22,088,38,13,48,048,44");
+        epoch_add_body(e, "GPGSV,3,2,11,15,32,134,40,18,09,324,29,20,18,255,36,25,40,198,44");
+        epoch_add_body(e, "GPGSV,3,3,11,29,71,090,47,31,,,31,46,34,143,");
+        epoch_add_body(e, "GLGSV,1,1,03,65,41,053,40,66,58,147,42,74,27,320,35");
+        snprintf(body, sizeof(body), "GNZDA,%s,16,10,2026,00,00", time);
+        epoch_add_body(e, body);
+    }
+}
+
+
+// Corrupt a sentence: a digit changed (bad checksum), or truncated.
+static void corrupt(sentence_t *s, unsigned int kind)
+{
+    char *star = strchr(s->text, '*');
+    char *digit = strpbrk(s->text, "0123456789");
+
+    if (kind % 2 == 0 && digit != NULL && digit < star) {
+        *digit = '0' + (*digit - '0' + 1) % 10;
+    } else {
+        s->text[strlen(s->text) / 2] = '\0';
+    }
+    s->valid = false;
+}
+
+
+// Replay the generated sentences.
+static void replay_generated(replay_t *r)
+{
+    epoch_t e;
+    unsigned int n = 0;
+
+    for (unsigned int k = 0; k < REPLAY_EPOCHS; k++) {
+        generate_epoch(&e, k);
+        // Never the last sentence, which would be pending.
+        for (unsigned int i = 0; i < e.count && k + 1 < REPLAY_EPOCHS; i++)
+            if (e.sentences[i].supported && ++n % REPLAY_CORRUPT_PERIOD == 0)
+                corrupt(&e.sentences[i], n / REPLAY_CORRUPT_PERIOD);
+        replay_epoch(r, &e);
+    }
+}
+
+
+// Get the time field of a GGA, RMC or ZDA sentence ("" for the others).
+static void sentence_time(const char *text, char *time, size_t size)
+{
+    time[0] = '\0';
+    if (strlen(text) < 7 || (strncmp(text + 3, "GGA,", 4) != 0 &&
+        strncmp(text + 3, "RMC,", 4) != 0 && strncmp(text + 3, "ZDA,", 4) != 0))
+        return;
+    const char *end = strchr(text + 7, ',');
+    size_t len = end ? (size_t)(end - text - 7) : 0;
+    if (len >= size)
+        len = size - 1;
+    memcpy(time, text + 7, len);
+    time[len] = '\0';
+}
+
+
+// Replay a recorded log: an epoch starts when the time of the fixes changes.
+static bool replay_file(replay_t *r, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+
+    char line[REPLAY_SENTENCE_LEN], text[REPLAY_SENTENCE_LEN];
+    char epoch_time[16] = "", time[16];
+    epoch_t e = { .count = 0 };
+
+    while (fgets(line, sizeof(line) - 2, f) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0')
+            continue;
+        sentence_time(line, time, sizeof(time));
+        if ((time[0] != '\0' && strcmp(time, epoch_time) != 0 && e.count > 0) ||
+            e.count == REPLAY_SENTENCES) {
+            replay_epoch(r, &e);
+            e.count = 0;
+        }
+        if (time[0] != '\0')
+            strcpy(epoch_time, time);
+        snprintf(text, sizeof(text), "%s\r\n", line);
+        epoch_add(&e, text);
+    }
+    if (e.count > 0)
+        replay_epoch(r, &e);
+    fclose(f);
+    return true;
+}
+
+
+// Time spent by the parser alone on the bytes of the replay, in ns.
+static uint64_t replay_parser_ns(void)
+{
+    struct timespec start, end;
+
+    // The GPS thread waits for bytes, so this is the only writer.
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+    gps_parse_data((int8_t *)replay_bytes, replay_bytes_len);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+    return (end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec;
+}
+
+
+int main(int argc, char **argv)
+{
+    if (!replay_configure()) {
+        printf("[replay] the module has not been configured\n");
+        return 1;
+    }
+
+    for (int i = (argc > 1) ? 1 : 0; i < argc; i++) {
+        replay_t r;
+        memset(&r, 0, sizeof(r));
+        uint32_t sentences = uart_info.sentences;
+        uint32_t dropped = uart_info.dropped;
+        uint32_t overruns = uart_info.overruns;
+        uint64_t cpu = host_thread_cpu_ns("GPS");
+        replay_bytes_len = 0;
+
+        const char *name = (argc > 1) ? argv[i] : "generated";
+        if (argc > 1) {
+            if (!replay_file(&r, argv[i]))
+                return 1;
+        } else {
+            replay_generated(&r);
+        }
+
+        sentences = uart_info.sentences - sentences;
+        dropped = uart_info.dropped - dropped;
+        overruns = uart_info.overruns - overruns;
+        cpu = host_thread_cpu_ns("GPS") - cpu;
+        uint64_t parser = replay_parser_ns();
+        unsigned int total = (sentences + dropped) ? sentences + dropped : 1;
+
+        printf("[replay] %s: %u epochs, %u bytes, line load %u%% at most (%u bytes per epoch at %u Hz)\n",
+               name, r.epochs, r.bytes,
+               r.max_epoch_bytes * 100 / (REPLAY_LINE_BYTES_S / REPLAY_EPOCH_HZ),
+               r.max_epoch_bytes, REPLAY_EPOCH_HZ);
+        printf("[replay] %s: sentences=%u (expected %u) dropped=%u (expected %u) overruns=%u\n",
+               name, sentences, r.expected_sentences, dropped, r.expected_dropped, overruns);
+        printf("[replay] %s: parser %u ns/sentence %u ns/byte, GPS thread %u ns/sentence %u ns/byte "
+               "(%u ns per byte at %u baud)\n",
+               name, (unsigned int)(parser / total), (unsigned int)(parser / (r.bytes ? r.bytes : 1)),
+               (unsigned int)(cpu / total), (unsigned int)(cpu / (r.bytes ? r.bytes : 1)),
+               (unsigned int)(10 * 1000000000ULL / GPS_CONFIG_BAUDRATE), GPS_CONFIG_BAUDRATE);
+        printf("[replay] %s: %u positions, error %.2f m at most, %.2f m on average, "
+               "%u fix errors, %u altitude errors\n",
+               name, r.positions, r.max_error_m, r.positions ? r.sum_error_m / r.positions : 0,
+               r.fix_errors, r.altitude_errors);
+
+        CHECK(sentences == r.expected_sentences);
+        CHECK(dropped == r.expected_dropped);
+        CHECK(overruns == 0);
+        CHECK(r.fix_errors == 0);
+        CHECK(r.altitude_errors == 0);
+        CHECK(r.max_error_m <= REPLAY_MAX_ERROR_M);
+    }
+
+    return host_test_report("replay");
+}
@@ -0,0 +1,130 @@
+/*
+
+Tests of the airtime scheduler (airtime.c) on a simulated clock: the time
+off of the 1% duty cycle after a SF12 frame, and the daily airtime budget
+over hourly slots (built with AIRTIME_BUDGET_MS=30000 in EU868).
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+#include "airtime.h"
+#include "time_on_air.h"
+#include "xtimer.h"
+#include "host_riot.h"
+#include "host_test.h"
+
+
+#define HOUR_MS     (60ULL * 60 * 1000)
+#define DAY_MS      (24 * HOUR_MS)
+
+
+static uint64_t now_ms(void)
+{
+    return xtimer_now_usec64() / US_PER_MS;
+}
+
+static void sleep_ms(uint64_t ms)
+{
+    xtimer_usleep64(ms * US_PER_MS);
+}
+
+
+// Time off of the 1% duty cycle after a frame.
+static uint32_t time_off_ms(uint8_t dr, uint8_t len)
+{
+    return ((uint64_t)time_on_air_us(dr, len) * 99 + US_PER_MS - 1) / US_PER_MS;
+}
+
+
+static void test_duty_cycle(void)
+{
+    uint32_t off = time_off_ms(0, 10);
+
+    CHECK(airtime_wait_ms(0, 10) == 0);
+    airtime_sent(0, 10);
+    // About 1.6 s on air, with the FOpts of the MAC.
+    CHECK(off > 150000 && off < 170000);
+
+    // The time off applies to any datarate and size, and decreases with time.
+    CHECK(airtime_wait_ms(0, 10) == off);
+    CHECK(airtime_wait_ms(5, 1) == off);
+    sleep_ms(off / 2);
+    CHECK(airtime_wait_ms(0, 10) == off - off / 2);
+    sleep_ms(off - off / 2 - 1);
+    CHECK(airtime_wait_ms(0, 10) == 1);
+    sleep_ms(1);
+    CHECK(airtime_wait_ms(0, 10) == 0);
+
+    // A frame sent during the time off does not extend it.
+    airtime_sent(5, 10);
+    sleep_ms(1);
+    airtime_sent(0, 51);
+    CHECK(airtime_wait_ms(0, 10) == time_off_ms(5, 10) - 1);
+    sleep_ms(2 * DAY_MS);
+}
+
+
+static void test_budget(void)
+{
+    const uint8_t dr = 0, len = 51;
+    const unsigned int frames = (uint64_t)AIRTIME_BUDGET_MS * US_PER_MS / time_on_air_us(dr, len);
+    uint64_t first = now_ms();
+    unsigned int n = 0;
+    uint32_t wait;
+
+    // Frames as fast as the duty cycle allows, until the budget is used.
+    while ((wait = airtime_wait_ms(dr, len)) <= time_off_ms(dr, len) && n <= frames) {
+        sleep_ms(wait);
+        airtime_sent(dr, len);
+        n++;
+    }
+    CHECK(n == frames);
+
+    // Allowed again once the slot of the first frame left the day.
+    CHECK(now_ms() + wait >= first + DAY_MS);
+    CHECK(now_ms() + wait <= first + DAY_MS + HOUR_MS);
+    CHECK((now_ms() + wait) % HOUR_MS == 0);
+    sleep_ms(wait - 1);
+    CHECK(airtime_wait_ms(dr, len) == 1);
+    sleep_ms(1);
+    CHECK(airtime_wait_ms(dr, len) == 0);
+
+    // The whole budget after a few days without frames.
+    sleep_ms(3 * DAY_MS + 1234);
+    for (n = 0; n < frames; n++) {
+        CHECK(airtime_wait_ms(dr, len) == 0);
+        airtime_sent(dr, len);
+        sleep_ms(time_off_ms(dr, len));
+    }
+    CHECK(airtime_wait_ms(dr, len) > HOUR_MS);
+    sleep_ms(2 * DAY_MS);
+
+    // One frame an hour: the slots leave the day one by one.
+    uint64_t start = now_ms() - now_ms() % HOUR_MS + HOUR_MS / 2;
+    sleep_ms(start - now_ms());
+    for (n = 0; n < frames; n++) {
+        CHECK(airtime_wait_ms(dr, len) == 0);
+        airtime_sent(dr, len);
+        sleep_ms(HOUR_MS);
+    }
+    wait = airtime_wait_ms(dr, len);
+    CHECK(now_ms() + wait == start - HOUR_MS / 2 + DAY_MS + HOUR_MS);
+    sleep_ms(wait);
+    CHECK(airtime_wait_ms(dr, len) == 0);
+    airtime_sent(dr, len);
+    CHECK(airtime_wait_ms(dr, len) == HOUR_MS);
+}
+
+
+int main(void)
+{
+    // A boot 10 minutes ago, in the first hourly slot.
+    host_clock_simulate(10 * 60 * US_PER_SEC);
+
+    test_duty_cycle();
+    test_budget();
+
+    return host_test_report("airtime");
+}
@@ -0,0 +1,237 @@
+/*
+
+Regression tests of the NMEA parser: empty fields, truncated sentences and
+the fix updated only by the sentences that carry a position.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+#include "gps.h"
+#include "host_test.h"
+
+#include <xtimer.h>
+
+#include <stdio.h>
+#include <string.h>
+
+
+// Feed a raw string to the parser, and return the status of the last sentence.
+static uint8_t feed_raw(const char *raw)
+{
+    uint8_t status = GPS_PENDING;
+
+    for (const char *c = raw; *c; c++) {
+        uint8_t s = gps_parse_byte(*c);
+        if (s != GPS_PENDING)
+            status = s;
+    }
+    return status;
+}
+
+
+// Feed a sentence given without the '$' and the checksum.
+static uint8_t feed(const char *body)
+{
+    char sentence[128];
+    host_nmea_sentence(sentence, sizeof(sentence), body);
+    return feed_raw(sentence);
+}
+
+
+// A 3D fix at Grenoble (45.1934 N, 5.7674 E, 212 m).
+static void fix_grenoble(void)
+{
+    CHECK(feed("GNGGA,101500.00,4511.60400,N,00546.04400,E,1,09,0.90,212.3,M,48.0,M,,") == GPS_SUCCESS);
+}
+
+
+static void test_empty_gga(void)
+{
+    gps_data_t data;
+    gps_fix_t fix, before;
+
+    fix_grenoble();
+    CHECK(gps_get_fix(&before) == GPS_SUCCESS);
+
+    // No fix yet: every field but the quality is empty.
+    CHECK(feed("GPGGA,,,,,,0,00,99.99,,,,,,") == GPS_SUCCESS);
+    gps_get_data(&data);
+    CHECK(!data.has_fix);
+    CHECK(data.fix_quality == 0);
+    CHECK(data.satellites_used == 0);
+    CHECK(data.hdop == 9999);
+    CHECK(data.hour == 10 && data.minute == 15 && data.second == 0);  // Kept.
+    CHECK(data.altitude == 212);                                      // Kept.
+
+    // The last fix is kept as is.
+    CHECK(gps_get_fix(&fix) == GPS_SUCCESS);
+    CHECK(fix.timestamp == before.timestamp);
+    CHECK(fix.latitude_bin == before.latitude_bin);
+
+    // Even the fix quality is empty.
+    CHECK(feed("GPGGA,,,,,,,,,,,,,,") == GPS_SUCCESS);
+    gps_get_data(&data);
+    CHECK(!data.has_fix);
+
+    // Position without time nor altitude.
+    CHECK(feed("GPGGA,,4511.60400,N,00546.04400,E,1,05,1.5,,M,,M,,") == GPS_SUCCESS);
+    gps_get_data(&data);
+    CHECK(data.has_fix);
+    CHECK(data.latitude_bin == before.latitude_bin);
+    CHECK(data.longitude_bin == before.longitude_bin);
+    CHECK(data.altitude == 212);
+}
+
+
+static void test_empty_rmc(void)
+{
+    gps_data_t data;
+
+    CHECK(feed("GNRMC,101501.00,A,4511.60400,N,00546.04400,E,10.0,123.4,161026,,,A") == GPS_SUCCESS);
+    gps_get_data(&data);
+    CHECK(data.has_fix);
+    CHECK(data.speed == 185);       // 10 knots in 0.1 km/h.
+    CHECK(data.course == 1234);
+    CHECK(data.day == 16 && data.month == 10 && data.year == 2026);
+
+    // Void: the other fields are empty, and kept.
+    CHECK(feed("GNRMC,,V,,,,,,,,,,N") == GPS_SUCCESS);
+    gps_get_data(&data);
+    CHECK(!data.has_fix);
+    CHECK(data.speed == 185);
+    CHECK(data.course == 1234);
+    CHECK(data.day == 16 && data.month == 10 && data.year == 2026);
+}
+
+
+static void test_empty_others(void)
+{
+    gps_data_t data;
+
+    CHECK(feed("GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1") == GPS_SUCCESS);
+    gps_get_data(&data);
+    CHECK(data.fix_mode == 3);
+    CHECK(data.pdop == 250 && data.hdop == 130 && data.vdop == 210);
+
+    CHECK(feed("GPGSA,A,1,,,,,,,,,,,,,,,") == GPS_SUCCESS);
+    gps_get_data(&data);
+    CHECK(data.fix_mode == 1);
+    CHECK(data.pdop == 0 && data.hdop == 0 && data.vdop == 0);
+
+    CHECK(feed("GPGSV,1,1,00") == GPS_SUCCESS);
+    gps_get_data(&data);
+    CHECK(data.satellites_in_view == 0);
+
+    CHECK(feed("GPVTG,54.7,T,,M,5.5,N,10.2,K,A") == GPS_SUCCESS);
+    gps_get_data(&data);
+    CHECK(data.course == 547 && data.speed == 102);
+    CHECK(feed("GPVTG,,,,,,,,,N") == GPS_SUCCESS);
+    gps_get_data(&data);
+    CHECK(data.course == 547 && data.speed == 102);
+
+    CHECK(feed("GPZDA,,,,,,") == GPS_SUCCESS);
+    gps_get_data(&data);
+    CHECK(data.day == 16 && data.month == 10 && data.year == 2026);
+
+    // No field at all: dropped, without changing the data.
+    CHECK(feed("GPGGA") == GPS_FAIL);
+    CHECK(feed("GPRMC") == GPS_FAIL);
+    gps_get_data(&data);
+    CHECK(data.day == 16 && data.month == 10 && data.year == 2026);
+}
+
+
+static void test_dropped(void)
+{
+    // Bad checksum.
+    CHECK(feed_raw("$GPGGA,,,,,,0,00,99.99,,,,,,*00\r\n") == GPS_FAIL);
+    // Empty or non hex checksum.
+    CHECK(feed_raw("$GPGGA,,,,,,0,00,99.99,,,,,,*\r\n") == GPS_FAIL);
+    CHECK(feed_raw("$GPGGA,,,,,,0,00,99.99,,,,,,*4G\r\n") == GPS_FAIL);
+    // Truncated by the next sentence.
+    CHECK(feed_raw("$GPGGA,1015") == GPS_PENDING);
+    CHECK(feed_raw("$") == GPS_FAIL);
+    CHECK(feed_raw("\r\n") == GPS_FAIL);
+    // Too long.
+    char sentence[160];
+    memset(sentence, ',', sizeof(sentence));
+    memcpy(sentence, "$GPGGA", 6);
+    sentence[sizeof(sentence) - 1] = '\0';
+    CHECK(feed_raw(sentence) == GPS_FAIL);
+    // Unsupported sentences are ignored.
+    CHECK(feed("GPTXT,01,01,02,ANTSTATUS=OK") == GPS_PENDING);
+    CHECK(feed("PUBX,00,,,,,,,,,,,,,,,,,,,") == GPS_PENDING);
+}
+
+
+static void test_position_update(void)
+{
+    gps_fix_t fix, history[GPS_HISTORY_SIZE];
+
+    fix_grenoble();
+    CHECK(gps_get_fix(&fix) == GPS_SUCCESS);
+    uint32_t timestamp = fix.timestamp;
+    uint32_t ttff = gps_get_ttff();
+    uint8_t count = gps_get_history(history, GPS_HISTORY_SIZE);
+
+    // The sentences without position do not refresh the fix.
+    xtimer_usleep(5 * US_PER_MS);
+    CHECK(feed("GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1") == GPS_SUCCESS);
+    CHECK(feed("GPGSV,1,1,00") == GPS_SUCCESS);
+    CHECK(feed("GPVTG,54.7,T,,M,5.5,N,10.2,K,A") == GPS_SUCCESS);
+    CHECK(feed("GPZDA,101502.00,16,10,2026,00,00") == GPS_SUCCESS);
+    CHECK(gps_get_fix(&fix) == GPS_SUCCESS);
+    CHECK(fix.timestamp == timestamp);
+    CHECK(fix.age >= 5);
+    CHECK(gps_get_ttff() == ttff);
+    CHECK(gps_get_history(history, GPS_HISTORY_SIZE) == count);
+
+    // A position does.
+    fix_grenoble();
+    CHECK(gps_get_fix(&fix) == GPS_SUCCESS);
+    CHECK(fix.timestamp > timestamp);
+    CHECK(gps_get_ttff() == ttff);
+}
+
+
+static void test_reset(void)
+{
+    gps_data_t data;
+    gps_fix_t fix;
+
+    fix_grenoble();
+    gps_reset_data();
+    gps_get_data(&data);
+    CHECK(!data.has_fix);
+
+    // The next sentence without position does not bring the old fix back.
+    CHECK(feed("GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1") == GPS_SUCCESS);
+    gps_get_data(&data);
+    CHECK(!data.has_fix);
+    int32_t lat, lon;
+    int16_t alt;
+    CHECK(gps_get_binary(&lat, &lon, &alt) == GPS_FAIL);
+
+    // The last fix is still available, with its age.
+    CHECK(gps_get_fix(&fix) == GPS_SUCCESS);
+}
+
+
+int main(void)
+{
+    // Before the first fix.
+    gps_fix_t fix;
+    CHECK(gps_get_fix(&fix) == GPS_FAIL);
+    CHECK(gps_get_ttff() == 0);
+
+    test_empty_gga();
+    test_empty_rmc();
+    test_empty_others();
+    test_dropped();
+    test_position_update();
+    test_reset();
+
+    return host_test_report("gps");
+}
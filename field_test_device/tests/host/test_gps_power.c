@@ -0,0 +1,156 @@
+/*
+
+Tests of the power manager of the GNSS module (gps_power.c, PMTK161 standby)
+on a simulated clock, against a fake module: lead time of the wake up, moving
+average of the time to fix, backoff after a miss, and console held during the
+standby.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+#include "gps.h"
+#include "gps_power.h"
+#include "app.h"
+#include "xtimer.h"
+#include "host_riot.h"
+#include "host_test.h"
+
+#include <string.h>
+
+
+// Time to fix of the fake module after a wake up (0 for no fix).
+static uint32_t module_ttff_ms;
+
+// Whether the module is in standby, and when it has been woken up.
+static bool module_standby;
+static uint32_t module_wake_ms;
+
+// Last fix of the module (timestamp 0 for none).
+static uint32_t module_fix_ms;
+
+// Console held, and commands sent while it was not.
+static bool console_held;
+static unsigned int unheld_commands;
+
+
+static uint32_t now_ms(void)
+{
+    return xtimer_now_usec64() / US_PER_MS;
+}
+
+
+// Fake fix source: a fix `module_ttff_ms` after the wake up, until the standby.
+uint8_t gps_get_fix(gps_fix_t *fix)
+{
+    if (!module_standby && module_ttff_ms != 0 && now_ms() >= module_wake_ms + module_ttff_ms)
+        module_fix_ms = module_wake_ms + module_ttff_ms;
+    if (module_fix_ms == 0)
+        return GPS_FAIL;
+
+    memset(fix, 0, sizeof(*fix));
+    fix->timestamp = module_fix_ms;
+    fix->age = now_ms() - module_fix_ms;
+    return GPS_SUCCESS;
+}
+
+
+void uart_gps_send(const uint8_t *data, size_t len)
+{
+    if (!console_held)
+        unheld_commands++;
+    if (len >= 9 && memcmp(data, "$PMTK161,", 9) == 0) {
+        module_standby = true;
+    } else if (module_standby) {
+        // Any byte wakes the module up.
+        module_standby = false;
+        module_wake_ms = now_ms();
+    }
+}
+
+
+void uart_gps_request(unsigned int requests)
+{
+    (void)requests;
+}
+
+
+void uart_stdio_hold(bool hold)
+{
+    CHECK(hold != console_held);
+    console_held = hold;
+}
+
+
+// Sleep `ms`, and check the time off and the duration of the sleep.
+static void check_sleep(uint32_t ms, uint32_t off_ms)
+{
+    gps_power_stats_t before, after;
+    uint32_t start = now_ms();
+
+    gps_power_get_stats(&before);
+    gps_power_sleep(ms);
+    gps_power_get_stats(&after);
+
+    CHECK(now_ms() - start == ms);
+    CHECK(after.off_ms - before.off_ms == off_ms);
+    CHECK(after.on_ms - before.on_ms == ms - off_ms);
+    CHECK(after.cycles - before.cycles == (off_ms ? 1 : 0));
+    if (off_ms)
+        CHECK(module_wake_ms == start + off_ms);
+    CHECK(!module_standby && !console_held && unheld_commands == 0);
+}
+
+
+int main(void)
+{
+    gps_power_stats_t stats;
+    host_clock_simulate(US_PER_SEC);
+
+    // A fix before the first sleep does not count after the wake up.
+    module_fix_ms = now_ms();
+
+    // Woken up at the initial time to fix plus the margin before the deadline.
+    module_ttff_ms = 20000;
+    check_sleep(120000, 120000 - GPS_POWER_INITIAL_TTFF_MS - GPS_POWER_MARGIN_MS);
+    gps_power_get_stats(&stats);
+    CHECK(stats.ttff_last_ms == 20000 && stats.ttff_max_ms == 20000);
+    CHECK(stats.ttff_avg_ms == (3 * GPS_POWER_INITIAL_TTFF_MS + 20000) / 4);
+    CHECK(stats.misses == 0);
+
+    // The lead time follows the average.
+    uint32_t avg = stats.ttff_avg_ms;
+    module_ttff_ms = 12000;
+    check_sleep(120000, 120000 - avg - GPS_POWER_MARGIN_MS);
+    gps_power_get_stats(&stats);
+    CHECK(stats.ttff_last_ms == 12000 && stats.ttff_max_ms == 20000);
+    CHECK(stats.ttff_avg_ms == (3 * avg + 12000) / 4);
+
+    // Too short for a power cycle: the module stays on.
+    avg = stats.ttff_avg_ms;
+    check_sleep(avg + GPS_POWER_MARGIN_MS + GPS_POWER_MIN_OFF_MS - 1, 0);
+
+    // No fix before the deadline: the lead time doubles, up to the maximum.
+    module_ttff_ms = 0;
+    check_sleep(600000, 600000 - avg - GPS_POWER_MARGIN_MS);
+    gps_power_get_stats(&stats);
+    CHECK(stats.misses == 1 && stats.ttff_avg_ms == 2 * avg);
+    check_sleep(600000, 600000 - 2 * avg - GPS_POWER_MARGIN_MS);
+    check_sleep(600000, 600000 - 4 * avg - GPS_POWER_MARGIN_MS);
+    gps_power_get_stats(&stats);
+    CHECK(stats.misses == 3 && stats.ttff_avg_ms == GPS_POWER_MAX_TTFF_MS);
+    check_sleep(600000, 600000 - GPS_POWER_MAX_TTFF_MS - GPS_POWER_MARGIN_MS);
+    gps_power_get_stats(&stats);
+    CHECK(stats.misses == 4 && stats.ttff_avg_ms == GPS_POWER_MAX_TTFF_MS);
+
+    // Back to a fix: the average decreases from the maximum.
+    module_ttff_ms = 8000;
+    check_sleep(600000, 600000 - GPS_POWER_MAX_TTFF_MS - GPS_POWER_MARGIN_MS);
+    gps_power_get_stats(&stats);
+    CHECK(stats.ttff_last_ms == 8000 && stats.misses == 4);
+    CHECK(stats.ttff_avg_ms == (3 * GPS_POWER_MAX_TTFF_MS + 8000) / 4);
+    CHECK(stats.cycles == 7);
+
+    return host_test_report("gps power");
+}
@@ -0,0 +1,188 @@
+/*
+
+Round trip of the payload (payload.c) over the fields of payload_fields.h:
+the fixed fields, truncated to every length, and the bit-packed payload
+(built with the default fields, and with all of them and PAYLOAD_PACKED).
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+#include "payload.h"
+#include "host_test.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+// Position of the anchor of the bit-packed payload in the 24-bit encoding.
+#define ANCHOR_LAT  ((int32_t)(PAYLOAD_PACKED_ANCHOR_LAT * 8388607 / 90 + 0.5))
+#define ANCHOR_LON  ((int32_t)(PAYLOAD_PACKED_ANCHOR_LON * 8388607 / 180 + 0.5))
+
+// Guard byte after the payload.
+#define GUARD   0xEE
+
+
+// Values using all the bits of each field, with the sign bit of the signed
+// ones (the txpower idx shares its byte with the format).
+static void full_values(payload_values_t *values)
+{
+    unsigned int i = 0;
+
+#define X(name, key, sign, bytes, divisor) \
+    i++; \
+    values->name = (sign) ? -(int32_t)((0x5A5A5A5AUL ^ i) & ((1UL << (8 * (bytes) - 1)) - 1)) - 1 \
+                          : (int32_t)((0xA5A5A5A5UL ^ i) & (0xFFFFFFFFUL >> (32 - 8 * (bytes))));
+    PAYLOAD_FIELDS(X)
+#undef X
+    values->txpower = 7;
+}
+
+
+// Number of fields which differ between two sets of values.
+static unsigned int compare(const payload_values_t *a, const payload_values_t *b, unsigned int len)
+{
+    unsigned int mismatches = 0;
+
+#define X(name, key, sign, bytes, divisor) \
+    if (PAYLOAD_END(name) <= len ? a->name != b->name : b->name != 0) { \
+        if (mismatches++ < 5) \
+            printf("%s, %u bytes: %ld, expected %ld\n", key, len, (long)b->name, \
+                   (long)(PAYLOAD_END(name) <= len ? a->name : 0)); \
+    }
+    PAYLOAD_FIELDS(X)
+#undef X
+    return mismatches;
+}
+
+
+static void test_fields(void)
+{
+    payload_values_t values = { 0 }, decoded;
+    uint8_t full[PAYLOAD_FIELDS_LEN + 1], payload[PAYLOAD_FIELDS_LEN + 1];
+
+    full_values(&values);
+
+    // The whole fixed fields.
+    memset(full, GUARD, sizeof(full));
+    CHECK(payload_encode(full, sizeof(full), &values) == PAYLOAD_FIELDS_LEN);
+    CHECK(full[PAYLOAD_FIELDS_LEN] == GUARD);
+    CHECK(full[0] >> 4 == PAYLOAD_FORMAT_FIELDS);
+    CHECK(payload_decode(full, PAYLOAD_FIELDS_LEN, &decoded) == PAYLOAD_FIELDS_LEN);
+    CHECK(compare(&values, &decoded, PAYLOAD_FIELDS_LEN) == 0);
+
+    // Big endian fields, at the offsets of the layout.
+    CHECK(full[PAYLOAD_OFFSET(datarate)] == (uint8_t)values.datarate);
+    CHECK(full[PAYLOAD_OFFSET(latitude)] == (uint8_t)(values.latitude >> 16));
+    CHECK(full[PAYLOAD_END(latitude) - 1] == (uint8_t)values.latitude);
+
+    // Truncated to every length (below the bit-packed payload if it is on).
+    unsigned int mismatches = 0;
+    for (unsigned int len = 0; len < PAYLOAD_FIELDS_LEN; len++) {
+        if (PAYLOAD_IS_PACKED(len))
+            continue;
+        memset(payload, GUARD, sizeof(payload));
+        unsigned int n = payload_encode(payload, len, &values);
+        unsigned int d = payload_decode(payload, n, &decoded);
+        if (n != len || payload[len] != GUARD || memcmp(payload, full, len) != 0 ||
+            d != len || compare(&values, &decoded, len) != 0)
+            mismatches++;
+    }
+    CHECK(mismatches == 0);
+
+    // Not the fixed fields.
+    payload[0] = (PAYLOAD_FORMAT_PACKED << 4) | 7;
+    CHECK(payload_decode(payload, PAYLOAD_FIELDS_LEN, &decoded) == 0);
+    payload[0] = (PAYLOAD_FORMAT_FIELDS_V0 << 4) | 7;
+    CHECK(payload_decode(payload, PAYLOAD_FIELDS_LEN, &decoded) == 0);
+    CHECK(payload_decode_packed(full, PAYLOAD_FIELDS_LEN, &decoded) == 0);
+}
+
+
+// Encode and decode a bit-packed payload.
+static unsigned int packed(const payload_values_t *values, payload_values_t *decoded)
+{
+    uint8_t payload[PAYLOAD_PACKED_LEN + 1];
+
+    memset(payload, GUARD, sizeof(payload));
+    unsigned int n = payload_encode_packed(payload, sizeof(payload), values);
+    CHECK(payload[PAYLOAD_PACKED_LEN] == GUARD);
+    CHECK(payload[0] >> 4 == PAYLOAD_FORMAT_PACKED);
+    CHECK(payload_decode_packed(payload, n, decoded) == n);
+    return n;
+}
+
+
+static void test_packed(void)
+{
+    payload_values_t values = { 0 }, decoded;
+    const int32_t step = 1L << PAYLOAD_PACKED_SHIFT;
+
+    // Near the anchor: rounded to the resolution, the altitude to 2 m and the
+    // temperature to 0.1 °C.
+    values.txpower = 5;
+    values.datarate = 3;
+    values.temperature = -1234;
+    values.latitude = ANCHOR_LAT + 100 * step + step / 2 - 1;
+    values.longitude = ANCHOR_LON - 2000 * step - step / 2 + 1;
+    values.altitude = 1213;
+    CHECK(packed(&values, &decoded) == PAYLOAD_PACKED_LEN);
+    CHECK(decoded.txpower == 5 && decoded.datarate == 3);
+    CHECK(decoded.temperature == -1230);
+    CHECK(decoded.latitude == ANCHOR_LAT + 100 * step);
+    CHECK(decoded.longitude == ANCHOR_LON - 2000 * step);
+    CHECK(decoded.altitude == 1214);
+
+    // Far from the anchor, the position is clamped; and below the sea level,
+    // the altitude is 0.
+    values.latitude = ANCHOR_LAT + 5000 * step;
+    values.longitude = ANCHOR_LON - 5000 * step;
+    values.altitude = -15;
+    values.temperature = 30000;
+    packed(&values, &decoded);
+    CHECK(decoded.latitude == ANCHOR_LAT + 2047 * step);
+    CHECK(decoded.longitude == ANCHOR_LON - 2047 * step);
+    CHECK(decoded.altitude == 0);
+    CHECK(decoded.temperature == 20470);
+
+    // Without fix.
+    values.latitude = 0;
+    values.longitude = 0;
+    values.altitude = 500;
+    packed(&values, &decoded);
+    CHECK(decoded.latitude == 0 && decoded.longitude == 0 && decoded.altitude == 0);
+
+    // Never truncated: nothing is written below its length.
+    uint8_t payload[PAYLOAD_PACKED_LEN];
+    memset(payload, GUARD, sizeof(payload));
+    CHECK(payload_encode_packed(payload, PAYLOAD_PACKED_LEN - 1, &values) == 0);
+    CHECK(payload[0] == GUARD);
+    CHECK(payload_decode_packed(payload, PAYLOAD_PACKED_LEN - 1, &decoded) == 0);
+
+#if PAYLOAD_PACKED == 1
+    // Chosen by payload_encode() between its length and the fixed fields.
+    uint8_t frame[PAYLOAD_FIELDS_LEN];
+    values.latitude = ANCHOR_LAT;
+    values.longitude = ANCHOR_LON;
+    CHECK(payload_encode(frame, PAYLOAD_PACKED_LEN, &values) == PAYLOAD_PACKED_LEN);
+    CHECK(frame[0] >> 4 == PAYLOAD_FORMAT_PACKED);
+    CHECK(payload_encode(frame, PAYLOAD_FIELDS_LEN - 1, &values) == PAYLOAD_PACKED_LEN);
+    CHECK(payload_encode(frame, PAYLOAD_PACKED_LEN - 1, &values) == PAYLOAD_PACKED_LEN - 1);
+    CHECK(frame[0] >> 4 == PAYLOAD_FORMAT_FIELDS);
+    CHECK(payload_encode(frame, PAYLOAD_FIELDS_LEN, &values) == PAYLOAD_FIELDS_LEN);
+    CHECK(frame[0] >> 4 == PAYLOAD_FORMAT_FIELDS);
+#endif
+}
+
+
+int main(void)
+{
+    printf("[payload] %u bytes of fixed fields, packed %s\n",
+           (unsigned int)PAYLOAD_FIELDS_LEN, PAYLOAD_PACKED ? "on" : "off");
+
+    test_fields();
+    test_packed();
+
+    return host_test_report("payload");
+}
@@ -0,0 +1,144 @@
+/*
+
+Sweep of the NMEA positions: the integer conversion of gps.c against the
+former floating point conversion (positions_to_double, positions_to_binary).
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+#include "gps.h"
+#include "host_test.h"
+
+#include <stdio.h>
+
+
+// Stride of the sweep, in 1/10000 of minute (1 for every value).
+#ifndef POSITION_STRIDE
+#define POSITION_STRIDE 997
+#endif
+
+static const int32_t MaxNorthPosition = 8388607;  // 2^23 - 1
+static const int32_t MaxSouthPosition = 8388608;  // -2^23
+static const int32_t MaxEastPosition  = 8388607;  // 2^23 - 1
+static const int32_t MaxWestPosition  = 8388608;  // -2^23
+
+
+// Former conversion of the latitude, from the digits of ddmm.mmmm.
+static int32_t old_latitude(const char *field, bool south)
+{
+    double valueTmp1, valueTmp2, valueTmp3, latitude;
+    long double temp;
+    int d[10];
+
+    for (int i = 0; i < 10; i++)
+        d[i] = field[i] & 0xF;
+
+    valueTmp1 = (double)d[0] * 10.0 + (double)d[1];
+    valueTmp2 = (double)d[2] * 10.0 + (double)d[3];
+    valueTmp3 = (double)d[5] * 1000.0 + (double)d[6] * 100.0 +
+                (double)d[7] * 10.0 + (double)d[8];
+    latitude = valueTmp1 + ((valueTmp2 + (valueTmp3 * 0.0001)) / 60.0);
+    if (south)
+        latitude *= -1;
+
+    temp = latitude * (latitude >= 0 ? MaxNorthPosition : MaxSouthPosition);
+    return temp / 90;
+}
+
+
+// Former conversion of the longitude, from the digits of dddmm.mmmm.
+static int32_t old_longitude(const char *field, bool west)
+{
+    double valueTmp1, valueTmp2, valueTmp3, valueTmp4, longitude;
+    long double temp;
+    int d[10];
+
+    for (int i = 0; i < 10; i++)
+        d[i] = field[i] & 0xF;
+
+    valueTmp1 = (double)d[0] * 100.0 + (double)d[1] * 10.0 + (double)d[2];
+    valueTmp2 = (double)d[3] * 10.0 + (double)d[4];
+    valueTmp3 = (double)d[6] * 1000.0 + (double)d[7] * 100;
+    valueTmp4 = (double)d[8] * 10.0 + (double)d[9];
+    longitude = valueTmp1 + (valueTmp2 / 60.0) + (((valueTmp3 + valueTmp4) * 0.0001) / 60.0);
+    if (west)
+        longitude *= -1;
+
+    temp = longitude * (longitude >= 0 ? MaxEastPosition : MaxWestPosition);
+    return temp / 180;
+}
+
+
+// Number of positions compared, and of mismatches.
+static unsigned long positions;
+static unsigned long mismatches;
+
+
+// Parse a GGA sentence with the given position (in 1/10000 of minute), and
+// compare the result with the former conversion.
+static void compare(uint32_t lat, bool south, uint32_t lon, bool west)
+{
+    char latitude[16], longitude[16], body[96], sentence[128];
+    int32_t lat_bin, lon_bin;
+    int16_t alt;
+
+    snprintf(latitude, sizeof(latitude), "%02u%02u.%04u",
+             lat / 600000, lat % 600000 / 10000, lat % 10000);
+    snprintf(longitude, sizeof(longitude), "%03u%02u.%04u",
+             lon / 600000, lon % 600000 / 10000, lon % 10000);
+    snprintf(body, sizeof(body), "GPGGA,120000.00,%s,%c,%s,%c,1,08,1.0,100.0,M,48.0,M,,",
+             latitude, south ? 'S' : 'N', longitude, west ? 'W' : 'E');
+    host_nmea_sentence(sentence, sizeof(sentence), body);
+
+    uint8_t status = GPS_PENDING;
+    for (const char *c = sentence; *c; c++) {
+        uint8_t s = gps_parse_byte(*c);
+        if (s != GPS_PENDING)
+            status = s;
+    }
+
+    int32_t lat_old = old_latitude(latitude, south);
+    int32_t lon_old = old_longitude(longitude, west);
+
+    positions++;
+    if (status != GPS_SUCCESS || gps_get_binary(&lat_bin, &lon_bin, &alt) != GPS_SUCCESS ||
+        lat_bin != lat_old || lon_bin != lon_old) {
+        if (mismatches++ < 10)
+            printf("%s %c %s %c: %ld %ld, expected %ld %ld\n",
+                   latitude, south ? 'S' : 'N', longitude, west ? 'W' : 'E',
+                   (long)lat_bin, (long)lon_bin, (long)lat_old, (long)lon_old);
+    }
+}
+
+
+int main(void)
+{
+    const uint32_t lat_max = 90 * 600000, lon_max = 180 * 600000;
+
+    // Both hemispheres, the longitude going twice as fast as the latitude.
+    for (uint32_t lat = 0; lat <= lat_max; lat += POSITION_STRIDE) {
+        uint32_t lon = (2 * lat) % (lon_max + 1);
+        compare(lat, false, lon, false);
+        compare(lat, true, lon, true);
+        compare(lat, false, lon_max - lon, true);
+        compare(lat, true, lon_max - lon, false);
+    }
+
+    // The bounds, and the last values of the minutes and degrees.
+    static const uint32_t edges[] = { 0, 1, 9999, 10000, 599999, 600000, 600001 };
+    for (unsigned int i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+        for (uint32_t degrees = 0; degrees < 90; degrees++) {
+            compare(degrees * 600000 + edges[i], false, 2 * degrees * 600000 + edges[i], true);
+            compare(degrees * 600000 + edges[i], true, 2 * degrees * 600000 + edges[i], false);
+        }
+        compare(lat_max - edges[i], true, lon_max - edges[i], true);
+        compare(lat_max - edges[i], false, lon_max - edges[i], false);
+    }
+
+    printf("[position] %lu positions, %lu mismatches with the floating point conversion\n",
+           positions, mismatches);
+    CHECK(mismatches == 0);
+    return host_test_report("position");
+}
@@ -0,0 +1,95 @@
+/*
+
+Time on air of the uplinks against the Semtech formula (AN1200.13, as in
+the LoRa calculator) computed in floating point, for every datarate of the
+region and every payload size.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+#include "time_on_air.h"
+#include "host_test.h"
+
+#include <math.h>
+
+
+// Spreading factor (0 for FSK) and bandwidth in kHz of the uplink datarates
+// (LoRaWAN Regional Parameters RP002-1.0.3).
+static const struct {
+    unsigned int sf;
+    unsigned int bw;
+} datarates[] = {
+#if defined(REGION_EU868)
+    { 12, 125 }, { 11, 125 }, { 10, 125 }, { 9, 125 }, { 8, 125 }, { 7, 125 }, { 7, 250 }, { 0, 0 },
+#elif defined(REGION_US915)
+    { 10, 125 }, { 9, 125 }, { 8, 125 }, { 7, 125 }, { 8, 500 },
+#endif
+};
+
+
+// Time on air in us of a PHY payload of pl bytes, with the settings of the
+// LoRaWAN uplinks (8 symbols of preamble, explicit header, CRC, CR 4/5).
+static double semtech_us(unsigned int sf, unsigned int bw, unsigned int pl)
+{
+    if (sf == 0)  // FSK at 50 kbps: preamble, sync word, length, payload, CRC.
+        return (5 + 3 + 1 + pl + 2) * 8 / 50e3 * 1e6;
+
+    double symbol = pow(2, sf) / (bw * 1e3);
+    int de = (symbol > 16e-3) ? 1 : 0;
+    double preamble = (8 + 4.25) * symbol;
+    double n = ceil((8.0 * pl - 4 * sf + 28 + 16) / (4.0 * (sf - 2 * de))) * 5;
+    double payload = (8 + (n > 0 ? n : 0)) * symbol;
+    return (preamble + payload) * 1e6;
+}
+
+
+int main(void)
+{
+    unsigned int mismatches = 0;
+
+    CHECK(TIME_ON_AIR_DATARATES == sizeof(datarates) / sizeof(datarates[0]));
+
+    // Every datarate and every size, from the table of the sequence or not.
+    for (unsigned int dr = 0; dr < TIME_ON_AIR_DATARATES; dr++) {
+        for (unsigned int len = 0; len <= 255 - TIME_ON_AIR_OVERHEAD; len++) {
+            double expected = semtech_us(datarates[dr].sf, datarates[dr].bw,
+                                         len + TIME_ON_AIR_OVERHEAD);
+            uint32_t us = time_on_air_us(dr, len);
+            if (fabs(us - expected) >= 1 && mismatches++ < 10)
+                printf("DR%u, %u bytes: %lu us, expected %.3f us\n",
+                       dr, len, (unsigned long)us, expected);
+        }
+    }
+    CHECK(mismatches == 0);
+
+    // Not an uplink datarate of the region.
+    CHECK(time_on_air_us(TIME_ON_AIR_DATARATES, 10) == 0);
+    CHECK(time_on_air_us(0xff, 10) == 0);
+
+#if defined(REGION_EU868) && TIME_ON_AIR_FOPTS_LEN == 0
+    // Values of the Semtech LoRa calculator, for PHY payloads of 13 and 64 bytes.
+    CHECK(time_on_air_us(5, 0) == 46336);
+    CHECK(time_on_air_us(5, 51) == 118016);
+    CHECK(time_on_air_us(0, 0) == 1155072);
+    CHECK(time_on_air_us(0, 51) == 2793472);
+    CHECK(time_on_air_us(6, 0) == 23168);
+    CHECK(time_on_air_us(7, 0) == 3840);
+#endif
+
+#ifdef DRPWSZ_SEQUENCE
+    // The triplets of the sequence, as computed at compile time.
+    static const uint8_t sequence[] = { DRPWSZ_SEQUENCE };
+    for (unsigned int i = 0; i < sizeof(sequence); i += 3) {
+        uint8_t dr = sequence[i], len = sequence[i + 2];
+        if (dr < TIME_ON_AIR_DATARATES)
+            CHECK(fabs(time_on_air_us(dr, len) -
+                       semtech_us(datarates[dr].sf, datarates[dr].bw, len + TIME_ON_AIR_OVERHEAD)) < 1);
+        else
+            CHECK(time_on_air_us(dr, len) == 0);
+    }
+#endif
+
+    return host_test_report("time on air");
+}
@@ -0,0 +1,244 @@
+/*
+
+Tests of the UBX parser: Fletcher checksum, dropped frames, and NAV-PVT
+frames decoded by gps.c (built with GPS_PROTOCOL_UBX).
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+#include "gps.h"
+#include "ubx.h"
+#include "host_test.h"
+
+#include <string.h>
+
+
+// Feed bytes to the UBX parser of gps.c, and return the status of the last
+// frame or sentence.
+static uint8_t feed(const uint8_t *bytes, size_t len)
+{
+    uint8_t status = GPS_PENDING;
+
+    for (size_t i = 0; i < len; i++) {
+        uint8_t s = gps_parse_byte(bytes[i]);
+        if (s != GPS_PENDING)
+            status = s;
+    }
+    return status;
+}
+
+
+// Feed bytes to a UBX parser, and return the status of each byte.
+static void feed_ubx(ubx_parser_t *p, const uint8_t *bytes, size_t len, uint8_t *status)
+{
+    for (size_t i = 0; i < len; i++)
+        status[i] = ubx_parse_byte(p, bytes[i]);
+}
+
+
+static void put_u16(uint8_t *b, uint16_t v)
+{
+    b[0] = v & 0xFF;
+    b[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *b, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        b[i] = (v >> (8 * i)) & 0xFF;
+}
+
+
+// Build a NAV-PVT frame at Grenoble (45.1934 N, 5.7674 E, 212.4 m).
+static size_t nav_pvt(uint8_t *frame, uint8_t fix_type, bool fix_ok)
+{
+    uint8_t pvt[UBX_NAV_PVT_LEN] = { 0 };
+
+    put_u16(pvt + 4, 2026);
+    pvt[6] = 10;            // Month.
+    pvt[7] = 16;            // Day.
+    pvt[8] = 10;            // Hour.
+    pvt[9] = 15;            // Minute.
+    pvt[10] = 30;           // Second.
+    pvt[11] = 0x03;         // validDate, validTime.
+    pvt[20] = fix_type;
+    pvt[21] = fix_ok ? 0x01 : 0x00;
+    pvt[23] = 11;           // numSV.
+    put_u32(pvt + 24, 57674000);          // lon in 1e-7 degree.
+    put_u32(pvt + 28, 451934000);         // lat in 1e-7 degree.
+    put_u32(pvt + 36, 212400);            // hMSL in mm.
+    put_u32(pvt + 40, 3500);              // hAcc in mm.
+    put_u32(pvt + 60, 2778);              // gSpeed in mm/s (10 km/h).
+    put_u32(pvt + 64, 12345678);          // headMot in 1e-5 degree.
+    put_u16(pvt + 76, 150);               // pDOP in 0.01.
+    return ubx_frame(frame, UBX_CLASS_NAV, UBX_NAV_PVT, pvt, sizeof(pvt));
+}
+
+
+static void test_checksum(void)
+{
+    uint8_t frame[UBX_HEADER_LEN + UBX_MAX_PAYLOAD + UBX_CHECKSUM_LEN];
+    uint8_t ck_a, ck_b;
+
+    // Polls of MON-VER and CFG-PRT, as listed in the u-blox protocol description.
+    static const uint8_t mon_ver[] = { 0xB5, 0x62, 0x0A, 0x04, 0x00, 0x00, 0x0E, 0x34 };
+    static const uint8_t cfg_prt[] = { 0xB5, 0x62, 0x06, 0x00, 0x00, 0x00, 0x06, 0x18 };
+    CHECK(ubx_frame(frame, UBX_CLASS_MON, UBX_MON_VER, NULL, 0) == sizeof(mon_ver));
+    CHECK(memcmp(frame, mon_ver, sizeof(mon_ver)) == 0);
+    CHECK(ubx_frame(frame, UBX_CLASS_CFG, UBX_CFG_PRT, NULL, 0) == sizeof(cfg_prt));
+    CHECK(memcmp(frame, cfg_prt, sizeof(cfg_prt)) == 0);
+
+    // CFG-MSG enabling NAV-PVT on the current port.
+    static const uint8_t cfg_msg[] = { 0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x07, 0x01, 0x13, 0x51 };
+    static const uint8_t rate[] = { UBX_CLASS_NAV, UBX_NAV_PVT, 1 };
+    CHECK(ubx_frame(frame, UBX_CLASS_CFG, UBX_CFG_MSG, rate, sizeof(rate)) == sizeof(cfg_msg));
+    CHECK(memcmp(frame, cfg_msg, sizeof(cfg_msg)) == 0);
+
+    // Both sums wrap modulo 256.
+    uint8_t ones[300];
+    memset(ones, 0xFF, sizeof(ones));
+    ubx_checksum(ones, sizeof(ones), &ck_a, &ck_b);
+    CHECK(ck_a == (uint8_t)(300 * 0xFF));
+    CHECK(ck_b == (uint8_t)(0xFF * 300 * 301 / 2));
+}
+
+
+static void test_frames(void)
+{
+    ubx_parser_t p = { 0 };
+    uint8_t frame[UBX_HEADER_LEN + UBX_MAX_PAYLOAD + UBX_CHECKSUM_LEN];
+    uint8_t status[sizeof(frame) + 16];
+    size_t len;
+
+    // A valid frame, then a frame without payload.
+    len = nav_pvt(frame, 3, true);
+    feed_ubx(&p, frame, len, status);
+    CHECK(status[0] == UBX_PENDING && status[len - 2] == UBX_PENDING);
+    CHECK(status[len - 1] == UBX_FRAME);
+    CHECK(p.msg_class == UBX_CLASS_NAV && p.msg_id == UBX_NAV_PVT);
+    CHECK(p.length == UBX_NAV_PVT_LEN && p.payload[23] == 11);
+
+    len = ubx_frame(frame, UBX_CLASS_ACK, UBX_ACK_ACK, NULL, 0);
+    feed_ubx(&p, frame, len, status);
+    CHECK(status[len - 1] == UBX_FRAME && p.length == 0);
+
+    // Bytes out of a frame.
+    static const uint8_t noise[] = { '$', 0x62, 0xB5, 0x00 };
+    feed_ubx(&p, noise, sizeof(noise), status);
+    CHECK(status[0] == UBX_NONE && status[1] == UBX_NONE);
+    CHECK(status[2] == UBX_PENDING && status[3] == UBX_NONE);
+
+    // Bad first, then second checksum byte.
+    len = nav_pvt(frame, 3, true);
+    frame[len - 2] ^= 0x01;
+    feed_ubx(&p, frame, len, status);
+    CHECK(status[len - 2] == UBX_ERROR && status[len - 1] == UBX_NONE);
+    frame[len - 2] ^= 0x01;
+    frame[len - 1] ^= 0x01;
+    feed_ubx(&p, frame, len, status);
+    CHECK(status[len - 1] == UBX_ERROR);
+
+    // A corrupted payload byte.
+    frame[len - 1] ^= 0x01;
+    frame[UBX_HEADER_LEN + 30] ^= 0x10;
+    feed_ubx(&p, frame, len, status);
+    CHECK(status[len - 2] == UBX_ERROR || status[len - 1] == UBX_ERROR);
+    frame[UBX_HEADER_LEN + 30] ^= 0x10;
+
+    // A length above UBX_MAX_PAYLOAD is dropped at the length, and the
+    // parser resyncs on the next frame right away.
+    uint8_t bytes[sizeof(frame) + 6];
+    static const uint8_t oversize[] = { 0xB5, 0x62, UBX_CLASS_MON, UBX_MON_VER,
+                                        (UBX_MAX_PAYLOAD + 1) & 0xFF, (UBX_MAX_PAYLOAD + 1) >> 8 };
+    memcpy(bytes, oversize, sizeof(oversize));
+    memcpy(bytes + sizeof(oversize), frame, len);
+    feed_ubx(&p, bytes, sizeof(oversize) + len, status);
+    CHECK(status[5] == UBX_ERROR);
+    CHECK(status[sizeof(oversize) + len - 1] == UBX_FRAME);
+    CHECK(p.msg_id == UBX_NAV_PVT && p.length == UBX_NAV_PVT_LEN);
+
+    // A false sync in the middle of NMEA data with a huge length.
+    static const uint8_t false_sync[] = { 0xB5, 0x62, 'G', 'P', 'G', 'G' };
+    feed_ubx(&p, false_sync, sizeof(false_sync), status);
+    CHECK(status[5] == UBX_ERROR);
+    feed_ubx(&p, frame, len, status);
+    CHECK(status[len - 1] == UBX_FRAME);
+}
+
+
+static void test_nav_pvt(void)
+{
+    uint8_t frame[UBX_HEADER_LEN + UBX_MAX_PAYLOAD + UBX_CHECKSUM_LEN];
+    gps_data_t data;
+    gps_fix_t fix;
+    size_t len;
+
+    // No fix yet.
+    len = nav_pvt(frame, 0, false);
+    CHECK(feed(frame, len) == GPS_SUCCESS);
+    gps_get_data(&data);
+    CHECK(!data.has_fix && data.fix_mode == 1);
+    CHECK(gps_get_fix(&fix) == GPS_FAIL);
+
+    // A 3D fix.
+    len = nav_pvt(frame, 3, true);
+    CHECK(feed(frame, len) == GPS_SUCCESS);
+    gps_get_data(&data);
+    CHECK(data.has_fix && data.fix_quality == 1 && data.fix_mode == 3);
+    CHECK(data.satellites_used == 11);
+    CHECK(data.altitude == 212);
+    CHECK(data.h_accuracy == 3);
+    CHECK(data.speed == 100);
+    CHECK(data.course == 1234);
+    CHECK(data.pdop == 150);
+    CHECK(data.year == 2026 && data.month == 10 && data.day == 16);
+    CHECK(data.hour == 10 && data.minute == 15 && data.second == 30);
+    CHECK(gps_get_fix(&fix) == GPS_SUCCESS && fix.altitude == 212);
+
+    // Same position as the NMEA sentences (4511.6040 N, 00546.0440 E).
+    int32_t lat = data.latitude_bin, lon = data.longitude_bin;
+    CHECK(lat == (int32_t)(451934000LL * 8388607 / 900000000));
+    CHECK(lon == (int32_t)(57674000LL * 8388607 / 1800000000));
+    char gga[128];
+    host_nmea_sentence(gga, sizeof(gga),
+                       "GNGGA,101530.00,4511.60400,N,00546.04400,E,1,11,0.90,212.4,M,48.0,M,,");
+    CHECK(feed((const uint8_t *)gga, strlen(gga)) == GPS_SUCCESS);
+    gps_get_data(&data);
+    CHECK(data.latitude_bin == lat && data.longitude_bin == lon);
+
+    // The fix is kept on a corrupted frame.
+    len = nav_pvt(frame, 0, false);
+    frame[len - 1] ^= 0xFF;
+    CHECK(feed(frame, len) == GPS_FAIL);
+    gps_get_data(&data);
+    CHECK(data.has_fix);
+
+    // Fix not valid (fixOK clear), and time only fix.
+    len = nav_pvt(frame, 3, false);
+    CHECK(feed(frame, len) == GPS_SUCCESS);
+    gps_get_data(&data);
+    CHECK(!data.has_fix && data.fix_quality == 0);
+    len = nav_pvt(frame, 5, true);
+    CHECK(feed(frame, len) == GPS_SUCCESS);
+    gps_get_data(&data);
+    CHECK(!data.has_fix);
+
+    // Other frames, and a NAV-PVT of another length, are ignored.
+    uint8_t payload[UBX_NAV_PVT_LEN - 8] = { 0 };
+    len = ubx_frame(frame, UBX_CLASS_NAV, UBX_NAV_PVT, payload, sizeof(payload));
+    CHECK(feed(frame, len) == GPS_PENDING);
+    len = ubx_frame(frame, UBX_CLASS_ACK, UBX_ACK_ACK, payload, 2);
+    CHECK(feed(frame, len) == GPS_PENDING);
+}
+
+
+int main(void)
+{
+    test_checksum();
+    test_frames();
+    test_nav_pvt();
+
+    return host_test_report("ubx");
+}
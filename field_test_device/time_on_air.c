@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Time on air of the LoRaWAN uplinks.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#include "time_on_air.h"
+
+#define NELEMS(x)  (sizeof(x) / sizeof((x)[0]))
+
+#ifdef DRPWSZ_SEQUENCE
+// Times of the triplets of the sequence, computed at compile time.
+typedef struct {
+	uint8_t dr;
+	uint8_t len;
+	uint32_t us;
+} time_on_air_entry_t;
+
+_Static_assert(sizeof((uint8_t[]){ DRPWSZ_SEQUENCE }) <= 3 * TIME_ON_AIR_SEQUENCE_MAX,
+		"DRPWSZ_SEQUENCE has more than TIME_ON_AIR_SEQUENCE_MAX triplets");
+
+static const time_on_air_entry_t time_on_air_table[] = {
+	TIME_ON_AIR_SEQUENCE(DRPWSZ_SEQUENCE)
+};
+#endif
+
+uint32_t time_on_air_us(uint8_t dr, uint8_t len)
+{
+#ifdef DRPWSZ_SEQUENCE
+	for (unsigned int i = 0; i < NELEMS(time_on_air_table); i++) {
+		if (time_on_air_table[i].dr == dr && time_on_air_table[i].len == len) {
+			return time_on_air_table[i].us;
+		}
+	}
+#endif
+	return TIME_ON_AIR_US(dr, len);
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Time on air of the LoRaWAN uplinks.
+ *
+ * The Semtech formula (AN1200.13) with the LoRaWAN settings of the uplinks:
+ * 8 symbols of preamble, explicit header, CRC on, coding rate 4/5, and the
+ * low data rate optimization for the symbols longer than 16 ms, at the
+ * spreading factor and the bandwidth of each datarate of the region (LoRaWAN
+ * Regional Parameters RP002-1.0.3). The macros are constant expressions, so
+ * the times of the triplets of DRPWSZ_SEQUENCE are computed at compile time.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef TIME_ON_AIR_H
+#define TIME_ON_AIR_H
+
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef TIME_ON_AIR_FOPTS_LEN
+// MAC commands assumed in the FOpts of each uplink (e.g. the answers to the
+// commands of the network), so that the time is not underestimated.
+#define TIME_ON_AIR_FOPTS_LEN	3
+#endif
+
+// MHDR (1), FHDR without FOpts (7), FPort (1) and MIC (4).
+#define TIME_ON_AIR_OVERHEAD	(13 + TIME_ON_AIR_FOPTS_LEN)
+
+/*
+ * Spreading factor (0 for FSK) and bandwidth in kHz of the uplink datarates.
+ */
+#if defined(REGION_EU868) || defined(REGION_EU433) || defined(REGION_IN865) || defined(REGION_RU864) || defined(REGION_AS923)
+#define TIME_ON_AIR_DATARATES	8
+#define TIME_ON_AIR_SF(dr)		(((dr) <= 5) ? 12 - (dr) : ((dr) == 6) ? 7 : 0)
+#define TIME_ON_AIR_BW(dr)		(((dr) == 6) ? 250 : 125)
+#elif defined(REGION_US915)
+#define TIME_ON_AIR_DATARATES	5
+#define TIME_ON_AIR_SF(dr)		(((dr) <= 3) ? 10 - (dr) : 8)
+#define TIME_ON_AIR_BW(dr)		(((dr) == 4) ? 500 : 125)
+#elif defined(REGION_AU915)
+#define TIME_ON_AIR_DATARATES	7
+#define TIME_ON_AIR_SF(dr)		(((dr) <= 5) ? 12 - (dr) : 8)
+#define TIME_ON_AIR_BW(dr)		(((dr) == 6) ? 500 : 125)
+#elif defined(REGION_KR920) || defined(REGION_CN470)
+#define TIME_ON_AIR_DATARATES	6
+#define TIME_ON_AIR_SF(dr)		(((dr) <= 5) ? 12 - (dr) : 7)
+#define TIME_ON_AIR_BW(dr)		125
+#else
+#error Unsupported region
+#endif
+
+/*
+ * Time on air in us of a LoRa frame of pl bytes (PHY payload), with the
+ * number of symbols in quarters: 8 + 4.25 for the preamble, 8 + n for the
+ * header and the payload.
+ */
+#define TIME_ON_AIR_LORA_SYMBOL_US(sf, bw)	((1UL << (sf)) * 1000 / (bw))
+#define TIME_ON_AIR_LORA_DE(sf, bw)			((TIME_ON_AIR_LORA_SYMBOL_US(sf, bw) > 16000) ? 1 : 0)
+#define TIME_ON_AIR_LORA_NUM(sf, pl)		(8L * (pl) - 4L * (sf) + 28 + 16)
+#define TIME_ON_AIR_LORA_DEN(sf, bw)		(4L * ((sf) - 2 * TIME_ON_AIR_LORA_DE(sf, bw)))
+#define TIME_ON_AIR_LORA_N(sf, bw, pl) \
+	((TIME_ON_AIR_LORA_NUM(sf, pl) > 0) ? \
+	 (TIME_ON_AIR_LORA_NUM(sf, pl) + TIME_ON_AIR_LORA_DEN(sf, bw) - 1) / TIME_ON_AIR_LORA_DEN(sf, bw) * 5 : 0)
+#define TIME_ON_AIR_LORA_US(sf, bw, pl) \
+	(TIME_ON_AIR_LORA_SYMBOL_US(sf, bw) * (4 * (16 + TIME_ON_AIR_LORA_N(sf, bw, pl)) + 17) / 4)
+
+/*
+ * Time on air in us of a FSK frame of pl bytes at 50 kbps (20 us per bit):
+ * preamble (5), sync word (3), length (1), payload and CRC (2).
+ */
+#define TIME_ON_AIR_FSK_US(pl)	((5 + 3 + 1 + (pl) + 2) * 8UL * 20)
+
+/**
+ * Time on air in us of an uplink of len bytes of application payload at a
+ * datarate of the region (0 for another datarate), as a constant expression.
+ */
+#define TIME_ON_AIR_US(dr, len) \
+	(((dr) >= TIME_ON_AIR_DATARATES) ? 0 : \
+	 (TIME_ON_AIR_SF(dr) == 0) ? TIME_ON_AIR_FSK_US((len) + TIME_ON_AIR_OVERHEAD) : \
+	 TIME_ON_AIR_LORA_US(TIME_ON_AIR_SF(dr), TIME_ON_AIR_BW(dr), (len) + TIME_ON_AIR_OVERHEAD))
+
+/*
+ * Entries {dr, size, time} of the triplets <dr, txpower, size> of a sequence
+ * (at most 32 triplets, padded with ADR triplets, which have no time).
+ */
+#define TIME_ON_AIR_SEQUENCE_MAX	32
+#define TIME_ON_AIR_ENTRY(dr, sz)	{ (dr), (sz), TIME_ON_AIR_US(dr, sz) }
+#define TIME_ON_AIR_SEQUENCE(...) \
+	TIME_ON_AIR_SEQUENCE_32(__VA_ARGS__, \
+		0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, \
+		0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, \
+		0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, \
+		0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0)
+#define TIME_ON_AIR_SEQUENCE_32(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_31(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_31(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_30(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_30(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_29(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_29(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_28(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_28(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_27(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_27(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_26(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_26(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_25(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_25(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_24(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_24(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_23(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_23(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_22(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_22(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_21(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_21(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_20(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_20(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_19(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_19(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_18(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_18(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_17(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_17(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_16(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_16(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_15(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_15(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_14(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_14(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_13(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_13(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_12(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_12(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_11(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_11(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_10(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_10(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_9(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_9(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_8(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_8(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_7(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_7(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_6(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_6(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_5(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_5(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_4(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_4(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_3(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_3(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_2(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_2(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz), TIME_ON_AIR_SEQUENCE_1(__VA_ARGS__)
+#define TIME_ON_AIR_SEQUENCE_1(dr, pw, sz, ...)	TIME_ON_AIR_ENTRY(dr, sz)
+
+/**
+ * Get the time on air of an uplink (from the table of the triplets of
+ * DRPWSZ_SEQUENCE, else computed).
+ *
+ * @param dr the datarate
+ * @param len the size of the application payload
+ *
+ * @return the time in us, 0 if the datarate is not an uplink datarate of the region
+ */
+extern uint32_t time_on_air_us(uint8_t dr, uint8_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIME_ON_AIR_H */
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Telemetry of the transmissions of the benchmark.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#include <string.h>
+
+#include "txstats.h"
+
+typedef struct {
+	uint16_t ret[16];
+	uint16_t dr[16];
+	uint16_t txpower[16];
+	uint8_t send[TXSTATS_BUCKETS];
+	uint8_t delay[TXSTATS_BUCKETS];
+	uint8_t sequences;
+} txstats_t;
+
+static txstats_t txstats;
+static uint8_t txstats_index = 0;
+
+static void txstats_count(uint16_t *counters, uint8_t i)
+{
+	if (i < 16 && counters[i] < UINT16_MAX) {
+		counters[i]++;
+	}
+}
+
+// Bucket 0 below unit, then k for [unit * 2^(k-1), unit * 2^k), the last one without bound.
+static void txstats_histogram(uint8_t *buckets, uint32_t value, uint32_t unit)
+{
+	unsigned int k = 0;
+	for (uint32_t v = value / unit; v > 0 && k < TXSTATS_BUCKETS - 1; v >>= 1) {
+		k++;
+	}
+	if (buckets[k] < UINT8_MAX) {
+		buckets[k]++;
+	}
+}
+
+void txstats_sent(uint8_t ret, uint8_t dr, uint8_t txpower, uint32_t send_us, uint32_t delay_us)
+{
+	txstats_count(txstats.ret, ret);
+	txstats_count(txstats.dr, dr);
+	txstats_count(txstats.txpower, txpower);
+	txstats_histogram(txstats.send, send_us, TXSTATS_SEND_UNIT_US);
+	txstats_histogram(txstats.delay, delay_us, TXSTATS_DELAY_UNIT_US);
+}
+
+bool txstats_sequence(void)
+{
+	if (txstats.sequences < UINT8_MAX) {
+		txstats.sequences++;
+	}
+	return TXSTATS_PERIOD > 0 && txstats.sequences >= TXSTATS_PERIOD;
+}
+
+// Bitmap of the counters, then the counters of the bits set.
+static unsigned int txstats_encode_counters(uint8_t *p, const uint16_t *counters)
+{
+	uint16_t bitmap = 0;
+	unsigned int n = 2;
+	for (unsigned int i = 0; i < 16; i++) {
+		if (counters[i] != 0) {
+			bitmap |= 1 << i;
+			p[n++] = counters[i] >> 8;
+			p[n++] = counters[i];
+		}
+	}
+	p[0] = bitmap >> 8;
+	p[1] = bitmap;
+	return n;
+}
+
+uint8_t txstats_encode(uint8_t *buffer, uint8_t len)
+{
+	uint8_t frame[TXSTATS_LEN];
+	unsigned int n = 0;
+
+	frame[n++] = txstats_index;
+	frame[n++] = txstats.sequences;
+	n += txstats_encode_counters(frame + n, txstats.ret);
+	n += txstats_encode_counters(frame + n, txstats.dr);
+	n += txstats_encode_counters(frame + n, txstats.txpower);
+	memcpy(frame + n, txstats.send, TXSTATS_BUCKETS);
+	n += TXSTATS_BUCKETS;
+	memcpy(frame + n, txstats.delay, TXSTATS_BUCKETS);
+	n += TXSTATS_BUCKETS;
+
+	if (n > len) {
+		n = len;
+	}
+	memcpy(buffer, frame, n);
+	return n;
+}
+
+void txstats_reset(void)
+{
+	memset(&txstats, 0, sizeof(txstats));
+	txstats_index++;
+}
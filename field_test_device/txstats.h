@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Telemetry of the transmissions of the benchmark.
+ *
+ * Counters of the frames per return code of semtech_loramac_send(), per
+ * datarate and per txpower, and histograms of the duration of the send
+ * calls and of the delay of the transmissions after their scheduled instant.
+ * They are sent every TXSTATS_PERIOD sequences on the port TXSTATS_PORT, then
+ * reset once the frame is sent. Frame (big endian):
+ *
+ *  - index of the stats frame (1 byte) and number of sequences (1 byte)
+ *  - bitmap of the return codes (2 bytes), then a count (2 bytes) per bit set
+ *  - bitmap of the datarates (2 bytes), then a count (2 bytes) per bit set
+ *  - bitmap of the txpowers (2 bytes), then a count (2 bytes) per bit set
+ *  - histogram of the send calls: 8 counts (1 byte, 255 for more) for
+ *    [0, 64), [64, 128), ... [4096, inf) ms
+ *  - histogram of the delays: 8 counts (1 byte, 255 for more) for
+ *    [0, 1), [1, 2), ... [64, inf) ms
+ *
+ * The frame is sent at the lowest datarate from the current one where it
+ * fits.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef TXSTATS_H
+#define TXSTATS_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef TXSTATS_PERIOD
+// Number of benchmark sequences between two stats frames (0 without stats frame).
+#define TXSTATS_PERIOD	10
+#endif
+
+#ifndef TXSTATS_PORT
+// Port of the stats frames (out of the ports of the benchmark).
+#define TXSTATS_PORT	210
+#endif
+
+// Number of buckets of the histograms.
+#define TXSTATS_BUCKETS		8
+
+// Lower bound of the second bucket of the histograms, in us.
+#define TXSTATS_SEND_UNIT_US	64000
+#define TXSTATS_DELAY_UNIT_US	1000
+
+// Maximum length of a stats frame.
+#define TXSTATS_LEN		(2 + 3 * (2 + 16 * 2) + 2 * TXSTATS_BUCKETS)
+
+/**
+ * Count a frame of the benchmark.
+ *
+ * @param ret the return code of semtech_loramac_send()
+ * @param dr the datarate of the frame
+ * @param txpower the txpower index of the frame
+ * @param send_us the duration of the send call
+ * @param delay_us the delay of the call after its scheduled instant
+ */
+extern void txstats_sent(uint8_t ret, uint8_t dr, uint8_t txpower, uint32_t send_us, uint32_t delay_us);
+
+/**
+ * Count the end of a sequence.
+ *
+ * @return true when a stats frame is due
+ */
+extern bool txstats_sequence(void);
+
+/**
+ * Encode the stats frame (the counters are kept until txstats_reset()).
+ *
+ * @param buffer the payload
+ * @param len the maximum size of the payload (TXSTATS_LEN for the whole frame)
+ *
+ * @return the length of the frame
+ */
+extern uint8_t txstats_encode(uint8_t *buffer, uint8_t len);
+
+/**
+ * Reset the counters once the stats frame is sent, and go to the next frame index.
+ */
+extern void txstats_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TXSTATS_H */
@@ -11,10 +11,22 @@ This project is under the MIT license
 
 #include "app.h"
 #include "gps.h"
+#include "gps_config.h"
+#if GPS_CACHE == 1
+#include "gps_cache.h"
+#endif
+#if GPS_POWER_SAVE == 1
+#include "gps_power.h"
+#endif
 
 #include <periph/uart.h>
+#include <irq.h>
+#include <mutex.h>
+#include <thread.h>
+#include <tsrb.h>
 #include <xtimer.h>
 
+#include <stdatomic.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -24,8 +36,27 @@ This project is under the MIT license
 // UART configuration.
 #define STD_DEV      UART_DEV(0)
 
-#ifndef STD_BAUDRATE
-#define STD_BAUDRATE 9600
+// Measure the parsing time, and print it every GPS_PARSER_STATS sentences.
+#ifndef GPS_PARSER_STATS
+#define GPS_PARSER_STATS  0
+#endif
+
+// The GPS thread runs below the main (sender) and receiver threads.
+#ifndef GPS_THREAD_PRIORITY
+#define GPS_THREAD_PRIORITY  (THREAD_PRIORITY_MAIN + 1)
+#endif
+
+#ifndef GPS_THREAD_STACKSIZE
+#define GPS_THREAD_STACKSIZE  THREAD_STACKSIZE_DEFAULT
+#endif
+
+// The console output is written by a thread below all the others.
+#ifndef STDIO_THREAD_PRIORITY
+#define STDIO_THREAD_PRIORITY  (THREAD_PRIORITY_IDLE - 1)
+#endif
+
+#ifndef STDIO_THREAD_STACKSIZE
+#define STDIO_THREAD_STACKSIZE  THREAD_STACKSIZE_SMALL
 #endif
 
 // Debug a GPS data.
@@ -35,26 +66,210 @@ This project is under the MIT license
 // Unique instance of UART info structure.
 uart_info_t uart_info;
 
+// Storage of the ring buffer between the ISR and the GPS thread.
+static uint8_t uart_rx_buffer[UART_RX_BUFFER_SIZE];
+
+static char gps_thread_stack[GPS_THREAD_STACKSIZE];
+
+// Console output waiting for the stdio thread.
+static uint8_t uart_tx_buffer[UART_TX_BUFFER_SIZE];
+static tsrb_t uart_tx = TSRB_INIT(uart_tx_buffer);
+
+// Unlocked when bytes are queued, to wake the stdio thread up.
+static mutex_t uart_tx_ready = MUTEX_INIT_LOCKED;
+
+// Serialize the writers of the UART (stdio thread and GNSS commands).
+static mutex_t uart_tx_lock = MUTEX_INIT;
+
+// The console output is queued once the stdio thread runs.
+static bool uart_tx_started = false;
+
+// The console output stays queued while the GNSS module is in standby (set
+// and read with uart_tx_lock held).
+static bool uart_tx_held = false;
+
+static char stdio_thread_stack[STDIO_THREAD_STACKSIZE];
+
+// Pending requests to the GPS thread (UART_GPS_RESET, UART_GPS_CONFIG).
+static atomic_uint gps_requests;
+
 
-// Handle interruption from UART.
+// Handle interruption from UART: only push the byte into the ring buffer.
 static void uart_isr(uart_info_t *info, char c)
 {
-    if (info->line_length >= 127)
-        info->line_length = 0;
-
-    if (c != '$')
-        goto store_c;
-    if (strncmp(info->line, "$GPGGA", 6) != 0)
-        goto reset_line;
-
-    gps_parse_data((int8_t *)info->line, info->line_length);
-    DEBUG("[uart] gps data: lat = %ld, lon = %ld, alt = %d\n",
-        gps_data.latitude_bin, gps_data.longitude_bin, gps_data.altitude);
-
-reset_line:
-    info->line_length = 0;
-store_c:
-    info->line[info->line_length++] = c;
+#if UART_ISR_STATS
+    uint32_t start = xtimer_now_usec();
+#endif
+
+    if (isrpipe_write_one(&info->rx, (uint8_t)c) < 0)
+        info->overruns++;
+
+#if UART_ISR_STATS
+    uint32_t duration = xtimer_now_usec() - start;
+    if (duration > info->isr_max_us)
+        info->isr_max_us = duration;
+#endif
+}
+
+
+// Feed one received byte to the NMEA parser.
+static void gps_parse(uart_info_t *info, char c)
+{
+    switch (gps_parse_byte(c)) {
+    case GPS_SUCCESS:
+        info->sentences++;
+        if (ENABLE_DEBUG) {
+            gps_data_t data;
+            gps_get_data(&data);
+            DEBUG("[uart] gps data: lat = %ld, lon = %ld, alt = %d\n",
+                data.latitude_bin, data.longitude_bin, data.altitude);
+        }
+        break;
+    case GPS_FAIL:
+        info->dropped++;
+        break;
+    }
+}
+
+
+// Drain the ring buffer filled by the ISR.
+static void *gps_thread(void *arg)
+{
+    uart_info_t *info = arg;
+    uint8_t chunk[16];
+
+#if GPS_POWER_SAVE == 1
+    // Power the module up before the detection.
+    gps_power_init();
+#endif
+
+    uint8_t module = gps_config();
+#if GPS_CACHE == 1
+    gps_cache_restore(module);
+#else
+    (void)module;
+#endif
+
+    while (1) {
+        // Blocks until the ISR pushes at least one byte (or a request).
+        int n = isrpipe_read(&info->rx, chunk, sizeof(chunk));
+
+#if GPS_PARSER_STATS
+        uint32_t sentences = info->sentences + info->dropped;
+        uint32_t start = xtimer_now_usec();
+#endif
+
+        for (int i = 0; i < n; i++)
+            gps_parse(info, (char)chunk[i]);
+
+#if GPS_PARSER_STATS
+        info->parse_us += xtimer_now_usec() - start;
+        info->parse_bytes += n;
+        if ((info->sentences + info->dropped) / GPS_PARSER_STATS != sentences / GPS_PARSER_STATS) {
+            uint32_t total = info->sentences + info->dropped;
+            printf("[uart] parser: sentences=%lu dropped=%lu overruns=%lu bytes=%lu %lu ns/sentence %lu ns/byte\n",
+                info->sentences, info->dropped, info->overruns, info->parse_bytes,
+                (uint32_t)((uint64_t)info->parse_us * 1000 / total),
+                (uint32_t)((uint64_t)info->parse_us * 1000 / info->parse_bytes));
+        }
+#endif
+
+        unsigned int requests = atomic_exchange(&gps_requests, 0);
+        if (requests & UART_GPS_RESET)
+            gps_reset_data();
+        if (requests & UART_GPS_CONFIG) {
+            // The module is back to its default baudrate and messages.
+            uart_gps_set_baudrate(STD_BAUDRATE);
+            gps_config();
+        }
+    }
+    return NULL;
+}
+
+
+// Write the console output queued by stdio_write.
+static void *stdio_thread(void *arg)
+{
+    (void)arg;
+    uint8_t chunk[32];
+
+    while (1) {
+        mutex_lock(&uart_tx_ready);
+
+        while (1) {
+            mutex_lock(&uart_tx_lock);
+            int n = uart_tx_held ? 0 : tsrb_get(&uart_tx, chunk, sizeof(chunk));
+            if (n > 0)
+                uart_write(STD_DEV, chunk, n);
+            mutex_unlock(&uart_tx_lock);
+            if (n <= 0)
+                break;
+        }
+    }
+    return NULL;
+}
+
+
+// Start the GPS and stdio threads.
+void uart_gps_thread_start(void)
+{
+    thread_create(stdio_thread_stack, sizeof(stdio_thread_stack),
+                  STDIO_THREAD_PRIORITY, 0, stdio_thread, NULL, "stdio");
+    uart_tx_started = true;
+
+    thread_create(gps_thread_stack, sizeof(gps_thread_stack),
+                  GPS_THREAD_PRIORITY, 0, gps_thread, &uart_info, "GPS");
+}
+
+
+// Ask the GPS thread to reset the GPS data or to configure the module again.
+void uart_gps_request(unsigned int requests)
+{
+    atomic_fetch_or(&gps_requests, requests);
+
+    // Wake the GPS thread up with a line end (the parser drops at most the
+    // sentence being received).
+    unsigned int state = irq_disable();
+    isrpipe_write_one(&uart_info.rx, '\n');
+    irq_restore(state);
+}
+
+
+// Send a command to the GNSS module (on the console UART).
+void uart_gps_send(const uint8_t *data, size_t len)
+{
+    mutex_lock(&uart_tx_lock);
+    uart_write(STD_DEV, data, len);
+    mutex_unlock(&uart_tx_lock);
+}
+
+
+// Flush the console output and keep the next one queued, or release it.
+void uart_stdio_hold(bool hold)
+{
+    uint8_t chunk[32];
+    int n;
+
+    mutex_lock(&uart_tx_lock);
+    if (hold) {
+        while ((n = tsrb_get(&uart_tx, chunk, sizeof(chunk))) > 0)
+            uart_write(STD_DEV, chunk, n);
+    }
+    uart_tx_held = hold;
+    mutex_unlock(&uart_tx_lock);
+
+    if (!hold)
+        mutex_unlock(&uart_tx_ready);
+}
+
+
+// Change the baudrate of the UART shared by the console and the GNSS module.
+void uart_gps_set_baudrate(uint32_t baudrate)
+{
+    mutex_lock(&uart_tx_lock);
+    uart_info.baudrate = baudrate;
+    uart_init(STD_DEV, baudrate, (uart_rx_cb_t)uart_isr, &uart_info);
+    mutex_unlock(&uart_tx_lock);
 }
 
 
@@ -65,16 +280,31 @@ ssize_t stdio_read(void *buffer, size_t count)
     return 0;
 }
 
-// Write STDOUT data to serial port 0.
+// Write STDOUT data to serial port 0: queue it for the stdio thread, and drop
+// what does not fit. It is written synchronously from an ISR, with the
+// interrupts disabled (e.g. a panic) or before the stdio thread starts.
 ssize_t stdio_write(const void *buffer, size_t len)
 {
-    uart_write(STD_DEV, (const uint8_t *)buffer, len);
+    if (!uart_tx_started || irq_is_in() || !irq_is_enabled()) {
+        uart_write(STD_DEV, (const uint8_t *)buffer, len);
+        return len;
+    }
+
+    unsigned int state = irq_disable();
+    int n = tsrb_add(&uart_tx, buffer, len);
+    uart_info.tx_bytes += n;
+    uart_info.tx_dropped += len - n;
+    irq_restore(state);
+
+    mutex_unlock(&uart_tx_ready);
     return len;
 }
 
 // Initialize STDIO module.
 void stdio_init(void)
 {
+    isrpipe_init(&uart_info.rx, uart_rx_buffer, sizeof(uart_rx_buffer));
+    uart_info.baudrate = STD_BAUDRATE;
     uart_init(STD_DEV, STD_BAUDRATE, (uart_rx_cb_t)uart_isr, &uart_info);
 }
 
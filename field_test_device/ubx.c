@@ -0,0 +1,146 @@
+/*
+
+Encode and decode the u-blox UBX binary protocol.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+#if GPS == 1
+
+#include "ubx.h"
+
+#include <string.h>
+
+
+// States of the UBX parser.
+enum {
+    UBX_SYNC_1 = 0,
+    UBX_SYNC_2,
+    UBX_CLASS,
+    UBX_ID,
+    UBX_LENGTH_1,
+    UBX_LENGTH_2,
+    UBX_PAYLOAD,
+    UBX_CK_A,
+    UBX_CK_B,
+};
+
+
+// Compute the 8-bit Fletcher checksum of a UBX frame.
+void ubx_checksum(const uint8_t *data, size_t len, uint8_t *ck_a, uint8_t *ck_b)
+{
+    uint8_t a = 0, b = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        a += data[i];
+        b += a;
+    }
+    *ck_a = a;
+    *ck_b = b;
+}
+
+
+// Build a UBX frame.
+size_t ubx_frame(uint8_t *frame, uint8_t msg_class, uint8_t msg_id,
+                 const uint8_t *payload, uint16_t len)
+{
+    frame[0] = UBX_SYNC_CHAR_1;
+    frame[1] = UBX_SYNC_CHAR_2;
+    frame[2] = msg_class;
+    frame[3] = msg_id;
+    frame[4] = len & 0xFF;
+    frame[5] = len >> 8;
+    if (len > 0)
+        memcpy(frame + UBX_HEADER_LEN, payload, len);
+
+    // The checksum covers the class, id, length and payload.
+    ubx_checksum(frame + 2, len + 4, &frame[UBX_HEADER_LEN + len],
+                 &frame[UBX_HEADER_LEN + len + 1]);
+    return UBX_HEADER_LEN + len + UBX_CHECKSUM_LEN;
+}
+
+
+// Update the running checksum.
+static void ubx_update(ubx_parser_t *p, uint8_t c)
+{
+    p->ck_a += c;
+    p->ck_b += p->ck_a;
+}
+
+
+// Parse a byte of a UBX frame.
+uint8_t ubx_parse_byte(ubx_parser_t *p, uint8_t c)
+{
+    switch (p->state) {
+    case UBX_SYNC_1:
+        if (c != UBX_SYNC_CHAR_1)
+            return UBX_NONE;
+        p->state = UBX_SYNC_2;
+        break;
+
+    case UBX_SYNC_2:
+        if (c != UBX_SYNC_CHAR_2) {
+            p->state = UBX_SYNC_1;
+            return UBX_NONE;
+        }
+        p->ck_a = p->ck_b = 0;
+        p->state = UBX_CLASS;
+        break;
+
+    case UBX_CLASS:
+        ubx_update(p, c);
+        p->msg_class = c;
+        p->state = UBX_ID;
+        break;
+
+    case UBX_ID:
+        ubx_update(p, c);
+        p->msg_id = c;
+        p->state = UBX_LENGTH_1;
+        break;
+
+    case UBX_LENGTH_1:
+        ubx_update(p, c);
+        p->length = c;
+        p->state = UBX_LENGTH_2;
+        break;
+
+    case UBX_LENGTH_2:
+        ubx_update(p, c);
+        p->length |= (uint16_t)c << 8;
+        if (p->length > UBX_MAX_PAYLOAD) {
+            // Too long to be stored (or a false sync): resync right away.
+            p->state = UBX_SYNC_1;
+            return UBX_ERROR;
+        }
+        p->index = 0;
+        p->state = (p->length > 0) ? UBX_PAYLOAD : UBX_CK_A;
+        break;
+
+    case UBX_PAYLOAD:
+        ubx_update(p, c);
+        p->payload[p->index] = c;
+        if (++p->index == p->length)
+            p->state = UBX_CK_A;
+        break;
+
+    case UBX_CK_A:
+        if (c != p->ck_a) {
+            p->state = UBX_SYNC_1;
+            return UBX_ERROR;
+        }
+        p->state = UBX_CK_B;
+        break;
+
+    case UBX_CK_B:
+        p->state = UBX_SYNC_1;
+        if (c != p->ck_b)
+            return UBX_ERROR;
+        return UBX_FRAME;
+    }
+
+    return UBX_PENDING;
+}
+
+#endif
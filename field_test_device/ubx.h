@@ -0,0 +1,126 @@
+/*
+
+Encode and decode the u-blox UBX binary protocol.
+
+Copyright (C) 2019, ENSIMAG students
+This project is under the MIT license
+
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+
+#if GPS == 1
+
+// Frame header.
+#define UBX_SYNC_CHAR_1     0xB5
+#define UBX_SYNC_CHAR_2     0x62
+
+// Header (sync, class, id, length) and checksum sizes.
+#define UBX_HEADER_LEN      6
+#define UBX_CHECKSUM_LEN    2
+
+// Message classes and identifiers.
+#define UBX_CLASS_NAV       0x01
+#define UBX_NAV_PVT         0x07
+#define UBX_CLASS_RXM       0x02
+#define UBX_RXM_PMREQ       0x41
+#define UBX_CLASS_ACK       0x05
+#define UBX_CLASS_MGA       0x13
+#define UBX_MGA_INI         0x40
+#define UBX_ACK_NAK         0x00
+#define UBX_ACK_ACK         0x01
+#define UBX_CLASS_CFG       0x06
+#define UBX_CFG_PRT         0x00
+#define UBX_CFG_MSG         0x01
+#define UBX_CFG_NAV5        0x24
+#define UBX_CLASS_MON       0x0A
+#define UBX_MON_VER         0x04
+#define UBX_CLASS_NMEA      0xF0
+#define UBX_NMEA_GGA        0x00
+#define UBX_NMEA_GLL        0x01
+#define UBX_NMEA_GSA        0x02
+#define UBX_NMEA_GSV        0x03
+#define UBX_NMEA_RMC        0x04
+#define UBX_NMEA_VTG        0x05
+
+// Protocol masks of CFG-PRT.
+#define UBX_PROTO_UBX       0x01
+#define UBX_PROTO_NMEA      0x02
+
+// Dynamic platform model of CFG-NAV5 for balloons (airborne with <1g).
+#define UBX_DYN_AIRBORNE_1G 6
+
+// Types and lengths of the MGA-INI payloads.
+#define UBX_MGA_INI_POS_LLH     0x01
+#define UBX_MGA_INI_POS_LLH_LEN 20
+#define UBX_MGA_INI_TIME_UTC    0x10
+#define UBX_MGA_INI_TIME_UTC_LEN 24
+
+// Length of the NAV-PVT payload.
+#define UBX_NAV_PVT_LEN     92
+
+// Longest payload accepted by the parser (longer frames are dropped at their length).
+#ifndef UBX_MAX_PAYLOAD
+#define UBX_MAX_PAYLOAD     UBX_NAV_PVT_LEN
+#endif
+
+// Return codes of ubx_parse_byte.
+#define UBX_NONE            0  // The byte is not part of a UBX frame.
+#define UBX_PENDING         1  // A frame is being received.
+#define UBX_FRAME           2  // A valid frame has been received.
+#define UBX_ERROR           3  // A frame has been dropped (bad checksum or length).
+
+
+// Context of the UBX frame parser.
+typedef struct {
+    uint8_t state;
+    uint8_t msg_class;
+    uint8_t msg_id;
+    uint16_t length;
+    uint16_t index;
+    uint8_t ck_a;
+    uint8_t ck_b;
+    uint8_t payload[UBX_MAX_PAYLOAD];
+} ubx_parser_t;
+
+
+/**
+ * @brief Compute the 8-bit Fletcher checksum of a UBX frame.
+ * @param data Class, id, length and payload of the frame.
+ * @param len Length of data.
+ * @param ck_a Where to store the first checksum byte.
+ * @param ck_b Where to store the second checksum byte.
+ */
+void ubx_checksum(const uint8_t *data, size_t len, uint8_t *ck_a, uint8_t *ck_b);
+
+
+/**
+ * @brief Build a UBX frame.
+ * @param frame Where to store the frame (`len` + 8 bytes).
+ * @param msg_class Class of the message.
+ * @param msg_id Identifier of the message.
+ * @param payload Payload of the message.
+ * @param len Length of the payload.
+ * @return The length of the frame.
+ */
+size_t ubx_frame(uint8_t *frame, uint8_t msg_class, uint8_t msg_id,
+                 const uint8_t *payload, uint16_t len);
+
+
+/**
+ * @brief Parse a byte of a UBX frame.
+ * @param p Parser context.
+ * @param c Byte received from the GPS.
+ * @return `UBX_FRAME` when a valid frame is available in the parser,
+ *         `UBX_ERROR` when a frame has been dropped, `UBX_PENDING` when the
+ *         byte belongs to a frame, else `UBX_NONE`.
+ */
+uint8_t ubx_parse_byte(ubx_parser_t *p, uint8_t c);
+
+#endif
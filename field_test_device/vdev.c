@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Sessions of the virtual devices of the benchmark.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include <string.h>
+
+#include "net/loramac.h"
+#include "semtech_loramac.h"
+#include "vdev.h"
+
+typedef struct {
+	uint32_t devaddr;
+	uint32_t fcnt_up;
+} vdev_session_t;
+
+#ifdef DEVADDRS
+static const uint32_t vdev_devaddrs[] = { DEVADDRS };
+_Static_assert(sizeof(vdev_devaddrs) / sizeof(vdev_devaddrs[0]) >= VIRT_DEV,
+		"DEVADDRS has less than VIRT_DEV addresses");
+#endif
+
+static vdev_session_t vdev_sessions[VIRT_DEV];
+static unsigned int vdev_current = 0;
+
+// Session keys of the MAC (the virtual device 0).
+static uint8_t vdev_nwkskey[LORAMAC_NWKSKEY_LEN];
+static uint8_t vdev_appskey[LORAMAC_APPSKEY_LEN];
+
+static uint32_t vdev_get_devaddr(semtech_loramac_t *loramac)
+{
+	uint8_t addr[LORAMAC_DEVADDR_LEN];
+	semtech_loramac_get_devaddr(loramac, addr);
+	return ((uint32_t)addr[0] << 24) | ((uint32_t)addr[1] << 16) | ((uint32_t)addr[2] << 8) | addr[3];
+}
+
+static void vdev_set_devaddr(semtech_loramac_t *loramac, uint32_t devaddr)
+{
+	uint8_t addr[LORAMAC_DEVADDR_LEN] = { devaddr >> 24, devaddr >> 16, devaddr >> 8, devaddr };
+	semtech_loramac_set_devaddr(loramac, addr);
+}
+
+void vdev_init(semtech_loramac_t *loramac)
+{
+	uint32_t devaddr = vdev_get_devaddr(loramac);
+	semtech_loramac_get_nwkskey(loramac, vdev_nwkskey);
+	semtech_loramac_get_appskey(loramac, vdev_appskey);
+
+	for (unsigned int i = 0; i < VIRT_DEV; i++) {
+#ifdef DEVADDRS
+		vdev_sessions[i].devaddr = vdev_devaddrs[i];
+#else
+		vdev_sessions[i].devaddr = devaddr + i;
+#endif
+		vdev_sessions[i].fcnt_up = 0;
+	}
+	vdev_current = 0;
+	vdev_sessions[0].fcnt_up = semtech_loramac_get_uplink_counter(loramac);
+	if (vdev_sessions[0].devaddr != devaddr) {
+		vdev_set_devaddr(loramac, vdev_sessions[0].devaddr);
+	}
+	DEBUG("[vdev] %d virtual devices from devaddr=%08lx\n", VIRT_DEV, vdev_sessions[0].devaddr);
+}
+
+uint32_t vdev_switch(semtech_loramac_t *loramac, unsigned int i)
+{
+	i %= VIRT_DEV;
+	if (i == vdev_current) {
+		return vdev_sessions[i].devaddr;
+	}
+	vdev_sessions[vdev_current].fcnt_up = semtech_loramac_get_uplink_counter(loramac);
+
+	uint8_t nwkskey[LORAMAC_NWKSKEY_LEN];
+	uint8_t appskey[LORAMAC_APPSKEY_LEN];
+	memcpy(nwkskey, vdev_nwkskey, LORAMAC_NWKSKEY_LEN);
+	memcpy(appskey, vdev_appskey, LORAMAC_APPSKEY_LEN);
+	nwkskey[LORAMAC_NWKSKEY_LEN - 1] ^= i;
+	appskey[LORAMAC_APPSKEY_LEN - 1] ^= i;
+
+	vdev_set_devaddr(loramac, vdev_sessions[i].devaddr);
+	semtech_loramac_set_nwkskey(loramac, nwkskey);
+	semtech_loramac_set_appskey(loramac, appskey);
+	semtech_loramac_set_uplink_counter(loramac, vdev_sessions[i].fcnt_up);
+	vdev_current = i;
+
+	return vdev_sessions[i].devaddr;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Sessions of the virtual devices of the benchmark.
+ *
+ * Each virtual device has its own DevAddr, FCntUp and session keys, so that
+ * the network server accepts the frames of all of them. The table holds 8
+ * bytes per device (2 KB for 256 devices): the keys are derived from the
+ * session keys of the MAC, the last byte XORed with the index of the device
+ * (the device 0 is the MAC session itself). The MAC switches between the
+ * devices by setting the 4 values of the session before each frame.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef VDEV_H
+#define VDEV_H
+
+#include <inttypes.h>
+
+#include "semtech_loramac.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef VIRT_DEV
+// Number of virtual devices.
+#define VIRT_DEV	1
+#endif
+
+#if VIRT_DEV < 1 || VIRT_DEV > 256
+#error VIRT_DEV must be between 1 and 256
+#endif
+
+/**
+ * Initialize the sessions from the session of the MAC (after the join). The
+ * DevAddr of the device i is DEVADDRS[i] if defined, else the DevAddr of the
+ * MAC plus i.
+ *
+ * @param loramac the LoRaMac context
+ */
+extern void vdev_init(semtech_loramac_t *loramac);
+
+/**
+ * Switch the MAC to the session of a virtual device, saving the FCntUp of
+ * the current one.
+ *
+ * @param loramac the LoRaMac context
+ * @param i the index of the virtual device (modulo VIRT_DEV)
+ *
+ * @return the DevAddr of the virtual device
+ */
+extern uint32_t vdev_switch(semtech_loramac_t *loramac, unsigned int i);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VDEV_H */
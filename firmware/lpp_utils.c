@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Integer-only encoder of the Cayenne LPP payload.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#include <stddef.h>
+
+#include "lpp_utils.h"
+
+/* Start a field of len bytes of data, NULL when the payload is full */
+static uint8_t *lpp_utils_field(lpp_utils_t *lpp, uint8_t channel, uint8_t type, uint8_t len)
+{
+    if (lpp->cursor + 2 + len > LPP_UTILS_MAX_SIZE) {
+        return NULL;
+    }
+    uint8_t *field = lpp->buffer + lpp->cursor;
+    field[0] = channel;
+    field[1] = type;
+    lpp->cursor += 2 + len;
+    return field + 2;
+}
+
+/* Store a value in big endian */
+static uint8_t *lpp_utils_put(uint8_t *data, uint32_t value, uint8_t len)
+{
+    for (uint8_t i = 0; i < len; i++) {
+        data[i] = value >> (8 * (len - 1 - i));
+    }
+    return data + len;
+}
+
+void lpp_utils_reset(lpp_utils_t *lpp)
+{
+    lpp->cursor = 0;
+}
+
+bool lpp_utils_add_analog_input(lpp_utils_t *lpp, uint8_t channel, int16_t value)
+{
+    uint8_t *data = lpp_utils_field(lpp, channel, LPP_UTILS_ANALOG_INPUT, 2);
+    if (data == NULL) {
+        return false;
+    }
+    lpp_utils_put(data, (uint16_t)value, 2);
+    return true;
+}
+
+bool lpp_utils_add_temperature(lpp_utils_t *lpp, uint8_t channel, int16_t decicelsius)
+{
+    uint8_t *data = lpp_utils_field(lpp, channel, LPP_UTILS_TEMPERATURE, 2);
+    if (data == NULL) {
+        return false;
+    }
+    lpp_utils_put(data, (uint16_t)decicelsius, 2);
+    return true;
+}
+
+bool lpp_utils_add_accelerometer(lpp_utils_t *lpp, uint8_t channel, int16_t x, int16_t y, int16_t z)
+{
+    uint8_t *data = lpp_utils_field(lpp, channel, LPP_UTILS_ACCELEROMETER, 6);
+    if (data == NULL) {
+        return false;
+    }
+    data = lpp_utils_put(data, (uint16_t)x, 2);
+    data = lpp_utils_put(data, (uint16_t)y, 2);
+    lpp_utils_put(data, (uint16_t)z, 2);
+    return true;
+}
+
+bool lpp_utils_add_barometric_pressure(lpp_utils_t *lpp, uint8_t channel, uint16_t decihpa)
+{
+    uint8_t *data = lpp_utils_field(lpp, channel, LPP_UTILS_BAROMETRIC_PRESSURE, 2);
+    if (data == NULL) {
+        return false;
+    }
+    lpp_utils_put(data, decihpa, 2);
+    return true;
+}
+
+bool lpp_utils_add_gps(lpp_utils_t *lpp, uint8_t channel, int32_t latitude, int32_t longitude, int32_t altitude)
+{
+    uint8_t *data = lpp_utils_field(lpp, channel, LPP_UTILS_GPS, 9);
+    if (data == NULL) {
+        return false;
+    }
+    data = lpp_utils_put(data, (uint32_t)latitude, 3);
+    data = lpp_utils_put(data, (uint32_t)longitude, 3);
+    lpp_utils_put(data, (uint32_t)altitude, 3);
+    return true;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2020 INRIA
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       Integer-only encoder of the Cayenne LPP payload.
+ *
+ * The values are given in the units of the LPP fields, so the payload is the
+ * same as the one of the Cayenne LPP package without any float conversion.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef LPP_UTILS_H
+#define LPP_UTILS_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Maximum size of the payload (as the Cayenne LPP package, the maximum payload size at DR0 in EU868) */
+#define LPP_UTILS_MAX_SIZE              (51)
+
+/* Types of the LPP fields (IPSO object id - 3200) */
+#define LPP_UTILS_ANALOG_INPUT          (2U)
+#define LPP_UTILS_TEMPERATURE           (103U)
+#define LPP_UTILS_ACCELEROMETER         (113U)
+#define LPP_UTILS_BAROMETRIC_PRESSURE   (115U)
+#define LPP_UTILS_GPS                   (136U)
+
+    /**
+     * LPP payload, sent as is.
+     */
+    typedef struct {
+        uint8_t buffer[LPP_UTILS_MAX_SIZE];
+        uint8_t cursor;
+    } lpp_utils_t;
+
+    void lpp_utils_reset(lpp_utils_t *lpp);
+
+    /* value in 0.01 (signed) */
+    bool lpp_utils_add_analog_input(lpp_utils_t *lpp, uint8_t channel, int16_t value);
+
+    /* temperature in 0.1 °C */
+    bool lpp_utils_add_temperature(lpp_utils_t *lpp, uint8_t channel, int16_t decicelsius);
+
+    /* accelerations in 0.001 G */
+    bool lpp_utils_add_accelerometer(lpp_utils_t *lpp, uint8_t channel, int16_t x, int16_t y, int16_t z);
+
+    /* pressure in 0.1 hPa (i.e. in 10 Pa) */
+    bool lpp_utils_add_barometric_pressure(lpp_utils_t *lpp, uint8_t channel, uint16_t decihpa);
+
+    /* latitude and longitude in 0.0001°, altitude in 0.01 m (24 bits each) */
+    bool lpp_utils_add_gps(lpp_utils_t *lpp, uint8_t channel, int32_t latitude, int32_t longitude, int32_t altitude);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -29,7 +29,7 @@
 #include "net/loramac.h"
 #include "semtech_loramac.h"
 #include "loramac_utils.h"
-#include "cayenne_lpp.h"
+#include "lpp_utils.h"
 
 // NXP MPL3115A2: 20 to 110 kPa, Absolute Digital Pressure Sensor
 #include "mpl3115a2.h"
@@ -51,8 +51,8 @@ static semtech_loramac_t loramac;
 /* Declare globally the sensor device descriptor */
 static mpl3115a2_t dev;
 
-/* Cayenne LPP buffer */
-static cayenne_lpp_t lpp;
+/* Cayenne LPP buffer (sent as is) */
+static lpp_utils_t lpp;
 
 /* LoRaMac values */
 #define JOIN_NEXT_RETRY_TIME            120 // Next join tentative in 2 minute(s)
@@ -134,7 +134,7 @@ static void print_sensors(void)
 }
 
 
-static void read_sensors(cayenne_lpp_t* lpp){
+static void read_sensors(lpp_utils_t* lpp){
     // TODO si l'initialisation du ds75lx a échoué, il faut envoyer un message avec le fPort PORT_UP_ERROR
 
     if (mpl3115a2_set_active(&dev) != MPL3115A2_OK) {
@@ -153,8 +153,9 @@ static void read_sensors(cayenne_lpp_t* lpp){
     else {
     	DEBUG("mpl3115a2: pressure=%u Pa, temperature=%3d.%d C, state=%#02x\n",
                 (unsigned int)pressure, temperature/10, abs(temperature%10), status);
-        cayenne_lpp_add_temperature(lpp, 0, (float)temperature / 10);
-        cayenne_lpp_add_barometric_pressure(lpp, 1, (float)pressure);
+        /* temperature in 0.1 °C and pressure in 0.1 hPa, as the LPP fields */
+        lpp_utils_add_temperature(lpp, 0, temperature);
+        lpp_utils_add_barometric_pressure(lpp, 1, pressure / 10);
     }
 
     if (mpl3115a2_set_standby(&dev) != MPL3115A2_OK) {
@@ -179,7 +180,7 @@ static void sender(void)
         }
 
         /* clear buffer once done */
-        cayenne_lpp_reset(&lpp);
+        lpp_utils_reset(&lpp);
 
         /* sleep tx_period secs */
         // TODO introduire un alea de quelques secondes dans la tx_period pour éviter que des endpoints qui redémarrent ensemble se brouillent les uns les autres.